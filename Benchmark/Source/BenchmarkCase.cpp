@@ -0,0 +1,70 @@
+/*
+  ==============================================================================
+
+    BenchmarkCase.cpp
+
+  ==============================================================================
+*/
+
+#include "BenchmarkCase.h"
+
+static void setUpPlate (ThinPlate* plate, const BenchmarkCase& c, bool strike)
+{
+    auto setParameters = [&] (double excX)
+    {
+        plate->updateParameters (1, 0.0005, c.lengthX, c.lengthY, excX, 0.5, 0.5, 0.5, c.thickness, 10, 1, 0.1, 0.1, 1, c.bow ? 1 : 2, 0.01, 0.01, c.bowSustain, 0.01, 0, 0, c.lfoRate, c.xPosMod, c.yPosMod, c.numStrings, 0.2, 50, 1000, 25, 1, 0.2, 1.77, 2, 0.8, 10, 1, c.tube, c.springConn);
+    };
+    setParameters (0.5);
+    plate->updatePlateMaterial (c.material);
+    plate->setPlateShape (c.shape);
+    plate->setImplicitScheme (c.implicit, c.gridScale);
+    plate->setWaveguideStiffnessLimit (c.waveguideLimit);
+    plate->setSubsystemRates (c.stringRatio, c.tubeRatio);
+    plate->setPlateKernel (c.kernel);
+    plate->setActiveRegionTracking (c.activeRegion);
+    plate->setSymmetryReduction (c.symmetry);
+    plate->setNonlinearity (c.nonlinearity);
+    StochasticExcitation::Settings impacts;
+    impacts.density = c.impactDensity;
+    plate->setStochasticExcitation (impacts);
+    plate->setStochasticSeed (1); // The same impacts for every variant and run
+
+    plate->initParameters();
+    if (c.strikeOnAxis)
+    {
+        // The centre line depends on the grid, so it is only known after the first setup
+        setParameters (plate->getCentreLineRatio());
+        plate->initParameters();
+    }
+    if (strike)
+    {
+        plate->plateHit();
+        plate->initParameters();
+        plate->startBow();
+    }
+}
+
+std::unique_ptr<ThinPlate> createPlate (const BenchmarkCase& c)
+{
+    auto plate = std::make_unique<ThinPlate> (1.0 / c.fs);
+    plate->getSampleRate (c.fs);
+    setUpPlate (plate.get(), c, true);
+    return plate;
+}
+
+std::unique_ptr<PlateNetwork> createPlateNetwork (const BenchmarkCase& c, int maxBlockSize)
+{
+    auto network = std::make_unique<PlateNetwork> (1.0 / c.fs);
+    for (int i = 0; i < c.numPlates; ++i)
+        setUpPlate (&network->getPlate (network->addPlate()), c, i == 0);
+
+    // The spring of the string connections
+    for (int i = 0; i + 1 < c.numPlates; ++i)
+    {
+        auto& plate = network->getPlate (i);
+        auto& next = network->getPlate (i + 1);
+        network->addLink (i, plate.getNx() / 3, plate.getNy() / 3, i + 1, next.getNx() / 2, next.getNy() / 2, 1e8, 1e10, 0.01);
+    }
+    network->prepare (maxBlockSize);
+    return network;
+}
@@ -0,0 +1,49 @@
+/*
+  ==============================================================================
+
+    BenchmarkCase.h
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "../../Source/ThinPlate.h"
+#include "../../Source/PlateNetwork.h"
+
+// Plate settings for one run. Everything not listed has the plugin default
+struct BenchmarkCase
+{
+    juce::String group, name;
+    double fs = 44100;
+    double lengthX = 0.5, lengthY = 0.5;
+    int shape = PlateGeometry::Rectangle;
+    double thickness = 8;
+    int material = 1;
+    bool bow = false;
+    double bowSustain = 0;
+    double lfoRate = 0.1;
+    int xPosMod = 0, yPosMod = 0;
+    int numStrings = 0;
+    bool springConn = true;
+    bool tube = false;
+    bool implicit = false;
+    double gridScale = 1;
+    double waveguideLimit = 1e-3; // ThinPlate's default
+    int stringRatio = 1, tubeRatio = 1;
+    ThinPlate::PlateKernel kernel = ThinPlate::ReferenceKernel;
+    bool activeRegion = true;
+    bool symmetry = false;
+    bool strikeOnAxis = false; // Excite on the plate's centre line instead of at 0.5
+    double nonlinearity = 0;
+    double impactDensity = 0; // Random impacts per second
+    int numPlates = 1; // Plates linked in a chain by a PlateNetwork, only the first one struck. 1 runs the plate on its own
+};
+
+// A plate set up for the case that has just received a note on, as in the plugin
+std::unique_ptr<ThinPlate> createPlate (const BenchmarkCase& c);
+
+// numPlates plates of the case, each linked to the next from a third of the way across it to the
+// middle of the next, prepared for blocks of up to maxBlockSize samples
+std::unique_ptr<PlateNetwork> createPlateNetwork (const BenchmarkCase& c, int maxBlockSize);
@@ -0,0 +1,173 @@
+/*
+  ==============================================================================
+
+    KernelComparison.cpp
+
+  ==============================================================================
+*/
+
+#include "KernelComparison.h"
+
+std::vector<KernelVariant> getKernelVariants()
+{
+    return {
+        { "reference", [] (BenchmarkCase& c) { c.activeRegion = false; } },
+        { "waveguides", [] (BenchmarkCase& c) { c.waveguideLimit = 1.0; } },
+        { "implicit", [] (BenchmarkCase& c) { c.implicit = true; } },
+        { "implicit x2", [] (BenchmarkCase& c) { c.implicit = true; c.gridScale = 2; } },
+        { "multirate x2", [] (BenchmarkCase& c) { c.stringRatio = 2; c.tubeRatio = 2; } },
+        { "rows", [] (BenchmarkCase& c) { c.kernel = ThinPlate::RowKernel; } },
+        { "tiled", [] (BenchmarkCase& c) { c.kernel = ThinPlate::TiledKernel; } },
+        { "tracking", [] (BenchmarkCase& c) { c.activeRegion = true; } },
+        { "on axis", [] (BenchmarkCase& c) { c.strikeOnAxis = true; } },
+        { "symmetric", [] (BenchmarkCase& c) { c.strikeOnAxis = true; c.symmetry = true; } }
+    };
+}
+
+static std::vector<BenchmarkCase> getScenarios()
+{
+    // The scenarios sweep the whole plate, so each variant only differs from the exact reference by
+    // its own settings. Active region tracking clears edge lines after a mallet hit
+    BenchmarkCase exact;
+    exact.activeRegion = false;
+    std::vector<BenchmarkCase> scenarios;
+
+    auto mallet = exact;
+    mallet.name = "mallet";
+    scenarios.push_back (mallet);
+
+    auto bow = exact;
+    bow.name = "bow + LFO";
+    bow.bow = true;
+    bow.bowSustain = 1;
+    bow.lfoRate = 3;
+    bow.xPosMod = bow.yPosMod = 50;
+    scenarios.push_back (bow);
+
+    auto strings = exact;
+    strings.name = "strings";
+    strings.numStrings = 4;
+    strings.springConn = true;
+    scenarios.push_back (strings);
+
+    auto tube = exact;
+    tube.name = "tube";
+    tube.tube = true;
+    scenarios.push_back (tube);
+
+    return scenarios;
+}
+
+struct Render
+{
+    std::vector<float> output;
+    double seconds = 0;
+};
+
+// The note is released halfway. The time is the best of a few runs
+static Render render (const BenchmarkCase& c, int numSamples)
+{
+    Render result;
+    for (int run = 0; run < 3; ++run)
+    {
+        auto plate = createPlate (c);
+        std::vector<float> output (static_cast<size_t> (numSamples));
+        auto start = juce::Time::getHighResolutionTicks();
+        for (int n = 0; n < numSamples; ++n)
+        {
+            if (n == numSamples / 2)
+                plate->endBow();
+            plate->calculateScheme();
+            output[static_cast<size_t> (n)] = plate->getOutput();
+        }
+        auto elapsed = juce::Time::highResolutionTicksToSeconds (juce::Time::getHighResolutionTicks() - start);
+
+        if (run == 0 || elapsed < result.seconds)
+            result.seconds = elapsed;
+        result.output = std::move (output);
+    }
+    return result;
+}
+
+// Distance between two floats in representable values
+static juce::int64 getUlpDistance (float a, float b)
+{
+    if (a == b)
+        return 0;
+    if (std::isnan (a) || std::isnan (b))
+        return std::numeric_limits<juce::int64>::max();
+
+    auto toOrdered = [] (float x)
+    {
+        juce::int32 i;
+        std::memcpy (&i, &x, sizeof (i));
+        return i < 0 ? static_cast<juce::int64> (std::numeric_limits<juce::int32>::min()) - i : static_cast<juce::int64> (i);
+    };
+    return std::abs (toOrdered (a) - toOrdered (b));
+}
+
+static std::vector<double> getFrameEnergiesDb (const std::vector<float>& output, int frameLength)
+{
+    std::vector<double> energies;
+    for (size_t start = 0; start + static_cast<size_t> (frameLength) <= output.size(); start += static_cast<size_t> (frameLength))
+    {
+        double energy = 0;
+        for (size_t n = start; n < start + static_cast<size_t> (frameLength); ++n)
+            energy += static_cast<double> (output[n]) * output[n];
+        energies.push_back (10 * std::log10 (energy + 1e-30));
+    }
+    return energies;
+}
+
+bool compareKernels (const KernelVariant& reference, const KernelVariant& candidate, const ComparisonTolerances& tolerances, double seconds)
+{
+    std::cout << candidate.name << " against " << reference.name << std::endl;
+    std::cout << "scenario      max ulps        max dB    speedup   result" << std::endl;
+
+    bool allPassed = true;
+    for (auto scenario : getScenarios())
+    {
+        auto referenceCase = scenario;
+        reference.configure (referenceCase);
+        auto candidateCase = scenario;
+        candidate.configure (candidateCase);
+
+        auto numSamples = juce::jmax (1, static_cast<int> (seconds * scenario.fs));
+        auto referenceRender = render (referenceCase, numSamples);
+        auto candidateRender = render (candidateCase, numSamples);
+
+        juce::int64 maxUlps = 0;
+        for (size_t n = 0; n < referenceRender.output.size(); ++n)
+            maxUlps = std::max (maxUlps, getUlpDistance (referenceRender.output[n], candidateRender.output[n]));
+
+        auto frameLength = juce::jmax (1, static_cast<int> (0.01 * scenario.fs));
+        auto referenceEnergies = getFrameEnergiesDb (referenceRender.output, frameLength);
+        auto candidateEnergies = getFrameEnergiesDb (candidateRender.output, frameLength);
+        auto loudest = referenceEnergies.empty() ? 0.0 : *std::max_element (referenceEnergies.begin(), referenceEnergies.end());
+        double maxDb = 0;
+        for (size_t f = 0; f < referenceEnergies.size(); ++f)
+        {
+            if (referenceEnergies[f] > loudest - 60)
+                maxDb = std::max (maxDb, std::abs (candidateEnergies[f] - referenceEnergies[f]));
+            if (std::isnan (candidateEnergies[f]))
+                maxDb = std::numeric_limits<double>::infinity();
+        }
+
+        auto speedup = referenceRender.seconds / candidateRender.seconds;
+        juce::StringArray failures;
+        if (tolerances.maxUlps >= 0 && maxUlps > tolerances.maxUlps)
+            failures.add ("ulps");
+        if (! (maxDb <= tolerances.maxEnergyDb))
+            failures.add ("energy");
+        if (speedup < tolerances.minSpeedup)
+            failures.add ("speed");
+        allPassed = allPassed && failures.isEmpty();
+
+        std::cout << scenario.name.paddedRight (' ', 14)
+                  << juce::String (maxUlps).paddedRight (' ', 16)
+                  << juce::String (maxDb, 3).paddedRight (' ', 10)
+                  << juce::String (speedup, 2).paddedRight (' ', 10)
+                  << (failures.isEmpty() ? juce::String ("pass") : "FAIL (" + failures.joinIntoString (", ") + ")") << std::endl;
+    }
+    return allPassed;
+}
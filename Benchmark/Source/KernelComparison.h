@@ -0,0 +1,40 @@
+/*
+  ==============================================================================
+
+    KernelComparison.h
+
+    Runs a candidate plate kernel against a reference on fixed scenarios (mallet hit,
+    bowed note with LFO position modulation, strings with spring connections, tube) and
+    checks that it sounds the same and is faster:
+    - the output samples differ by at most maxUlps units in the last place,
+    - the output energy in 10 ms frames differs by at most maxEnergyDb, over the frames
+      within 60 dB of the loudest reference frame,
+    - the candidate takes at most 1 / minSpeedup of the reference time.
+
+    New kernels are added to getKernelVariants() with the settings that select them.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "BenchmarkCase.h"
+
+struct KernelVariant
+{
+    juce::String name;
+    std::function<void (BenchmarkCase&)> configure;
+};
+
+struct ComparisonTolerances
+{
+    int maxUlps = -1; // < 0 skips the sample comparison
+    double maxEnergyDb = 0.5;
+    double minSpeedup = 1.0;
+};
+
+std::vector<KernelVariant> getKernelVariants();
+
+// Prints a line per scenario and returns true if the candidate passes all of them
+bool compareKernels (const KernelVariant& reference, const KernelVariant& candidate, const ComparisonTolerances& tolerances, double seconds);
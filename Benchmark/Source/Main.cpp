@@ -0,0 +1,299 @@
+/*
+  ==============================================================================
+
+    Main.cpp
+
+    Times ThinPlate::calculateScheme() over a matrix of plate, shape, excitation, string, tube,
+    sample rate, scheme, nonlinearity, random impact and coupled plate settings. Each group varies one of them
+    around the plugin defaults (a mallet hit on a 0.5 x 0.5 m brass plate at 44.1 kHz).
+    Usage: PlateBenchmark [--seconds=2] [--group=name] [--json=results.json]
+           PlateBenchmark --compare=candidate [--reference=reference] [--seconds=2]
+                          [--ulps=-1] [--db=0.5] [--speedup=1]
+           PlateBenchmark --tune [--group=name]
+
+    The JSON file holds every case with its settings and results, so runs of different
+    versions can be compared case by case. --compare checks a kernel variant against the
+    reference (see KernelComparison.h) and exits with 1 if it fails. --tune times the plate
+    kernels on the grid of every case and stores the fastest in the plugin's kernel table
+    (see PlateKernelTuner.h), so the plugin doesn't calibrate them when it loads.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "BenchmarkCase.h"
+#include "KernelComparison.h"
+#include "../../Source/PlateKernelTuner.h"
+
+struct BenchmarkResult
+{
+    int Nx = 0, Ny = 0;
+    double nsPerSample = 0;
+    double cellUpdatesPerSecond = 0;
+    double realtimeFactor = 0;
+    double iterationsPerStep = 0;
+    double peak = 0;
+};
+
+// The plates of a network step in blocks, each on its own thread, as PlateNetwork::process() runs them
+static BenchmarkResult runNetworkBenchmark (const BenchmarkCase& c, double seconds)
+{
+    const int blockSize = 64;
+    auto network = createPlateNetwork (c, blockSize);
+    std::vector<float> output (blockSize);
+
+    for (int n = 0; n < static_cast<int> (0.05 * c.fs); n += blockSize)
+        network->process (output.data(), blockSize);
+
+    auto numBlocks = juce::jmax (1, static_cast<int> (seconds * c.fs / blockSize));
+    BenchmarkResult result;
+    auto start = juce::Time::getHighResolutionTicks();
+    for (int b = 0; b < numBlocks; ++b)
+    {
+        network->process (output.data(), blockSize);
+        for (auto sample : output)
+            result.peak = std::max (result.peak, std::abs (static_cast<double> (sample)));
+    }
+    auto elapsed = juce::Time::highResolutionTicksToSeconds (juce::Time::getHighResolutionTicks() - start);
+
+    auto numSamples = numBlocks * blockSize;
+    result.Nx = network->getPlate (0).getNx();
+    result.Ny = network->getPlate (0).getNy();
+    result.nsPerSample = elapsed / numSamples * 1e9;
+    result.cellUpdatesPerSecond = static_cast<double> (result.Nx) * result.Ny * c.numPlates * numSamples / elapsed;
+    result.realtimeFactor = numSamples / (c.fs * elapsed);
+    return result;
+}
+
+static BenchmarkResult runBenchmark (const BenchmarkCase& c, double seconds)
+{
+    if (c.numPlates > 1)
+        return runNetworkBenchmark (c, seconds);
+
+    auto plate = createPlate (c);
+
+    // Let the excitation start and the caches warm up before timing
+    for (int n = 0; n < static_cast<int> (0.05 * c.fs); ++n)
+        plate->calculateScheme();
+
+    auto numSamples = juce::jmax (1, static_cast<int> (seconds * c.fs));
+    BenchmarkResult result;
+    juce::int64 iterations = 0;
+    auto start = juce::Time::getHighResolutionTicks();
+    for (int n = 0; n < numSamples; ++n)
+    {
+        plate->calculateScheme();
+        result.peak = std::max (result.peak, std::abs (static_cast<double> (plate->getOutput())));
+        iterations += plate->getSolverIterations();
+    }
+    auto elapsed = juce::Time::highResolutionTicksToSeconds (juce::Time::getHighResolutionTicks() - start);
+
+    result.Nx = plate->getNx();
+    result.Ny = plate->getNy();
+    result.nsPerSample = elapsed / numSamples * 1e9;
+    result.cellUpdatesPerSecond = static_cast<double> (result.Nx) * result.Ny * numSamples / elapsed;
+    result.realtimeFactor = numSamples / (c.fs * elapsed);
+    result.iterationsPerStep = static_cast<double> (iterations) / numSamples;
+    return result;
+}
+
+static std::vector<BenchmarkCase> getCases()
+{
+    std::vector<BenchmarkCase> cases;
+    auto add = [&cases] (const juce::String& group, const juce::String& name, std::function<void (BenchmarkCase&)> setup)
+    {
+        BenchmarkCase c;
+        c.group = group;
+        c.name = name;
+        setup (c);
+        cases.push_back (c);
+    };
+
+    for (auto size : { 0.3, 0.5, 0.8, 1.0 })
+        add ("size", juce::String (size, 1) + " m", [size] (BenchmarkCase& c) { c.lengthX = c.lengthY = size; });
+
+    const char* materials[] = { "brass", "bronze", "iron", "aluminium", "gold", "silver", "copper" };
+    for (int material = 1; material <= 7; ++material)
+        add ("material", materials[material - 1], [material] (BenchmarkCase& c) { c.material = material; });
+
+    // On a large plate, where the plate update dominates
+    for (int shape = 0; shape < PlateGeometry::NumShapes; ++shape)
+        add ("shape", PlateGeometry::getShapeName (shape), [shape] (BenchmarkCase& c) { c.lengthX = c.lengthY = 1.0; c.shape = shape; });
+
+    for (auto thickness : { 4.0, 8.0, 14.0, 20.0 })
+        add ("thickness", juce::String (thickness, 0) + " mm", [thickness] (BenchmarkCase& c) { c.thickness = thickness; });
+
+    add ("excitation", "mallet", [] (BenchmarkCase&) {});
+    add ("excitation", "bow", [] (BenchmarkCase& c) { c.bow = true; });
+
+    for (auto springConn : { true, false })
+        for (auto numStrings : { 0, 1, 2, 4, 8 })
+            add ("strings", juce::String (numStrings) + (springConn ? " spring" : " rigid"), [=] (BenchmarkCase& c) { c.numStrings = numStrings; c.springConn = springConn; });
+
+    add ("tube", "off", [] (BenchmarkCase&) {});
+    add ("tube", "on", [] (BenchmarkCase& c) { c.tube = true; });
+
+    for (auto fs : { 44100.0, 96000.0, 192000.0 })
+        add ("sample rate", juce::String (fs / 1000, 1) + " kHz", [fs] (BenchmarkCase& c) { c.fs = fs; });
+
+    // The plate and string schemes, with four strings to show the string paths
+    add ("scheme", "explicit", [] (BenchmarkCase& c) { c.numStrings = 4; c.waveguideLimit = 0; });
+    add ("scheme", "waveguides", [] (BenchmarkCase& c) { c.numStrings = 4; c.waveguideLimit = 1.0; }); // every string as a waveguide
+    for (auto gridScale : { 1.0, 1.5, 2.0, 3.0 })
+        add ("scheme", "implicit x" + juce::String (gridScale, 1), [gridScale] (BenchmarkCase& c) { c.numStrings = 4; c.waveguideLimit = 0; c.implicit = true; c.gridScale = gridScale; });
+
+    // The stress solve on each plate size, at a gain where the mallet hit is clearly nonlinear
+    for (auto size : { 0.3, 0.5, 0.8, 1.0 })
+        add ("nonlinear", juce::String (size, 1) + " m", [size] (BenchmarkCase& c) { c.lengthX = c.lengthY = size; c.nonlinearity = 1e4; });
+
+    // Random impacts on top of the mallet hit. The plate update doesn't change, so the difference is the injection
+    for (auto density : { 0.0, 100.0, 1000.0, 10000.0 })
+        add ("impacts", juce::String (density, 0) + " /s", [density] (BenchmarkCase& c) { c.impactDensity = density; });
+
+    // Plates coupled by a PlateNetwork, one thread per plate
+    for (auto numPlates : { 1, 2, 3, 4 })
+        add ("network", juce::String (numPlates) + (numPlates == 1 ? " plate" : " plates"), [numPlates] (BenchmarkCase& c) { c.numPlates = numPlates; });
+
+    return cases;
+}
+
+static juce::var toVar (const BenchmarkCase& c, const BenchmarkResult& result)
+{
+    auto* object = new juce::DynamicObject();
+    object->setProperty ("group", c.group);
+    object->setProperty ("name", c.name);
+    object->setProperty ("sampleRate", c.fs);
+    object->setProperty ("lengthX", c.lengthX);
+    object->setProperty ("lengthY", c.lengthY);
+    object->setProperty ("shape", PlateGeometry::getShapeName (c.shape));
+    object->setProperty ("thickness", c.thickness);
+    object->setProperty ("material", c.material);
+    object->setProperty ("excitation", c.bow ? "bow" : "mallet");
+    object->setProperty ("numStrings", c.numStrings);
+    object->setProperty ("springConn", c.springConn);
+    object->setProperty ("tube", c.tube);
+    object->setProperty ("implicit", c.implicit);
+    object->setProperty ("gridScale", c.gridScale);
+    object->setProperty ("nonlinearity", c.nonlinearity);
+    object->setProperty ("impactDensity", c.impactDensity);
+    object->setProperty ("numPlates", c.numPlates);
+    object->setProperty ("waveguideLimit", c.waveguideLimit);
+    object->setProperty ("kernel", ThinPlate::getPlateKernelName (c.kernel));
+    object->setProperty ("Nx", result.Nx);
+    object->setProperty ("Ny", result.Ny);
+    object->setProperty ("nsPerSample", result.nsPerSample);
+    object->setProperty ("cellUpdatesPerSecond", result.cellUpdatesPerSecond);
+    object->setProperty ("realtimeFactor", result.realtimeFactor);
+    object->setProperty ("iterationsPerStep", result.iterationsPerStep);
+    object->setProperty ("peak", result.peak);
+    return juce::var (object);
+}
+
+int main (int argc, char* argv[])
+{
+    juce::ArgumentList args (argc, argv);
+    auto seconds = args.containsOption ("--seconds") ? args.getValueForOption ("--seconds").getDoubleValue() : 2.0;
+    auto group = args.getValueForOption ("--group");
+
+    if (args.containsOption ("--compare"))
+    {
+        auto findVariant = [] (const juce::String& name, KernelVariant& variant)
+        {
+            for (const auto& v : getKernelVariants())
+            {
+                if (v.name == name)
+                {
+                    variant = v;
+                    return true;
+                }
+            }
+            std::cerr << "Unknown kernel " << name << ". Kernels:";
+            for (const auto& v : getKernelVariants())
+                std::cerr << " \"" << v.name << "\"";
+            std::cerr << std::endl;
+            return false;
+        };
+
+        KernelVariant reference, candidate;
+        auto referenceName = args.containsOption ("--reference") ? args.getValueForOption ("--reference") : juce::String ("reference");
+        if (! findVariant (referenceName, reference) || ! findVariant (args.getValueForOption ("--compare"), candidate))
+            return 1;
+
+        ComparisonTolerances tolerances;
+        if (args.containsOption ("--ulps"))
+            tolerances.maxUlps = args.getValueForOption ("--ulps").getIntValue();
+        if (args.containsOption ("--db"))
+            tolerances.maxEnergyDb = args.getValueForOption ("--db").getDoubleValue();
+        if (args.containsOption ("--speedup"))
+            tolerances.minSpeedup = args.getValueForOption ("--speedup").getDoubleValue();
+
+        return compareKernels (reference, candidate, tolerances, seconds) ? 0 : 1;
+    }
+
+    if (args.containsOption ("--tune"))
+    {
+        auto cacheFile = getDefaultKernelCacheFile();
+        for (const auto& c : getCases())
+        {
+            if (group.isNotEmpty() && c.group != group)
+                continue;
+
+            auto plate = createPlate (c);
+            auto timings = calibratePlateKernels (*plate);
+            std::cout << c.group.paddedRight (' ', 13) << c.name.paddedRight (' ', 17)
+                      << (juce::String (plate->getNx()) + "x" + juce::String (plate->getNy())).paddedRight (' ', 9);
+            for (const auto& timing : timings)
+                std::cout << ThinPlate::getPlateKernelName (timing.kernel) << " " << juce::String (timing.nsPerStep, 0) << " ns  ";
+            std::cout << std::endl;
+
+            if (! cachePlateKernel (getKernelCacheKey (*plate, c.fs), timings.front().kernel, cacheFile))
+            {
+                std::cerr << "Can't write " << cacheFile.getFullPathName() << std::endl;
+                return 1;
+            }
+        }
+        std::cout << "Kernels written to " << cacheFile.getFullPathName() << std::endl;
+        return 0;
+    }
+
+    std::cout << "group        case             grid     ns/sample   Mcells/s  realtime  iterations  peak" << std::endl;
+
+    juce::Array<juce::var> results;
+    for (const auto& c : getCases())
+    {
+        if (group.isNotEmpty() && c.group != group)
+            continue;
+
+        auto result = runBenchmark (c, seconds);
+        results.add (toVar (c, result));
+
+        std::cout << c.group.paddedRight (' ', 13)
+                  << c.name.paddedRight (' ', 17)
+                  << (juce::String (result.Nx) + "x" + juce::String (result.Ny)).paddedRight (' ', 9)
+                  << juce::String (result.nsPerSample, 0).paddedRight (' ', 12)
+                  << juce::String (result.cellUpdatesPerSecond * 1e-6, 1).paddedRight (' ', 10)
+                  << juce::String (result.realtimeFactor, 1).paddedRight (' ', 10)
+                  << juce::String (result.iterationsPerStep, 2).paddedRight (' ', 12)
+                  << juce::String (result.peak, 4) << std::endl;
+    }
+
+    if (args.containsOption ("--json"))
+    {
+        auto* root = new juce::DynamicObject();
+        root->setProperty ("time", juce::Time::getCurrentTime().toISO8601 (true));
+        root->setProperty ("cpu", juce::SystemStats::getCpuModel());
+        root->setProperty ("os", juce::SystemStats::getOperatingSystemName());
+        root->setProperty ("secondsPerCase", seconds);
+        root->setProperty ("cases", results);
+
+        auto file = args.getFileForOption ("--json");
+        if (! file.replaceWithText (juce::JSON::toString (juce::var (root))))
+        {
+            std::cerr << "Can't write " << file.getFullPathName() << std::endl;
+            return 1;
+        }
+        std::cout << "Results written to " << file.getFullPathName() << std::endl;
+    }
+
+    return 0;
+}
@@ -0,0 +1,145 @@
+/*
+  ==============================================================================
+
+    Main.cpp
+
+    Renders a MIDI file with a plugin preset to WAV or FLAC without a host or a display,
+    or a parameter sweep into a folder (see SweepRunner.h).
+    Usage: PlateRenderer <input.mid> <output.wav|.flac> [--preset=file] [--rate=48000]
+                         [--tail=3] [--bits=24] [--threads=N] [--warm-start=state.plsnap]
+                         [--save-state=state.plsnap] [--checkpoint=folder]
+           PlateRenderer --sweep=grid.xml <output folder> [--threads=N]
+
+    The preset is either the plugin state as the host saves it or the same tree as XML.
+    --save-state saves the plate at the note off of the first note (e.g. a sustained bow),
+    and --warm-start starts every note from such a snapshot instead of silence. With
+    --checkpoint the notes save their progress in the folder, and running the same command
+    again after an interruption continues from there.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "NoteRenderer.h"
+#include "SweepRunner.h"
+
+static juce::String getOption (const juce::ArgumentList& args, const juce::String& option, const juce::String& defaultValue)
+{
+    return args.containsOption (option) ? args.getValueForOption (option) : defaultValue;
+}
+
+int main (int argc, char* argv[])
+{
+    juce::ArgumentList args (argc, argv);
+    juce::Array<juce::File> files;
+    for (const auto& arg : args.arguments)
+        if (! arg.isOption())
+            files.add (arg.resolveAsFile());
+
+    auto numThreads = getOption (args, "--threads", juce::String (juce::SystemStats::getNumCpus())).getIntValue();
+
+    if (args.containsOption ("--sweep") && files.size() == 1)
+    {
+        SweepRunner sweepRunner;
+        auto result = sweepRunner.loadGrid (args.getFileForOption ("--sweep"));
+        if (result.wasOk())
+            result = sweepRunner.run (files[0], numThreads);
+        if (result.failed())
+        {
+            std::cerr << result.getErrorMessage() << std::endl;
+            return 1;
+        }
+        return 0;
+    }
+
+    if (files.size() != 2)
+    {
+        std::cout << "Usage: PlateRenderer <input.mid> <output.wav|.flac> [--preset=file] [--rate=48000] [--tail=3] [--bits=24] [--threads=N]" << std::endl;
+        std::cout << "                     [--warm-start=state.plsnap] [--save-state=state.plsnap] [--checkpoint=folder]" << std::endl;
+        std::cout << "       PlateRenderer --sweep=grid.xml <output folder> [--threads=N]" << std::endl;
+        return 1;
+    }
+
+    auto midiPath = files[0];
+    auto outputPath = files[1];
+
+    ChainSettings chainSettings;
+    PlateOptions options;
+    juce::String presetText;
+    if (args.containsOption ("--preset"))
+    {
+        auto presetFile = args.getFileForOption ("--preset");
+        auto state = loadPreset (presetFile);
+        if (! state.isValid())
+        {
+            std::cerr << "Can't read the preset " << presetFile.getFullPathName() << std::endl;
+            return 1;
+        }
+        chainSettings = getChainSettings (state);
+        options = getPlateOptions (state);
+        presetText = state.toXmlString();
+    }
+
+    RenderSettings renderSettings;
+    renderSettings.sampleRate = getOption (args, "--rate", "48000").getDoubleValue();
+    renderSettings.tailSeconds = getOption (args, "--tail", "3").getDoubleValue();
+    auto bitDepth = getOption (args, "--bits", "24").getIntValue();
+
+    if (args.containsOption ("--warm-start"))
+    {
+        renderSettings.warmStart = args.getFileForOption ("--warm-start");
+        auto result = checkSnapshot (renderSettings.warmStart, chainSettings, options, renderSettings);
+        if (result.failed())
+        {
+            std::cerr << result.getErrorMessage() << std::endl;
+            return 1;
+        }
+    }
+
+    juce::File checkpointFolder;
+    if (args.containsOption ("--checkpoint"))
+    {
+        checkpointFolder = args.getFileForOption ("--checkpoint");
+        if (checkpointFolder.createDirectory().failed())
+        {
+            std::cerr << "Can't create " << checkpointFolder.getFullPathName() << std::endl;
+            return 1;
+        }
+
+        // Checkpoints are only picked up by a render of the same file with the same settings
+        auto description = midiPath.getFullPathName() + juce::String (midiPath.getLastModificationTime().toMilliseconds()) + presetText
+                         + juce::String (renderSettings.sampleRate) + juce::String (renderSettings.tailSeconds) + renderSettings.warmStart.getFullPathName();
+        renderSettings.checkpointKey = description.hashCode64();
+    }
+
+    juce::FileInputStream midiStream (midiPath);
+    juce::MidiFile midiFile;
+    if (! midiStream.openedOk() || ! midiFile.readFrom (midiStream))
+    {
+        std::cerr << "Can't read the MIDI file " << midiPath.getFullPathName() << std::endl;
+        return 1;
+    }
+
+    auto notes = getRenderNotes (midiFile);
+    std::cout << "Rendering " << notes.size() << " notes at " << renderSettings.sampleRate << " Hz on " << numThreads << " threads" << std::endl;
+
+    auto start = juce::Time::getMillisecondCounterHiRes();
+    juce::ThreadPool threadPool (juce::jmax (1, numThreads));
+    auto saveState = args.containsOption ("--save-state") ? args.getFileForOption ("--save-state") : juce::File();
+    auto mix = renderNotes (notes, chainSettings, options, renderSettings, threadPool, checkpointFolder, saveState);
+    auto seconds = (juce::Time::getMillisecondCounterHiRes() - start) * 0.001;
+
+    auto result = writeAudioFile (outputPath, mix, renderSettings.sampleRate, bitDepth);
+    if (result.failed())
+    {
+        std::cerr << result.getErrorMessage() << std::endl;
+        return 1;
+    }
+
+    for (int n = 0; n < static_cast<int> (notes.size()) && checkpointFolder != juce::File(); ++n)
+        getCheckpointFile (checkpointFolder, n).deleteFile();
+
+    auto audioSeconds = mix.getNumSamples() / renderSettings.sampleRate;
+    std::cout << "Wrote " << audioSeconds << " s to " << outputPath.getFullPathName() << " in " << seconds << " s (" << audioSeconds / seconds << "x realtime)" << std::endl;
+    return 0;
+}
@@ -0,0 +1,284 @@
+/*
+  ==============================================================================
+
+    NoteRenderer.cpp
+
+  ==============================================================================
+*/
+
+#include "NoteRenderer.h"
+
+juce::ValueTree loadPreset (const juce::File& file)
+{
+    if (auto xml = juce::XmlDocument::parse (file))
+        return juce::ValueTree::fromXml (*xml);
+
+    juce::MemoryBlock data;
+    if (file.loadFileAsData (data))
+        return juce::ValueTree::readFromData (data.getData(), data.getSize());
+    return {};
+}
+
+std::vector<RenderNote> getRenderNotes (const juce::MidiFile& midiFile)
+{
+    juce::MidiFile file (midiFile);
+    file.convertTimestampTicksToSeconds();
+    auto endTime = file.getLastTimestamp();
+
+    std::vector<RenderNote> notes;
+    for (int t = 0; t < file.getNumTracks(); ++t)
+    {
+        juce::MidiMessageSequence track (*file.getTrack (t));
+        track.updateMatchedPairs();
+        for (int i = 0; i < track.getNumEvents(); ++i)
+        {
+            const auto& message = track.getEventPointer (i)->message;
+            if (! message.isNoteOn())
+                continue;
+
+            auto start = message.getTimeStamp();
+            auto end = track.getEventPointer (i)->noteOffObject != nullptr ? track.getTimeOfMatchingKeyUp (i) : endTime;
+            notes.push_back ({start, juce::jmax (0.0, end - start)});
+        }
+    }
+
+    std::stable_sort (notes.begin(), notes.end(), [] (const RenderNote& a, const RenderNote& b) { return a.start < b.start; });
+    return notes;
+}
+
+static void preparePlate (ThinPlate& plate, const ChainSettings& chainSettings, const PlateOptions& options, const RenderSettings& renderSettings)
+{
+    // The bow envelope is set up for the current sample rate in updateParameters()
+    plate.getSampleRate (renderSettings.sampleRate / juce::jmax (1, renderSettings.plateRateDivider));
+    applyChainSettings (plate, chainSettings, options);
+    plate.setSubsystemRates (renderSettings.stringRateRatio, renderSettings.tubeRateRatio);
+}
+
+double estimateRenderCost (const ChainSettings& chainSettings, const PlateOptions& options, const RenderSettings& renderSettings, double length)
+{
+    ThinPlate plate (juce::jmax (1, renderSettings.plateRateDivider) / renderSettings.sampleRate);
+    preparePlate (plate, chainSettings, options, renderSettings);
+    plate.initParameters();
+    return static_cast<double> (plate.getNx()) * plate.getNy() * (length + renderSettings.tailSeconds);
+}
+
+// Where a checkpointed note continues
+struct NoteProgress
+{
+    int position = 0;
+    float prevOutput = 0, nextOutput = 0;
+    int rateCounter = 0;
+};
+
+static void saveCheckpoint (ThinPlate& plate, const juce::File& file, const RenderSettings& renderSettings, const NoteProgress& progress, const juce::AudioBuffer<float>& buffer)
+{
+    juce::MemoryOutputStream extraData;
+    extraData.writeInt64 (renderSettings.checkpointKey);
+    extraData.writeInt (buffer.getNumSamples());
+    extraData.writeInt (progress.position);
+    extraData.writeFloat (progress.prevOutput);
+    extraData.writeFloat (progress.nextOutput);
+    extraData.writeInt (progress.rateCounter);
+    extraData.write (buffer.getReadPointer (0), static_cast<size_t> (progress.position) * sizeof (float));
+
+    // A failed checkpoint only costs the time to render it again
+    auto result = savePlateSnapshot (plate, file, extraData.getMemoryBlock());
+    if (result.failed())
+        std::cerr << result.getErrorMessage() << std::endl;
+}
+
+static NoteProgress loadCheckpoint (ThinPlate& plate, const juce::File& file, const RenderSettings& renderSettings, juce::AudioBuffer<float>& buffer)
+{
+    juce::MemoryBlock extraData;
+    if (! file.existsAsFile() || loadPlateSnapshot (plate, file, &extraData).failed())
+        return {};
+
+    juce::MemoryInputStream stream (extraData, false);
+    NoteProgress progress;
+    auto key = stream.readInt64();
+    auto numSamples = stream.readInt();
+    progress.position = stream.readInt();
+    progress.prevOutput = stream.readFloat();
+    progress.nextOutput = stream.readFloat();
+    progress.rateCounter = stream.readInt();
+    auto numBytes = static_cast<int> (static_cast<size_t> (progress.position) * sizeof (float));
+    if (key != renderSettings.checkpointKey || numSamples != buffer.getNumSamples() || ! juce::isPositiveAndBelow (progress.position, numSamples + 1)
+        || stream.read (buffer.getWritePointer (0), numBytes) != numBytes)
+    {
+        return {}; // From another render. The plate is set up again by the caller
+    }
+    return progress;
+}
+
+static void startNote (ThinPlate& plate, const RenderSettings& renderSettings)
+{
+    plate.initParameters();
+    if (renderSettings.warmStart != juce::File() && loadPlateSnapshot (plate, renderSettings.warmStart).wasOk())
+    {
+        plate.startBow(); // Nothing if the snapshot was taken while bowing
+        return;
+    }
+    plate.plateHit();
+    plate.initParameters();
+    plate.startBow();
+}
+
+juce::AudioBuffer<float> renderNote (const ChainSettings& chainSettings, const PlateOptions& options, const RenderSettings& renderSettings, double length, const NoteFiles& noteFiles)
+{
+    auto fs = renderSettings.sampleRate;
+    auto plateRateDivider = juce::jmax (1, renderSettings.plateRateDivider);
+
+    auto createPlate = [&]
+    {
+        auto plate = std::make_unique<ThinPlate> (plateRateDivider / fs);
+        preparePlate (*plate, chainSettings, options, renderSettings);
+        startNote (*plate, renderSettings);
+        return plate;
+    };
+    auto plate = createPlate();
+
+    auto noteOffSample = juce::roundToInt (length * fs);
+    auto numSamples = noteOffSample + juce::roundToInt (renderSettings.tailSeconds * fs);
+    juce::AudioBuffer<float> buffer (1, juce::jmax (1, numSamples));
+    buffer.clear();
+    auto* channelData = buffer.getWritePointer (0);
+
+    NoteProgress progress;
+    if (noteFiles.checkpoint != juce::File())
+    {
+        progress = loadCheckpoint (*plate, noteFiles.checkpoint, renderSettings, buffer);
+        if (progress.position == 0)
+        {
+            // Whatever the checkpoint left in the plate and the buffer is thrown away
+            buffer.clear();
+            plate = createPlate();
+        }
+    }
+    auto checkpointSamples = juce::jmax (1, juce::roundToInt (renderSettings.checkpointSeconds * fs));
+
+    for (int i = progress.position; i < numSamples; ++i)
+    {
+        if (noteFiles.checkpoint != juce::File() && i > progress.position && i % checkpointSamples == 0)
+        {
+            auto current = progress;
+            current.position = i;
+            saveCheckpoint (*plate, noteFiles.checkpoint, renderSettings, current, buffer);
+        }
+        if (i == noteOffSample)
+        {
+            if (noteFiles.noteOffSnapshot != juce::File())
+            {
+                auto result = savePlateSnapshot (*plate, noteFiles.noteOffSnapshot);
+                if (result.failed())
+                    std::cerr << result.getErrorMessage() << std::endl;
+            }
+            plate->endBow();
+        }
+
+        float output;
+        if (plateRateDivider == 1)
+        {
+            plate->calculateScheme();
+            output = plate->getOutput();
+        }
+        else
+        {
+            // Same interpolation as the plugin when the plate runs at a reduced rate
+            if (progress.rateCounter == 0)
+            {
+                plate->calculateScheme();
+                progress.prevOutput = progress.nextOutput;
+                progress.nextOutput = plate->getOutput();
+            }
+            output = progress.prevOutput + (progress.nextOutput - progress.prevOutput) * progress.rateCounter / plateRateDivider;
+            progress.rateCounter = (progress.rateCounter + 1) % plateRateDivider;
+        }
+        channelData[i] = juce::jlimit (-1.0f, 1.0f, output);
+    }
+
+    // The finished note stays as a checkpoint until the whole render is written
+    if (noteFiles.checkpoint != juce::File() && progress.position < numSamples)
+    {
+        progress.position = numSamples;
+        saveCheckpoint (*plate, noteFiles.checkpoint, renderSettings, progress, buffer);
+    }
+    return buffer;
+}
+
+juce::Result checkSnapshot (const juce::File& file, const ChainSettings& chainSettings, const PlateOptions& options, const RenderSettings& renderSettings)
+{
+    ThinPlate plate (juce::jmax (1, renderSettings.plateRateDivider) / renderSettings.sampleRate);
+    preparePlate (plate, chainSettings, options, renderSettings);
+    plate.initParameters();
+    return loadPlateSnapshot (plate, file);
+}
+
+juce::File getCheckpointFile (const juce::File& checkpointFolder, int noteIndex)
+{
+    return checkpointFolder.getChildFile ("note" + juce::String (noteIndex) + ".plsnap");
+}
+
+juce::AudioBuffer<float> renderNotes (const std::vector<RenderNote>& notes, const ChainSettings& chainSettings, const PlateOptions& options, const RenderSettings& renderSettings, juce::ThreadPool& threadPool,
+                                      const juce::File& checkpointFolder, const juce::File& firstNoteOffSnapshot)
+{
+    auto numNotes = static_cast<int> (notes.size());
+    std::vector<juce::AudioBuffer<float>> noteBuffers (notes.size());
+
+    // Longest notes first, so a long note doesn't start last and keep one core busy on its own
+    std::vector<int> order (notes.size());
+    std::iota (order.begin(), order.end(), 0);
+    std::stable_sort (order.begin(), order.end(), [&notes] (int a, int b) { return notes[a].length > notes[b].length; });
+
+    std::atomic<int> remaining { numNotes };
+    juce::WaitableEvent finished;
+    for (auto n : order)
+    {
+        threadPool.addJob ([&, n]
+        {
+            NoteFiles noteFiles;
+            if (checkpointFolder != juce::File())
+                noteFiles.checkpoint = getCheckpointFile (checkpointFolder, n);
+            if (n == 0)
+                noteFiles.noteOffSnapshot = firstNoteOffSnapshot;
+            noteBuffers[n] = renderNote (chainSettings, options, renderSettings, notes[n].length, noteFiles);
+            if (--remaining == 0)
+                finished.signal();
+        });
+    }
+    if (numNotes > 0)
+        finished.wait();
+
+    // Mixed in note order, so the result doesn't depend on which thread finished first
+    int totalSamples = 1;
+    for (int n = 0; n < numNotes; ++n)
+        totalSamples = juce::jmax (totalSamples, juce::roundToInt (notes[n].start * renderSettings.sampleRate) + noteBuffers[n].getNumSamples());
+
+    juce::AudioBuffer<float> mix (1, totalSamples);
+    mix.clear();
+    for (int n = 0; n < numNotes; ++n)
+        mix.addFrom (0, juce::roundToInt (notes[n].start * renderSettings.sampleRate), noteBuffers[n], 0, 0, noteBuffers[n].getNumSamples());
+    return mix;
+}
+
+juce::Result writeAudioFile (const juce::File& file, const juce::AudioBuffer<float>& buffer, double sampleRate, int bitDepth)
+{
+    juce::AudioFormatManager formatManager;
+    formatManager.registerBasicFormats();
+    auto* format = formatManager.findFormatForFileExtension (file.getFileExtension());
+    if (format == nullptr)
+        return juce::Result::fail ("Unsupported audio file type: " + file.getFileName());
+
+    file.deleteFile();
+    std::unique_ptr<juce::FileOutputStream> stream (file.createOutputStream());
+    if (stream == nullptr)
+        return juce::Result::fail ("Can't write to " + file.getFullPathName());
+
+    std::unique_ptr<juce::AudioFormatWriter> writer (format->createWriterFor (stream.get(), sampleRate, static_cast<unsigned int> (buffer.getNumChannels()), bitDepth, {}, 0));
+    if (writer == nullptr)
+        return juce::Result::fail (format->getFormatName() + " doesn't support " + juce::String (bitDepth) + " bit at " + juce::String (sampleRate) + " Hz");
+    stream.release(); // Owned by the writer now
+
+    if (! writer->writeFromAudioSampleBuffer (buffer, 0, buffer.getNumSamples()))
+        return juce::Result::fail ("Writing " + file.getFullPathName() + " failed");
+    return juce::Result::ok();
+}
@@ -0,0 +1,68 @@
+/*
+  ==============================================================================
+
+    NoteRenderer.h
+
+    Offline rendering of plate notes. Every note gets its own plate, so notes are
+    independent of each other and can be rendered on separate threads.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "../../Source/PlateSettings.h"
+#include "../../Source/PlateSnapshot.h"
+
+struct RenderSettings
+{
+    double sampleRate = 48000;
+    double tailSeconds = 3; // Rendered after the note off
+    int plateRateDivider = 1;
+    int stringRateRatio = 1;
+    int tubeRateRatio = 1;
+    juce::File warmStart; // Plate snapshot every note starts from instead of silence
+    double checkpointSeconds = 30; // Rendered time between the checkpoints of a note
+    juce::int64 checkpointKey = 0; // Identifies the render, so checkpoints of another render are ignored
+};
+
+// Files of the render of one note, all optional
+struct NoteFiles
+{
+    juce::File checkpoint; // Progress of the note. A restarted render continues from it
+    juce::File noteOffSnapshot; // Plate state at the note off
+};
+
+struct RenderNote
+{
+    double start = 0; // In seconds
+    double length = 0;
+};
+
+// The plugin state as the host saves it, or the same tree as XML. Invalid if neither
+juce::ValueTree loadPreset (const juce::File& file);
+
+// Note ons and their matching note offs. Notes without a note off last until the end of the file
+std::vector<RenderNote> getRenderNotes (const juce::MidiFile& midiFile);
+
+// Plays a note on a new plate the way PlateAudioProcessor does: a hit and a bow start at the
+// note on and a bow end at the note off. Returns a mono buffer of length + tail
+juce::AudioBuffer<float> renderNote (const ChainSettings& chainSettings, const PlateOptions& options, const RenderSettings& renderSettings, double length, const NoteFiles& noteFiles = {});
+
+// Fails if the snapshot doesn't load into a plate with these settings
+juce::Result checkSnapshot (const juce::File& file, const ChainSettings& chainSettings, const PlateOptions& options, const RenderSettings& renderSettings);
+
+// Relative cost of renderNote(): grid points times the rendered time
+double estimateRenderCost (const ChainSettings& chainSettings, const PlateOptions& options, const RenderSettings& renderSettings, double length);
+
+// Renders the notes on the thread pool and mixes them at their start times. With a checkpoint
+// folder every note keeps its progress there (see NoteFiles). The state of the first note at
+// its note off is saved to firstNoteOffSnapshot if it is given
+juce::AudioBuffer<float> renderNotes (const std::vector<RenderNote>& notes, const ChainSettings& chainSettings, const PlateOptions& options, const RenderSettings& renderSettings, juce::ThreadPool& threadPool,
+                                      const juce::File& checkpointFolder = {}, const juce::File& firstNoteOffSnapshot = {});
+
+juce::File getCheckpointFile (const juce::File& checkpointFolder, int noteIndex);
+
+// Writes a WAV or FLAC file, depending on the extension
+juce::Result writeAudioFile (const juce::File& file, const juce::AudioBuffer<float>& buffer, double sampleRate, int bitDepth);
@@ -0,0 +1,223 @@
+/*
+  ==============================================================================
+
+    SweepRunner.cpp
+
+  ==============================================================================
+*/
+
+#include "SweepRunner.h"
+
+juce::Result SweepRunner::loadGrid (const juce::File& gridFile)
+{
+    auto xml = juce::XmlDocument::parse (gridFile);
+    if (xml == nullptr || ! xml->hasTagName ("SWEEP"))
+        return juce::Result::fail ("Can't read the sweep " + gridFile.getFullPathName());
+
+    gridText = xml->toString();
+    baseSettings = {};
+    baseOptions = {};
+    if (xml->hasAttribute ("preset"))
+    {
+        auto presetFile = gridFile.getParentDirectory().getChildFile (xml->getStringAttribute ("preset"));
+        auto state = loadPreset (presetFile);
+        if (! state.isValid())
+            return juce::Result::fail ("Can't read the preset " + presetFile.getFullPathName());
+        baseSettings = getChainSettings (state);
+        baseOptions = getPlateOptions (state);
+    }
+
+    noteLength = xml->getDoubleAttribute ("length", 1);
+    renderSettings.tailSeconds = xml->getDoubleAttribute ("tail", 3);
+    renderSettings.sampleRate = xml->getDoubleAttribute ("rate", 48000);
+    bitDepth = xml->getIntAttribute ("bits", 24);
+    format = xml->getStringAttribute ("format", "wav");
+
+    axes.clear();
+    for (auto* axisXml : xml->getChildWithTagNameIterator ("AXIS"))
+    {
+        Axis axis;
+        axis.id = axisXml->getStringAttribute ("id");
+
+        ChainSettings testSettings;
+        PlateOptions testOptions;
+        if (! setChainSetting (testSettings, axis.id, 0) && ! setPlateOption (testOptions, axis.id, 0))
+            return juce::Result::fail ("Unknown sweep parameter " + axis.id);
+
+        if (axisXml->hasAttribute ("values"))
+        {
+            for (const auto& value : juce::StringArray::fromTokens (axisXml->getStringAttribute ("values"), false))
+                if (value.isNotEmpty())
+                    axis.values.push_back (value.getFloatValue());
+        }
+        else
+        {
+            auto start = static_cast<float> (axisXml->getDoubleAttribute ("start"));
+            auto end = static_cast<float> (axisXml->getDoubleAttribute ("end"));
+            auto steps = juce::jmax (1, axisXml->getIntAttribute ("steps", 1));
+            for (int i = 0; i < steps; ++i)
+                axis.values.push_back (steps == 1 ? start : start + (end - start) * i / (steps - 1));
+        }
+
+        if (axis.values.empty())
+            return juce::Result::fail ("No values for the sweep parameter " + axis.id);
+        axes.push_back (axis);
+    }
+    return juce::Result::ok();
+}
+
+int SweepRunner::getNumRenders() const
+{
+    int numRenders = 1;
+    for (const auto& axis : axes)
+        numRenders *= static_cast<int> (axis.values.size());
+    return numRenders;
+}
+
+std::vector<float> SweepRunner::getValues (int index) const
+{
+    std::vector<float> values (axes.size());
+    for (int a = static_cast<int> (axes.size()) - 1; a >= 0; --a)
+    {
+        auto numValues = static_cast<int> (axes[a].values.size());
+        values[a] = axes[a].values[index % numValues];
+        index /= numValues;
+    }
+    return values;
+}
+
+void SweepRunner::getSettings (const std::vector<float>& values, ChainSettings& chainSettings, PlateOptions& options) const
+{
+    chainSettings = baseSettings;
+    options = baseOptions;
+    for (size_t a = 0; a < axes.size(); ++a)
+    {
+        if (! setChainSetting (chainSettings, axes[a].id, values[a]))
+            setPlateOption (options, axes[a].id, values[a]);
+    }
+}
+
+juce::String SweepRunner::getFileName (int index) const
+{
+    return "sweep_" + juce::String (index).paddedLeft ('0', 6) + "." + format;
+}
+
+std::set<int> SweepRunner::readProgress (const juce::File& progressFile) const
+{
+    std::set<int> done;
+    juce::StringArray lines;
+    progressFile.readLines (lines);
+    for (int i = 1; i < lines.size(); ++i) // Skip the header
+    {
+        auto fields = juce::StringArray::fromTokens (lines[i], ",", "\"");
+        if (fields.size() > 1 && progressFile.getSiblingFile (fields[1]).existsAsFile())
+            done.insert (fields[0].getIntValue());
+    }
+    return done;
+}
+
+juce::Result SweepRunner::run (const juce::File& outputFolder, int numThreads)
+{
+    auto created = outputFolder.createDirectory();
+    if (created.failed())
+        return created;
+
+    // The file indices only mean something for the grid that made them
+    auto gridCopy = outputFolder.getChildFile ("sweep.xml");
+    if (gridCopy.existsAsFile() && gridCopy.loadFileAsString() != gridText)
+        return juce::Result::fail (outputFolder.getFullPathName() + " holds the results of a different sweep");
+    gridCopy.replaceWithText (gridText);
+
+    auto progressFile = outputFolder.getChildFile ("progress.csv");
+    auto done = readProgress (progressFile);
+    if (! progressFile.existsAsFile())
+    {
+        juce::StringArray header { "index", "file" };
+        for (const auto& axis : axes)
+            header.add ("\"" + axis.id + "\"");
+        progressFile.replaceWithText (header.joinIntoString (",") + "\n");
+    }
+
+    // Largest renders first: with one shared queue this keeps every thread busy until the
+    // end, instead of one long render starting last
+    std::vector<Job> jobs;
+    auto numRenders = getNumRenders();
+    for (int index = 0; index < numRenders; ++index)
+    {
+        if (done.count (index) > 0)
+            continue;
+
+        ChainSettings chainSettings;
+        PlateOptions options;
+        getSettings (getValues (index), chainSettings, options);
+        jobs.push_back ({index, estimateRenderCost (chainSettings, options, renderSettings, noteLength)});
+    }
+    std::stable_sort (jobs.begin(), jobs.end(), [] (const Job& a, const Job& b) { return a.cost > b.cost; });
+
+    std::cout << numRenders << " renders, " << done.size() << " done before, " << jobs.size() << " to go on " << numThreads << " threads" << std::endl;
+    if (jobs.empty())
+        return juce::Result::ok();
+
+    juce::FileOutputStream progress (progressFile); // Appends
+    if (progress.failedToOpen())
+        return juce::Result::fail ("Can't write to " + progressFile.getFullPathName());
+
+    juce::CriticalSection progressLock;
+    juce::StringArray errors;
+    int numFinished = 0;
+    auto numJobs = static_cast<int> (jobs.size());
+    std::atomic<int> remaining { numJobs };
+    juce::WaitableEvent finished;
+    auto startTime = juce::Time::getMillisecondCounterHiRes();
+
+    juce::ThreadPool threadPool (juce::jmax (1, numThreads));
+    for (const auto& job : jobs)
+    {
+        threadPool.addJob ([&, index = job.index]
+        {
+            auto values = getValues (index);
+            ChainSettings chainSettings;
+            PlateOptions options;
+            getSettings (values, chainSettings, options);
+            auto buffer = renderNote (chainSettings, options, renderSettings, noteLength);
+
+            // Written under another name first, so a killed run never leaves a partial file
+            // behind that looks finished
+            auto file = outputFolder.getChildFile (getFileName (index));
+            auto partFile = outputFolder.getChildFile (file.getFileNameWithoutExtension() + ".part." + format);
+            auto result = writeAudioFile (partFile, buffer, renderSettings.sampleRate, bitDepth);
+            if (result.wasOk() && ! partFile.moveFileTo (file))
+                result = juce::Result::fail ("Can't rename " + partFile.getFullPathName());
+
+            {
+                const juce::ScopedLock sl (progressLock);
+                if (result.wasOk())
+                {
+                    juce::String line (index);
+                    line << "," << file.getFileName();
+                    for (auto value : values)
+                        line << "," << value;
+                    progress << line << "\n";
+                    progress.flush();
+                }
+                else
+                {
+                    errors.add (result.getErrorMessage());
+                }
+
+                ++numFinished;
+                auto elapsed = (juce::Time::getMillisecondCounterHiRes() - startTime) * 0.001;
+                std::cout << "\r" << numFinished << "/" << numJobs << ", " << juce::roundToInt (elapsed) << " s" << std::flush;
+            }
+
+            if (--remaining == 0)
+                finished.signal();
+        });
+    }
+    finished.wait();
+    std::cout << std::endl;
+
+    if (! errors.isEmpty())
+        return juce::Result::fail (errors.joinIntoString ("\n"));
+    return juce::Result::ok();
+}
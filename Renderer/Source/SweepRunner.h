@@ -0,0 +1,67 @@
+/*
+  ==============================================================================
+
+    SweepRunner.h
+
+    Renders every combination of a grid of parameter values, one note per file, e.g.
+
+        <SWEEP preset="base.xml" length="1" tail="3" rate="48000" bits="24" format="wav">
+          <AXIS id="plateMaterial" values="1 2 3 4 5 6 7"/>
+          <AXIS id="Plate thickness" start="4" end="20" steps="5"/>
+          <AXIS id="Number of Strings" values="0 2 4"/>
+        </SWEEP>
+
+    Axis ids are plugin parameter IDs or PlateOptions property names. Everything else comes
+    from the (optional) preset, with paths relative to the grid file.
+
+    Each finished file is logged in progress.csv in the output folder, together with its
+    parameter values, and a run into a folder with a log only renders what is missing.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "NoteRenderer.h"
+#include <set>
+
+class SweepRunner
+{
+public:
+    juce::Result loadGrid (const juce::File& gridFile);
+
+    int getNumRenders() const;
+
+    // Renders everything the progress log in the folder doesn't list yet
+    juce::Result run (const juce::File& outputFolder, int numThreads);
+
+private:
+    struct Axis
+    {
+        juce::String id;
+        std::vector<float> values;
+    };
+
+    struct Job
+    {
+        int index;
+        double cost;
+    };
+
+    // The axes are nested in file order, the last one changing fastest
+    std::vector<float> getValues (int index) const;
+    void getSettings (const std::vector<float>& values, ChainSettings& chainSettings, PlateOptions& options) const;
+
+    juce::String getFileName (int index) const;
+    std::set<int> readProgress (const juce::File& progressFile) const;
+
+    juce::String gridText;
+    std::vector<Axis> axes;
+    ChainSettings baseSettings;
+    PlateOptions baseOptions;
+    RenderSettings renderSettings;
+    double noteLength = 1;
+    int bitDepth = 24;
+    juce::String format = "wav";
+};
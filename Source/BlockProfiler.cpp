@@ -0,0 +1,139 @@
+/*
+  ==============================================================================
+
+    BlockProfiler.cpp
+
+  ==============================================================================
+*/
+
+#include "BlockProfiler.h"
+
+const char* BlockProfiler::getStageName (int stage)
+{
+    const char* names[] = { "parameters", "plate", "strings", "tube", "output", "block" };
+    return names[juce::jlimit (0, static_cast<int> (numStages), stage)];
+}
+
+BlockProfiler::BlockProfiler()
+{
+    fifoRecords.resize (fifoSize);
+    history.resize (historySize);
+}
+
+void BlockProfiler::startBlock()
+{
+    blockStart = juce::Time::getHighResolutionTicks();
+    stageStart = blockStart;
+    movedTicks = 0;
+    std::fill (std::begin (stageTicks), std::end (stageTicks), 0);
+}
+
+void BlockProfiler::endStage (Stage stage)
+{
+    auto now = juce::Time::getHighResolutionTicks();
+    stageTicks[stage] += now - stageStart - movedTicks;
+    stageStart = now;
+    movedTicks = 0;
+}
+
+void BlockProfiler::addStageTicks (Stage stage, juce::int64 ticks)
+{
+    stageTicks[stage] += ticks;
+    movedTicks += ticks;
+}
+
+void BlockProfiler::endBlock (int numSamples, double sampleRate)
+{
+    auto ticksPerMicro = juce::Time::getHighResolutionTicksPerSecond() * 1e-6;
+    BlockRecord record;
+    for (int s = 0; s < numStages; ++s)
+        record.micros[s] = static_cast<float> (stageTicks[s] / ticksPerMicro);
+    record.micros[numStages] = static_cast<float> ((juce::Time::getHighResolutionTicks() - blockStart) / ticksPerMicro);
+    record.budgetMicros = static_cast<float> (numSamples / sampleRate * 1e6);
+
+    lastLoad = record.micros[numStages] / record.budgetMicros;
+    if (record.micros[numStages] > record.budgetMicros)
+        ++numOverruns;
+
+    // Blocks are dropped while nobody collects them
+    const juce::AbstractFifo::ScopedWrite write (fifo, 1);
+    if (write.blockSize1 > 0)
+        fifoRecords[static_cast<size_t> (write.startIndex1)] = record;
+}
+
+void BlockProfiler::collect()
+{
+    const juce::AbstractFifo::ScopedRead read (fifo, fifo.getNumReady());
+    auto add = [this] (int start, int size)
+    {
+        for (int i = start; i < start + size; ++i)
+        {
+            history[static_cast<size_t> (historyPos)] = fifoRecords[static_cast<size_t> (i)];
+            historyPos = (historyPos + 1) % historySize;
+            numHistory = juce::jmin (numHistory + 1, historySize);
+        }
+    };
+    add (read.startIndex1, read.blockSize1);
+    add (read.startIndex2, read.blockSize2);
+}
+
+BlockProfiler::Stats BlockProfiler::getStatsOf (std::vector<float>& values)
+{
+    Stats stats;
+    if (values.empty())
+        return stats;
+
+    stats.mean = std::accumulate (values.begin(), values.end(), 0.0) / static_cast<double> (values.size());
+    auto p99 = values.begin() + static_cast<int> (0.99 * static_cast<double> (values.size() - 1));
+    std::nth_element (values.begin(), p99, values.end());
+    stats.p99 = *p99;
+    auto range = std::minmax_element (values.begin(), values.end());
+    stats.min = *range.first;
+    stats.max = *range.second;
+    return stats;
+}
+
+BlockProfiler::Stats BlockProfiler::getStats (int stage) const
+{
+    std::vector<float> values;
+    for (int i = 0; i < numHistory; ++i)
+        values.push_back (history[static_cast<size_t> (i)].micros[stage]);
+    return getStatsOf (values);
+}
+
+BlockProfiler::Stats BlockProfiler::getLoadStats() const
+{
+    std::vector<float> values;
+    for (int i = 0; i < numHistory; ++i)
+    {
+        const auto& record = history[static_cast<size_t> (i)];
+        values.push_back (100.0f * record.micros[numStages] / record.budgetMicros);
+    }
+    return getStatsOf (values);
+}
+
+juce::String BlockProfiler::getReport() const
+{
+    juce::String report;
+    auto load = getLoadStats();
+    report << "Blocks: " << numHistory << ", overruns: " << getNumOverruns() << "\n";
+    report << "Load (% of the block budget): mean " << juce::String (load.mean, 1) << ", p99 " << juce::String (load.p99, 1) << ", max " << juce::String (load.max, 1) << "\n\n";
+    report << "stage        min us    mean us   p99 us    max us\n";
+    for (int s = 0; s <= numStages; ++s)
+    {
+        auto stats = getStats (s);
+        report << juce::String (getStageName (s)).paddedRight (' ', 13)
+               << juce::String (stats.min, 1).paddedRight (' ', 10)
+               << juce::String (stats.mean, 1).paddedRight (' ', 10)
+               << juce::String (stats.p99, 1).paddedRight (' ', 10)
+               << juce::String (stats.max, 1) << "\n";
+    }
+    return report;
+}
+
+void BlockProfiler::reset()
+{
+    numOverruns = 0;
+    historyPos = 0;
+    numHistory = 0;
+}
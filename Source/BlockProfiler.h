@@ -0,0 +1,100 @@
+/*
+  ==============================================================================
+
+    BlockProfiler.h
+
+    Times the stages of every processBlock() call against the real-time budget of the
+    block (numSamples / fs). The audio thread pushes one record per block into a
+    lock-free FIFO; one other thread (the editor's timer) collects the records into a
+    history of the last blocks and reads the statistics from there.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+class BlockProfiler
+{
+public:
+    enum Stage
+    {
+        Parameters,
+        Plate, // Including the connection forces
+        Strings,
+        Tube,
+        Output,
+        numStages
+    };
+
+    static const char* getStageName (int stage);
+
+    struct Stats
+    {
+        double min = 0, mean = 0, p99 = 0, max = 0; // In microseconds
+    };
+
+    BlockProfiler();
+
+    //==============================================================================
+    // Audio thread
+
+    void startBlock();
+
+    // Ends the current stage and starts the next one
+    void endStage (Stage stage);
+
+    // Time measured elsewhere, e.g. the strings inside the plate update. It is moved out of the stage ending next
+    void addStageTicks (Stage stage, juce::int64 ticks);
+
+    void endBlock (int numSamples, double sampleRate);
+
+    // Time of the last ended block as a ratio of its budget
+    float getLastLoad() const { return lastLoad; }
+
+    //==============================================================================
+    // Reader thread
+
+    // Moves the pushed blocks into the history
+    void collect();
+
+    int getNumBlocks() const { return numHistory; }
+    int getNumOverruns() const { return numOverruns.load(); }
+
+    // Over the history. Stage numStages is the whole block
+    Stats getStats (int stage) const;
+
+    // Mean, p99 and max of the block time as a percentage of the budget
+    Stats getLoadStats() const;
+
+    juce::String getReport() const;
+
+    // Clears the history and the overrun counter
+    void reset();
+
+private:
+    struct BlockRecord
+    {
+        float micros[numStages + 1]; // The stages and the whole block
+        float budgetMicros;
+    };
+
+    static Stats getStatsOf (std::vector<float>& values);
+
+    static constexpr int fifoSize = 1024;
+    static constexpr int historySize = 4096;
+
+    juce::AbstractFifo fifo { fifoSize };
+    std::vector<BlockRecord> fifoRecords;
+
+    juce::int64 blockStart = 0, stageStart = 0;
+    juce::int64 stageTicks[numStages] = {};
+    juce::int64 movedTicks = 0;
+    float lastLoad = 0;
+
+    std::vector<BlockRecord> history;
+    int historyPos = 0, numHistory = 0;
+
+    std::atomic<int> numOverruns { 0 };
+};
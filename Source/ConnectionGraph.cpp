@@ -0,0 +1,203 @@
+/*
+  ==============================================================================
+
+    ConnectionGraph.cpp
+
+  ==============================================================================
+*/
+
+#include "ConnectionGraph.h"
+
+static bool isSamePoint (const ConnectionPoint& p1, const ConnectionPoint& p2)
+{
+    return p1.object == p2.object && p1.index == p2.index && p1.l == p2.l && p1.m == p2.m;
+}
+
+void ConnectionGraph::clear()
+{
+    connections.clear();
+    halfStep.clear();
+    extraCouplings.clear();
+    rowStart.assign (1, 0);
+    colIdx.clear();
+    offDiag.clear();
+}
+
+int ConnectionGraph::addConnection (const Connection& connectionToAdd, bool halfStepToUse)
+{
+    connections.push_back (connectionToAdd);
+    halfStep.push_back (halfStepToUse);
+    return getNumConnections() - 1;
+}
+
+void ConnectionGraph::addCoupling (int i, int j, double value)
+{
+    extraCouplings.push_back ({i, j, value});
+}
+
+void ConnectionGraph::prepare (double fsToSet)
+{
+    fs = fsToSet;
+    auto numConn = getNumConnections();
+
+    etaNext.assign (numConn, 0);
+    eta.assign (numConn, 0);
+    etaPrev.assign (numConn, 0);
+    force.assign (numConn, 0);
+    psi.assign (numConn, 0);
+    gain.assign (numConn, 0);
+    diag.assign (numConn, 0);
+    rhs.assign (numConn, 0);
+    massDiag.assign (numConn, 0);
+
+    rowStart.assign (numConn + 1, 0);
+    colIdx.clear();
+    offDiag.clear();
+
+    for (int i = 0; i < numConn; ++i)
+    {
+        const auto& ci = connections[i];
+        massDiag[i] = ci.b.massTerm + ci.a.massTerm;
+
+        for (int j = 0; j < numConn; ++j)
+        {
+            if (j == i)
+                continue;
+
+            // Sum of sign_i * sign_j * massTerm over the points shared by i and j
+            const auto& cj = connections[j];
+            double coupling = 0;
+            if (isSamePoint (ci.a, cj.a))
+                coupling += ci.a.massTerm;
+            if (isSamePoint (ci.a, cj.b))
+                coupling -= ci.a.massTerm;
+            if (isSamePoint (ci.b, cj.a))
+                coupling -= ci.b.massTerm;
+            if (isSamePoint (ci.b, cj.b))
+                coupling += ci.b.massTerm;
+            for (const auto& extra : extraCouplings)
+                if (extra.i == i && extra.j == j)
+                    coupling += extra.value;
+
+            if (coupling != 0)
+            {
+                colIdx.push_back (j);
+                offDiag.push_back (coupling);
+            }
+        }
+        rowStart[i + 1] = static_cast<int> (colIdx.size());
+    }
+}
+
+void ConnectionGraph::setSpring (bool springToSet)
+{
+    for (auto& conn : connections)
+        conn.spring = springToSet;
+}
+
+void ConnectionGraph::resetForces()
+{
+    std::fill (force.begin(), force.end(), 0.0);
+    for (int i = 0; i < getNumConnections(); ++i)
+        psi[i] = std::sqrt (0.5 * connections[i].K3) * etaPrev[i] * etaPrev[i];
+}
+
+void ConnectionGraph::clearState()
+{
+    for (auto* values : { &etaNext, &eta, &etaPrev, &force, &psi })
+        std::fill (values->begin(), values->end(), 0.0);
+}
+
+void ConnectionGraph::writeState (juce::OutputStream& stream) const
+{
+    stream.writeInt (getNumConnections());
+    stream.write (force.data(), force.size() * sizeof (double));
+    stream.write (psi.data(), psi.size() * sizeof (double));
+}
+
+bool ConnectionGraph::readState (juce::InputStream& stream)
+{
+    if (stream.readInt() != getNumConnections())
+        return false;
+
+    auto numBytes = static_cast<int> (force.size() * sizeof (double));
+    return stream.read (force.data(), numBytes) == numBytes && stream.read (psi.data(), numBytes) == numBytes;
+}
+
+void ConnectionGraph::solve()
+{
+    auto numConn = getNumConnections();
+
+    for (int i = 0; i < numConn; ++i)
+    {
+        const auto& conn = connections[i];
+        if (conn.spring == true && halfStep[i] == true)
+        {
+            // F = K1 mean(eta) + R d/dt eta + g * mean(psi), with psi^n+1/2 = psi^n-1/2 + g * (etaNext - etaPrev)
+            auto root = std::sqrt (0.5 * conn.K3) * eta[i] * eta[i];
+            gain[i] = root > 0 ? conn.K3 * eta[i] * eta[i] * eta[i] / root : 0;
+            auto rPlus = 0.5 * conn.K1 + 0.5 * gain[i] * gain[i] + fs * conn.R;
+            auto rMinus = 0.5 * conn.K1 - 0.5 * gain[i] * gain[i] - fs * conn.R;
+            diag[i] = 1 / rPlus + conn.b.massTerm + conn.a.massTerm;
+            rhs[i] = etaNext[i] + (rMinus * etaPrev[i] + gain[i] * psi[i]) / rPlus;
+        }
+        else if (conn.spring == true)
+        {
+            auto rPlus = 0.5 * conn.K1 + 0.5 * conn.K3 * eta[i] * eta[i] + 0.5 * fs * conn.R;
+            auto rMinus = 0.5 * conn.K1 + 0.5 * conn.K3 * eta[i] * eta[i] - 0.5 * fs * conn.R;
+            diag[i] = 1 / rPlus + conn.b.massTerm + conn.a.massTerm;
+            rhs[i] = etaNext[i] + rMinus / rPlus * etaPrev[i];
+        }
+        else
+        {
+            diag[i] = massDiag[i];
+            rhs[i] = etaNext[i];
+        }
+    }
+
+    // No shared points: the system is diagonal
+    if (offDiag.empty())
+    {
+        for (int i = 0; i < numConn; ++i)
+            force[i] = rhs[i] / diag[i];
+    }
+    else
+    {
+        solveCoupled();
+    }
+
+    for (int i = 0; i < numConn; ++i)
+    {
+        const auto& conn = connections[i];
+        if (conn.spring == true && halfStep[i] == true)
+        {
+            auto rPlus = 0.5 * conn.K1 + 0.5 * gain[i] * gain[i] + fs * conn.R;
+            auto rMinus = 0.5 * conn.K1 - 0.5 * gain[i] * gain[i] - fs * conn.R;
+            auto etaHalfNext = (force[i] - rMinus * etaPrev[i] - gain[i] * psi[i]) / rPlus;
+            psi[i] += gain[i] * (etaHalfNext - etaPrev[i]);
+        }
+    }
+}
+
+void ConnectionGraph::solveCoupled()
+{
+    auto numConn = getNumConnections();
+    std::fill (force.begin(), force.end(), 0.0);
+    double eps = 1;
+    int it = 0;
+    while (eps > tol && it < maxIterations)
+    {
+        eps = 0;
+        for (int i = 0; i < numConn; ++i)
+        {
+            auto sum = rhs[i];
+            for (int idx = rowStart[i]; idx < rowStart[i + 1]; ++idx)
+                sum -= offDiag[idx] * force[colIdx[idx]];
+
+            auto forceNew = sum / diag[i];
+            eps = std::max (eps, std::abs (forceNew - force[i]) / (std::abs (forceNew) + 1e-30));
+            force[i] = forceNew;
+        }
+        ++it;
+    }
+}
@@ -0,0 +1,117 @@
+/*
+  ==============================================================================
+
+    ConnectionGraph.h
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+// Objects that a connection can be attached to
+enum class ConnectionObject
+{
+    Plate,
+    String,
+    Tube
+};
+
+// One end of a connection (discrete domain)
+struct ConnectionPoint
+{
+    ConnectionObject object;
+    int index; // which string (unused for plate and tube)
+    int l; // grid index along x (plate) or along the string/tube
+    int m; // grid index along y (plate only)
+    double massTerm; // k^2 / (rho * A * h * (1 + sigma0 * k)) of the object at this point
+};
+
+// Spring or rigid connection between two points. eta = a - b, the force pushes a down and b up
+struct Connection
+{
+    ConnectionPoint a;
+    ConnectionPoint b;
+    double K1, K3, R; // Linear stiffness, nonlinear stiffness and damping of the spring
+    bool spring; // false = rigid connection
+};
+
+//==============================================================================
+/*
+    Solves the connection forces of all connections for one time step as a single system.
+
+    Connections that share a grid point are coupled through the mass term of that point, so
+    the per-sample system is M * F = rhs with M = diag(1/rPlus) + B W B^T. The sparsity
+    pattern of B W B^T only depends on the layout and is assembled once in prepare().
+    The diagonal is updated every sample (the nonlinear spring depends on eta) and the system
+    is solved with Gauss-Seidel sweeps, which is a single pass if no points are shared.
+*/
+class ConnectionGraph
+{
+public:
+    void clear();
+
+    /*
+        A half step connection couples quantities one time step apart (eta^n+1/2 and eta^n-1/2 in
+        etaNext and etaPrev), with eta holding an estimate of eta^n. Its nonlinear stiffness is
+        written with the auxiliary variable psi = sqrt(K3 / 2) * eta^2, which keeps the force
+        linear in etaNext while conserving the energy of the spring exactly.
+    */
+    int addConnection (const Connection& connectionToAdd, bool halfStepToUse = false);
+
+    // Extra coupling of connection i to the force of connection j through points they do not share
+    // (e.g. through an implicitly solved plate). Call before prepare()
+    void addCoupling (int i, int j, double value);
+
+    // Assemble the coupling matrix. Call after the last addConnection()
+    void prepare (double fsToSet);
+
+    void setSpring (bool springToSet);
+
+    void resetForces();
+
+    // Puts all connections at rest, keeping the graph
+    void clearState();
+
+    // Forces (the start of the next Gauss-Seidel solve) and psi for a snapshot. Fails if the
+    // number of connections differs
+    void writeState (juce::OutputStream& stream) const;
+    bool readState (juce::InputStream& stream);
+
+    void solve();
+
+    int getNumConnections() const { return static_cast<int> (connections.size()); }
+
+    const Connection& getConnection (int i) const { return connections[i]; }
+
+    // Connection distances at n+1 (without connection forces), n and n-1. Filled by the caller before solve()
+    std::vector<double> etaNext, eta, etaPrev;
+    // Connection forces, valid after solve()
+    std::vector<double> force;
+
+private:
+    void solveCoupled();
+
+    std::vector<Connection> connections;
+    std::vector<bool> halfStep;
+    std::vector<double> psi; // Auxiliary energy variable of the half step connections
+    std::vector<double> gain;
+
+    struct Coupling
+    {
+        int i, j;
+        double value;
+    };
+    std::vector<Coupling> extraCouplings;
+
+    std::vector<double> massDiag; // Diagonal of B W B^T
+    std::vector<int> rowStart; // Off-diagonal part of B W B^T in CSR format
+    std::vector<int> colIdx;
+    std::vector<double> offDiag;
+    std::vector<double> diag, rhs;
+
+    double fs = 44100;
+    double tol = 1e-12;
+    int maxIterations = 50;
+};
@@ -0,0 +1,77 @@
+/*
+  ==============================================================================
+
+    HalfBandDecimator.cpp
+
+  ==============================================================================
+*/
+
+#include "HalfBandDecimator.h"
+
+// Modified Bessel function of the first kind and order zero, for the Kaiser window
+static double besselI0 (double x)
+{
+    double sum = 1, term = 1;
+    for (int k = 1; k < 50 && term > 1e-12 * sum; ++k)
+    {
+        term *= (0.5 * x / k) * (0.5 * x / k);
+        sum += term;
+    }
+    return sum;
+}
+
+void HalfBandDecimator::prepare (int numPairsToUse, double kaiserBeta)
+{
+    auto pi = juce::MathConstants<double>::pi;
+    numPairs = juce::jmax (1, numPairsToUse);
+
+    // 4 numPairs - 1 taps around the centre c = 2 numPairs - 1. The taps at an odd distance from
+    // the centre are 0.5 sinc ((n - c) / 2) times the window, the others are zero
+    auto numTaps = 2 * numPairs;
+    auto centre = 2 * numPairs - 1;
+    taps.resize (static_cast<size_t> (numTaps));
+    double sum = 0;
+    for (int j = 0; j < numTaps; ++j)
+    {
+        auto offset = 2 * j - centre;
+        auto ratio = static_cast<double> (offset) / centre;
+        auto window = besselI0 (kaiserBeta * std::sqrt (juce::jmax (0.0, 1 - ratio * ratio))) / besselI0 (kaiserBeta);
+        taps[static_cast<size_t> (j)] = std::sin (0.5 * pi * offset) / (pi * offset) * window;
+        sum += taps[static_cast<size_t> (j)];
+    }
+
+    // With the centre tap of 0.5 the gain at DC is exactly one
+    for (auto& tap : taps)
+        tap *= 0.5 / sum;
+
+    secondSamples.resize (static_cast<size_t> (2 * numTaps));
+    firstSamples.resize (static_cast<size_t> (numPairs));
+    reset();
+}
+
+void HalfBandDecimator::reset()
+{
+    std::fill (secondSamples.begin(), secondSamples.end(), 0.0);
+    std::fill (firstSamples.begin(), firstSamples.end(), 0.0);
+    secondPos = 0;
+    firstPos = 0;
+}
+
+float HalfBandDecimator::process (float first, float second)
+{
+    auto numTaps = static_cast<int> (taps.size());
+    secondPos = (secondPos + numTaps - 1) % numTaps;
+    secondSamples[static_cast<size_t> (secondPos)] = second;
+    secondSamples[static_cast<size_t> (secondPos + numTaps)] = second;
+
+    const auto* window = secondSamples.data() + secondPos;
+    double output = 0;
+    for (int j = 0; j < numTaps; ++j)
+        output += taps[static_cast<size_t> (j)] * window[j];
+
+    // The first sample numPairs - 1 pairs back sits at the centre tap
+    firstSamples[static_cast<size_t> (firstPos)] = first;
+    firstPos = (firstPos + 1) % numPairs;
+    output += 0.5 * firstSamples[static_cast<size_t> (firstPos)];
+    return static_cast<float> (output);
+}
@@ -0,0 +1,45 @@
+/*
+  ==============================================================================
+
+    HalfBandDecimator.h
+
+    Halves the sample rate of a signal with a linear phase half-band FIR, a Kaiser
+    windowed sinc with its cutoff at a quarter of the input rate. Apart from the centre
+    tap, every other tap of a half-band filter is zero, so the input splits into two
+    phases: the first sample of each pair only reaches the centre tap, and the second
+    goes through all the other taps.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+class HalfBandDecimator
+{
+public:
+    // Designs the filter with numPairs taps on each side of the centre that aren't zero, and
+    // clears it. The defaults pass 0.45 of the output rate's Nyquist frequency and take 90 dB
+    // off everything above 0.55 of it, which aliases back into the pass band
+    void prepare (int numPairsToUse = defaultNumPairs, double kaiserBeta = defaultKaiserBeta);
+
+    void reset();
+
+    // One output sample from the next two input samples, the earlier one first
+    float process (float first, float second);
+
+    // Delay of the output in output samples. The output is on the grid of the first samples
+    int getLatency() const { return numPairs - 1; }
+
+    static constexpr int defaultNumPairs = 32;
+    static constexpr double defaultKaiserBeta = 10;
+
+private:
+    int numPairs = 0;
+    std::vector<double> taps; // 2 numPairs taps of the second samples, newest first
+    std::vector<double> secondSamples; // Twice the taps, so the newest 2 numPairs are always in one piece
+    int secondPos = 0;
+    std::vector<double> firstSamples; // numPairs first samples, the oldest one at the centre tap
+    int firstPos = 0;
+};
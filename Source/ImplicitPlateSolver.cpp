@@ -0,0 +1,174 @@
+/*
+  ==============================================================================
+
+    ImplicitPlateSolver.cpp
+
+  ==============================================================================
+*/
+
+#include "ImplicitPlateSolver.h"
+
+void ImplicitPlateSolver::LineFactorisation::factorise (int size, double diag, double off1, double off2)
+{
+    d.assign (size, 0);
+    l1.assign (size, 0);
+    l2.assign (size, 0);
+
+    for (int i = 0; i < size; ++i)
+    {
+        if (i >= 2)
+            l2[i] = off2 / d[i - 2];
+        if (i >= 1)
+            l1[i] = (off1 - (i >= 2 ? l2[i] * l1[i - 1] * d[i - 2] : 0)) / d[i - 1];
+
+        d[i] = diag - (i >= 1 ? l1[i] * l1[i] * d[i - 1] : 0) - (i >= 2 ? l2[i] * l2[i] * d[i - 2] : 0);
+    }
+}
+
+void ImplicitPlateSolver::prepare (int NxToUse, int NyToUse, double c0ToUse, double aToUse, double bToUse)
+{
+    Nx = NxToUse;
+    Ny = NyToUse;
+    nx = std::max (0, Nx - 4);
+    ny = std::max (0, Ny - 4);
+    c0 = c0ToUse;
+    a = aToUse;
+    b = bToUse;
+
+    // 1D clamped operators: a * [1 -4 6 -4 1] - b * [1 -2 1]
+    lineX.factorise (nx, c0 + 6 * a + 2 * b, -4 * a - b, a);
+    lineY.factorise (ny, c0 + 6 * a + 2 * b, -4 * a - b, a);
+
+    r.assign (getSize(), 0);
+    z.assign (getSize(), 0);
+    p.assign (getSize(), 0);
+    q.assign (getSize(), 0);
+}
+
+void ImplicitPlateSolver::applyOperator (const std::vector<double>& in, std::vector<double>& out) const
+{
+    for (int l = 2; l < Nx - 2; ++l)
+    {
+        for (int m = 2; m < Ny - 2; ++m)
+        {
+            auto i = l * Ny + m;
+            auto cross = in[i + Ny] + in[i - Ny] + in[i + 1] + in[i - 1];
+            auto diagonals = in[i + Ny + 1] + in[i + Ny - 1] + in[i - Ny + 1] + in[i - Ny - 1];
+            auto far = in[i + 2 * Ny] + in[i - 2 * Ny] + in[i + 2] + in[i - 2];
+
+            out[i] = c0 * in[i]
+                + a * (20 * in[i] - 8 * cross + 2 * diagonals + far)
+                - b * (cross - 4 * in[i]);
+        }
+    }
+}
+
+void ImplicitPlateSolver::applyPreconditioner (const std::vector<double>& in, std::vector<double>& out)
+{
+    const auto& dY = lineY.d;
+    const auto& l1Y = lineY.l1;
+    const auto& l2Y = lineY.l2;
+
+    // Along y: each row is contiguous
+    for (int l = 2; l < Nx - 2; ++l)
+    {
+        const auto* src = &in[l * Ny + 2];
+        auto* dst = &out[l * Ny + 2];
+
+        dst[0] = src[0];
+        dst[1] = src[1] - l1Y[1] * dst[0];
+        for (int j = 2; j < ny; ++j)
+            dst[j] = src[j] - l1Y[j] * dst[j - 1] - l2Y[j] * dst[j - 2];
+        for (int j = 0; j < ny; ++j)
+            dst[j] /= dY[j];
+        dst[ny - 2] -= l1Y[ny - 1] * dst[ny - 1];
+        for (int j = ny - 3; j >= 0; --j)
+            dst[j] -= l1Y[j + 1] * dst[j + 1] + l2Y[j + 2] * dst[j + 2];
+    }
+
+    // Along x: substitute whole rows at once so the inner loops stay contiguous
+    const auto& dX = lineX.d;
+    const auto& l1X = lineX.l1;
+    const auto& l2X = lineX.l2;
+
+    for (int i = 1; i < nx; ++i)
+    {
+        auto* row = &out[(i + 2) * Ny + 2];
+        auto c1 = l1X[i];
+        auto c2 = i >= 2 ? l2X[i] : 0;
+        for (int j = 0; j < ny; ++j)
+            row[j] -= c1 * row[j - Ny] + (i >= 2 ? c2 * row[j - 2 * Ny] : 0);
+    }
+    for (int i = 0; i < nx; ++i)
+    {
+        auto* row = &out[(i + 2) * Ny + 2];
+        auto scale = c0 / dX[i];
+        for (int j = 0; j < ny; ++j)
+            row[j] *= scale;
+    }
+    for (int i = nx - 2; i >= 0; --i)
+    {
+        auto* row = &out[(i + 2) * Ny + 2];
+        auto c1 = l1X[i + 1];
+        auto c2 = i + 2 < nx ? l2X[i + 2] : 0;
+        for (int j = 0; j < ny; ++j)
+            row[j] -= c1 * row[j + Ny] + (i + 2 < nx ? c2 * row[j + 2 * Ny] : 0);
+    }
+}
+
+double ImplicitPlateSolver::dot (const std::vector<double>& x, const std::vector<double>& y) const
+{
+    double sum = 0;
+    for (int l = 2; l < Nx - 2; ++l)
+        for (int m = 2; m < Ny - 2; ++m)
+            sum += x[l * Ny + m] * y[l * Ny + m];
+    return sum;
+}
+
+int ImplicitPlateSolver::solve (const std::vector<double>& rhs, std::vector<double>& x)
+{
+    applyOperator (x, q);
+    for (int l = 2; l < Nx - 2; ++l)
+        for (int m = 2; m < Ny - 2; ++m)
+            r[l * Ny + m] = rhs[l * Ny + m] - q[l * Ny + m];
+
+    auto threshold = tol * tol * dot (rhs, rhs);
+    auto rr = dot (r, r);
+    if (rr <= threshold)
+        return 0;
+
+    applyPreconditioner (r, z);
+    p = z;
+    auto rz = dot (r, z);
+
+    int it = 0;
+    while (it < maxIterations)
+    {
+        ++it;
+        applyOperator (p, q);
+        auto alpha = rz / dot (p, q);
+        rr = 0;
+        for (int l = 2; l < Nx - 2; ++l)
+        {
+            for (int m = 2; m < Ny - 2; ++m)
+            {
+                auto i = l * Ny + m;
+                x[i] += alpha * p[i];
+                r[i] -= alpha * q[i];
+                rr += r[i] * r[i];
+            }
+        }
+
+        if (rr <= threshold)
+            break;
+
+        applyPreconditioner (r, z);
+        auto rzNew = dot (r, z);
+        auto beta = rzNew / rz;
+        rz = rzNew;
+        for (int l = 2; l < Nx - 2; ++l)
+            for (int m = 2; m < Ny - 2; ++m)
+                p[l * Ny + m] = z[l * Ny + m] + beta * p[l * Ny + m];
+    }
+    return it;
+}
@@ -0,0 +1,64 @@
+/*
+  ==============================================================================
+
+    ImplicitPlateSolver.h
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/*
+    Solves A x = b for the implicit (theta-scheme) plate update, where
+    A = c0 * I + a * D4 - b * D2 on the interior points of a clamped Nx x Ny grid.
+    D4 is the 13-point biharmonic and D2 the 5-point Laplacian stencil (both without 1/h^n).
+
+    Grids are stored flat (index l * Ny + m) including the two clamped rows/columns at every
+    edge, which must stay zero. The system is solved with conjugate gradients, preconditioned
+    by the line factorisation (c0 I + a Dxxxx - b Dxx)(c0 I + a Dyyyy - b Dyy) / c0 that
+    only misses the mixed derivative term. Both line operators are pentadiagonal and are
+    factorised once in prepare(), so a preconditioner pass is two banded substitutions.
+*/
+class ImplicitPlateSolver
+{
+public:
+    void prepare (int NxToUse, int NyToUse, double c0ToUse, double aToUse, double bToUse);
+
+    // x holds the initial guess and receives the solution. Returns the number of iterations
+    int solve (const std::vector<double>& rhs, std::vector<double>& x);
+
+    // out = A * in
+    void applyOperator (const std::vector<double>& in, std::vector<double>& out) const;
+
+    int getIndex (int l, int m) const { return l * Ny + m; }
+
+    int getSize() const { return Nx * Ny; }
+
+    void setTolerance (double relativeTolerance) { tol = relativeTolerance; }
+
+private:
+    // LDL^T factorisation of a symmetric pentadiagonal Toeplitz matrix
+    struct LineFactorisation
+    {
+        void factorise (int size, double diag, double off1, double off2);
+
+        std::vector<double> d, l1, l2;
+    };
+
+    void applyPreconditioner (const std::vector<double>& in, std::vector<double>& out);
+
+    double dot (const std::vector<double>& x, const std::vector<double>& y) const;
+
+    int Nx = 0, Ny = 0;
+    int nx = 0, ny = 0; // Interior points
+    double c0 = 1, a = 0, b = 0;
+
+    LineFactorisation lineX, lineY;
+    std::vector<double> r, z, p, q;
+
+    double tol = 1e-8;
+    int maxIterations = 100;
+};
@@ -0,0 +1,134 @@
+/*
+  ==============================================================================
+
+    NoteExpression.cpp
+
+  ==============================================================================
+*/
+
+#include "NoteExpression.h"
+
+void NoteExpression::prepare (double sampleRate, int maximumBlockSize)
+{
+    // One-pole smoothing with a 5 ms time constant, which removes the zipper steps of the 7-bit controls
+    smoothingCoefficient = (float) (1 - std::exp (-1 / (0.005 * sampleRate)));
+
+    forceScale.assign ((size_t) maximumBlockSize, 1);
+    velocityScale.assign ((size_t) maximumBlockSize, 1);
+    positionOffset.assign ((size_t) maximumBlockSize, 0);
+    reset();
+}
+
+void NoteExpression::reset()
+{
+    channels = {};
+    activeChannel = -1;
+    targets[0] = values[0] = 1;
+    targets[1] = values[1] = 1;
+    targets[2] = values[2] = 0;
+}
+
+void NoteExpression::renderNextBlock (const juce::MidiBuffer& midiMessages, int numSamples)
+{
+    // Hosts may send larger blocks than announced
+    if ((int) forceScale.size() < numSamples)
+    {
+        forceScale.resize ((size_t) numSamples, 1);
+        velocityScale.resize ((size_t) numSamples, 1);
+        positionOffset.resize ((size_t) numSamples, 0);
+    }
+
+    juce::MidiBuffer::Iterator iterator (midiMessages);
+    juce::MidiMessage message;
+    int samplePosition;
+    int startSample = 0;
+    while (iterator.getNextEvent (message, samplePosition))
+    {
+        samplePosition = juce::jlimit (startSample, numSamples, samplePosition);
+        renderSamples (startSample, samplePosition);
+        startSample = samplePosition;
+        handleMessage (message);
+    }
+    renderSamples (startSample, numSamples);
+}
+
+void NoteExpression::handleMessage (const juce::MidiMessage& message)
+{
+    auto channelIndex = message.getChannel() - 1;
+    if (! juce::isPositiveAndBelow (channelIndex, (int) channels.size()))
+        return;
+
+    auto& channel = channels[(size_t) channelIndex];
+    if (message.isNoteOn())
+    {
+        // The channel's controls are the ones of this note: sent since its last note off, or neutral
+        channel.note = message.getNoteNumber();
+        activeChannel = channelIndex;
+    }
+    else if (message.isNoteOff())
+    {
+        // MPE sends a note's initial controls just before its note on, so the controls of the old
+        // note go here rather than at the next note on. The bow keeps its targets while it releases
+        if (message.getNoteNumber() == channel.note)
+            channel = {};
+        return;
+    }
+    else if (message.isChannelPressure())
+    {
+        channel.pressure = (float) message.getChannelPressureValue() / 127;
+        channel.pressureSent = true;
+    }
+    else if (message.isAftertouch() && message.getNoteNumber() == channel.note)
+    {
+        channel.pressure = (float) message.getAfterTouchValue() / 127;
+        channel.pressureSent = true;
+    }
+    else if (message.isController() && message.getControllerNumber() == 74)
+    {
+        channel.slide = (float) message.getControllerValue() / 127;
+        channel.slideSent = true;
+    }
+    else if (message.isPitchWheel())
+    {
+        channel.bend = (float) (message.getPitchWheelValue() - 8192) / 8192;
+    }
+    else
+    {
+        return;
+    }
+
+    // Half pressure or slide plays the set bow force or velocity
+    if (activeChannel == channelIndex)
+    {
+        targets[0] = channel.pressureSent ? 2 * channel.pressure : 1;
+        targets[1] = channel.slideSent ? 2 * channel.slide : 1;
+        targets[2] = maxPositionOffset * channel.bend;
+    }
+}
+
+void NoteExpression::renderSamples (int startSample, int endSample)
+{
+    float* buffers[3] = { forceScale.data(), velocityScale.data(), positionOffset.data() };
+    for (int control = 0; control < 3; ++control)
+    {
+        auto* buffer = buffers[control];
+        auto target = targets[control];
+        auto value = values[control];
+
+        // Settled controls are filled without the filter, so neutral ones stay exactly neutral
+        if (value == target)
+        {
+            std::fill (buffer + startSample, buffer + endSample, target);
+            continue;
+        }
+
+        for (int i = startSample; i < endSample; ++i)
+        {
+            value += smoothingCoefficient * (target - value);
+            if (std::abs (target - value) < 1e-6f)
+                value = target;
+            buffer[i] = value;
+        }
+        values[control] = value;
+    }
+}
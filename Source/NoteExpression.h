@@ -0,0 +1,65 @@
+/*
+  ==============================================================================
+
+    NoteExpression.h
+
+    Per-note expression (MPE) for the bow. Every MIDI channel keeps its own pressure,
+    slide (CC 74) and pitch bend, and the channel of the last note on plays the bow,
+    as the plate has one excitation. Pressure scales the bow force, slide the bow
+    velocity, and pitch bend moves the bow position along the diagonal of the plate.
+
+    The controls are smoothed per sample and rendered into buffers for the whole block,
+    so the time resolution of the expression doesn't depend on the host's block size.
+    A control the controller never sent for the note stays neutral (scale 1, no offset),
+    so a plain keyboard plays the bow as before. A channel's controls are forgotten at the
+    note off of its note, so the next note on it starts from its own values.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+#include <vector>
+
+class NoteExpression
+{
+public:
+    void prepare (double sampleRate, int maximumBlockSize);
+
+    // Forgets the notes and controls
+    void reset();
+
+    // Reads the block's MIDI and fills the control buffers for its samples
+    void renderNextBlock (const juce::MidiBuffer& midiMessages, int numSamples);
+
+    // The controls at a sample of the last rendered block
+    float getForceScale (int sample) const { return forceScale[(size_t) sample]; }
+    float getVelocityScale (int sample) const { return velocityScale[(size_t) sample]; }
+    float getPositionOffset (int sample) const { return positionOffset[(size_t) sample]; }
+
+    // Bow position offset at full pitch bend (in ratios of the plate)
+    static constexpr float maxPositionOffset = 0.25f;
+
+private:
+    struct Channel
+    {
+        float pressure = 0, slide = 0, bend = 0; // 0 to 1, 0 to 1 and -1 to 1
+        bool pressureSent = false, slideSent = false;
+        int note = -1; // Last note on of the channel, for the polyphonic aftertouch
+    };
+
+    void handleMessage (const juce::MidiMessage& message);
+    void renderSamples (int startSample, int endSample);
+
+    std::array<Channel, 16> channels;
+    int activeChannel = -1;
+
+    // Targets of the smoothing, set by the active channel, and the smoothed values
+    float targets[3] = { 1, 1, 0 };
+    float values[3] = { 1, 1, 0 };
+    float smoothingCoefficient = 1;
+
+    std::vector<float> forceScale, velocityScale, positionOffset;
+};
@@ -0,0 +1,107 @@
+/*
+  ==============================================================================
+
+    PlateBuilder.cpp
+
+  ==============================================================================
+*/
+
+#include "PlateBuilder.h"
+#include "PlateKernelTuner.h"
+
+PlateBuilder::PlateBuilder() : juce::Thread ("Plate builder")
+{
+}
+
+PlateBuilder::~PlateBuilder()
+{
+    stop();
+}
+
+void PlateBuilder::start()
+{
+    if (! isThreadRunning())
+        startThread();
+}
+
+void PlateBuilder::stop()
+{
+    stopThread (10000); // Long enough for an implicit plate to finish solving its responses
+    plate.reset();
+    retired.reset();
+    state = Idle;
+}
+
+bool PlateBuilder::build (const Job& jobToBuild)
+{
+    if (state.load() != Idle)
+        return false;
+
+    job = jobToBuild;
+    buildPlate = true;
+    state = Working;
+    notify();
+    return true;
+}
+
+std::shared_ptr<ThinPlate> PlateBuilder::takePlate()
+{
+    if (state.load() != Ready)
+        return nullptr;
+
+    auto builtPlate = std::move (plate);
+    state = Idle;
+    return builtPlate;
+}
+
+bool PlateBuilder::release (std::shared_ptr<ThinPlate>& plateToRelease)
+{
+    if (state.load() != Idle)
+        return false;
+
+    retired = std::move (plateToRelease);
+    buildPlate = false;
+    state = Working;
+    notify();
+    return true;
+}
+
+void PlateBuilder::waitForJob()
+{
+    while (state.load() == Working && isThreadRunning())
+        jobDone.wait (10);
+}
+
+void PlateBuilder::run()
+{
+    while (! threadShouldExit())
+    {
+        if (state.load() == Working)
+        {
+            retired.reset();
+            if (buildPlate)
+            {
+                // The same steps as PlateAudioProcessor::prepareToPlay(), at the job's level
+                auto settings = job.settings;
+                QualityGovernor::limitSettings (job.level, settings);
+                if (job.offline)
+                    settings.gridScale = 1;
+                plate = std::make_shared<ThinPlate> (1 / job.plateRate);
+                plate->getSampleRate (job.plateRate);
+                plate->setSubsystemRates (job.stringRateRatio, job.tubeRateRatio);
+                plate->setStageTiming (true);
+                plate->setSymmetryReduction (true);
+                applyChainSettings (*plate, settings, job.options);
+                QualityGovernor::limitPlate (job.level, *plate, settings);
+                plate->setPlateThreads (job.plateThreads);
+                plate->setPlateKernel (job.kernel);
+                plate->initParameters();
+                if (job.offline)
+                    selectPlateKernel (*plate, job.plateRate);
+            }
+            state = buildPlate ? Ready : Idle;
+            jobDone.signal();
+        }
+        wait (-1);
+    }
+}
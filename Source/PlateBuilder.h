@@ -0,0 +1,91 @@
+/*
+  ==============================================================================
+
+    PlateBuilder.h
+
+    Sets up plates on a background thread, so the audio thread can switch to a plate of
+    another quality level or profile without running initParameters() itself, or starting
+    and stopping the row threads of the offline profile. The audio thread hands over a job
+    and takes the plate once it is set up, and gives the plates it no longer needs back to
+    be freed. It doesn't allocate, and only waits in offline rendering (waitForJob()): a job
+    is only taken while the thread is idle, and the thread only touches the job and the
+    plates while it has one.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "PlateSettings.h"
+#include "QualityGovernor.h"
+
+class PlateBuilder  : private juce::Thread
+{
+public:
+    // Everything the processor sets before the plate's first initParameters()
+    struct Job
+    {
+        ChainSettings settings; // As set, the builder limits them to the level
+        PlateOptions options;
+        int level = QualityGovernor::FullQuality;
+        double plateRate = 44100; // Plate steps per second
+        int stringRateRatio = 1, tubeRateRatio = 1;
+        ThinPlate::PlateKernel kernel = ThinPlate::RowKernel;
+        
+        // The offline profile: the full grid with the explicit scheme, split over plateThreads
+        // threads, with the kernel timed for the grid instead of kernel
+        bool offline = false;
+        int plateThreads = 1;
+    };
+
+    PlateBuilder();
+    ~PlateBuilder() override;
+
+    //==============================================================================
+    // Message thread (prepareToPlay() and releaseResources())
+
+    void start();
+
+    // Waits for a plate that is being set up, and frees the plates the builder holds
+    void stop();
+
+    //==============================================================================
+    // Audio thread
+
+    // Starts setting up a plate. Returns false while the last job hasn't finished or its plate
+    // hasn't been taken
+    bool build (const Job& jobToBuild);
+
+    // The plate of the last job once it is set up, or nullptr
+    std::shared_ptr<ThinPlate> takePlate();
+
+    // Frees the plate on the builder thread. Returns false, and leaves the plate, while the
+    // builder is busy
+    bool release (std::shared_ptr<ThinPlate>& plateToRelease);
+
+    bool isIdle() const { return state.load() == Idle; }
+    
+    // Waits until the builder has finished its job. Only for offline rendering, where the audio
+    // thread has no deadline
+    void waitForJob();
+
+private:
+    void run() override;
+
+    enum State
+    {
+        Idle, // The audio thread can hand over a job
+        Working, // The builder thread owns the job and the plates
+        Ready // The plate is set up and waits for takePlate()
+    };
+    std::atomic<int> state { Idle };
+    juce::WaitableEvent jobDone;
+
+    Job job;
+    bool buildPlate = false; // The job is a plate to set up, not only a plate to free
+    std::shared_ptr<ThinPlate> plate; // The plate set up for the job
+    std::shared_ptr<ThinPlate> retired; // The plate to free
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (PlateBuilder)
+};
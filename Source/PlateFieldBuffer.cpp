@@ -0,0 +1,42 @@
+/*
+  ==============================================================================
+
+    PlateFieldBuffer.cpp
+
+  ==============================================================================
+*/
+
+#include "PlateFieldBuffer.h"
+
+PlateFieldBuffer::PlateFieldBuffer()
+{
+    for (auto& frame : frames)
+        frame.values.resize (maxPoints * maxPoints);
+}
+
+void PlateFieldBuffer::write (ThinPlate& plate)
+{
+    if (! frameRequested.exchange (false))
+        return;
+
+    auto& frame = frames[back];
+    auto stepX = (plate.getNx() + maxPoints - 1) / maxPoints;
+    auto stepY = (plate.getNy() + maxPoints - 1) / maxPoints;
+    frame.nx = (plate.getNx() + stepX - 1) / stepX;
+    frame.ny = (plate.getNy() + stepY - 1) / stepY;
+    auto* value = frame.values.data();
+    for (int i = 0; i < frame.nx; ++i)
+        for (int j = 0; j < frame.ny; ++j)
+            *value++ = static_cast<float> (plate.getDisplacement (i * stepX, j * stepY));
+
+    back = middle.exchange (back | newFrameFlag) & ~newFrameFlag;
+}
+
+const PlateFieldBuffer::Frame* PlateFieldBuffer::read()
+{
+    if ((middle.load() & newFrameFlag) == 0)
+        return nullptr;
+
+    front = middle.exchange (front) & ~newFrameFlag;
+    return &frames[front];
+}
@@ -0,0 +1,50 @@
+/*
+  ==============================================================================
+
+    PlateFieldBuffer.h
+
+    Hands copies of the plate displacement from the audio thread to the editor through a
+    triple buffer: the audio thread fills the back frame and swaps it with the middle one,
+    the editor swaps the middle frame with its front one when a new frame is there. Neither
+    side locks or waits. The audio thread only copies a frame after the editor has asked
+    for one, so it copies at most once per UI frame and not at all without an editor.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "ThinPlate.h"
+
+class PlateFieldBuffer
+{
+public:
+    static constexpr int maxPoints = 64; // Per side. Larger grids are decimated
+
+    struct Frame
+    {
+        std::vector<float> values; // u^n, x major
+        int nx = 0, ny = 0;
+    };
+
+    PlateFieldBuffer();
+
+    // Audio thread
+    void write (ThinPlate& plate);
+
+    // Editor
+    void requestFrame() { frameRequested = true; }
+
+    // The newest frame if one was written since the last call, otherwise nullptr
+    const Frame* read();
+
+private:
+    static constexpr int newFrameFlag = 4;
+
+    Frame frames[3];
+    std::atomic<int> middle { 1 }; // Index of the middle frame, with newFrameFlag if it hasn't been read
+    int back = 0; // Audio thread
+    int front = 2; // Editor
+    std::atomic<bool> frameRequested { false };
+};
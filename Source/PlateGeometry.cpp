@@ -0,0 +1,377 @@
+/*
+  ==============================================================================
+
+    PlateGeometry.cpp
+
+  ==============================================================================
+*/
+
+#include "PlateGeometry.h"
+#include <math.h>
+
+const char* PlateGeometry::getShapeName (int shape)
+{
+    switch (shape)
+    {
+        case Rectangle: return "rectangle";
+        case Disc: return "disc";
+        case Notched: return "notched";
+        default: return "";
+    }
+}
+
+juce::MemoryBlock PlateGeometry::Settings::getKey() const
+{
+    juce::MemoryOutputStream stream;
+    for (auto value : { k, E, H, nu, rho, sigma0, sigma1, Lx, Ly, implicitScheme || 1 < gridScale ? gridScale : 0.0 })
+        stream.writeDouble (value);
+    stream.writeBool (implicitScheme);
+    stream.writeInt (implicitScheme ? Rectangle : plateShape);
+
+    stream.writeInt (numStrings);
+    if (0 < numStrings)
+    {
+        stream.writeInt (stringRatio);
+        for (auto value : { LS, rS, rhoS, ES, sigma0S, sigma1S, TavgS, TDiffS, sPosSpread })
+            stream.writeDouble (value);
+    }
+
+    stream.writeBool (tubeConn);
+    if (tubeConn)
+    {
+        stream.writeInt (tubeRatio);
+        stream.writeInt (shape);
+        for (auto value : { cLT, bLT, cRT, bRT })
+            stream.writeDouble (value);
+    }
+    return stream.getMemoryBlock();
+}
+
+bool PlateGeometry::Settings::hasSameKey (const Settings& other) const
+{
+    auto keyGridScale = [] (const Settings& s) { return s.implicitScheme || 1 < s.gridScale ? s.gridScale : 0.0; };
+    if (k != other.k || E != other.E || H != other.H || nu != other.nu || rho != other.rho || sigma0 != other.sigma0
+        || sigma1 != other.sigma1 || Lx != other.Lx || Ly != other.Ly || keyGridScale (*this) != keyGridScale (other)
+        || implicitScheme != other.implicitScheme || (implicitScheme ? Rectangle : plateShape) != (other.implicitScheme ? Rectangle : other.plateShape))
+        return false;
+
+    if (numStrings != other.numStrings)
+        return false;
+    if (0 < numStrings && (stringRatio != other.stringRatio || LS != other.LS || rS != other.rS || rhoS != other.rhoS || ES != other.ES
+                           || sigma0S != other.sigma0S || sigma1S != other.sigma1S || TavgS != other.TavgS || TDiffS != other.TDiffS
+                           || sPosSpread != other.sPosSpread))
+        return false;
+
+    if (tubeConn != other.tubeConn)
+        return false;
+    return ! tubeConn || (tubeRatio == other.tubeRatio && shape == other.shape && cLT == other.cLT && bLT == other.bLT
+                          && cRT == other.cRT && bRT == other.bRT);
+}
+
+PlateGeometry::PlateGeometry (const Settings& settingsToUse) : settings (settingsToUse)
+{
+    calculatePlate();
+    calculateShape();
+    if (0 < settings.numStrings)
+        calculateStrings();
+    if (settings.tubeConn)
+        calculateTube();
+}
+
+void PlateGeometry::calculatePlate()
+{
+    const auto& s = settings;
+    D = s.E*pow(s.H,3)/(12*(1-pow(s.nu,2))); // stifness coefficient
+    kappa = sqrt(D/(s.rho*s.H)); // stifness paramater
+    h = 2*sqrt(s.k*(s.sigma1+sqrt(pow(kappa,2)+pow(s.sigma1,2))));
+    // The theta scheme is stable for any grid spacing, the explicit scheme for any coarser one
+    if (s.implicitScheme == true || 1 < s.gridScale)
+    {
+        h = s.gridScale * h;
+    }
+    Nx = floor(s.Lx/h); //grid steps (x)
+    Ny = floor(s.Ly/h); //grid steps (y)
+    if (s.implicitScheme == true)
+    {
+        Nx = std::max(Nx, 6);
+        Ny = std::max(Ny, 6);
+    }
+    h = std::min (s.Lx / Nx, s.Ly / Ny); //redefine grid spacing (using the smallest dimension)
+    N = (Nx+1)*(Ny+1);
+    
+    mu = kappa*s.k/pow(h,2);
+    muSq = mu * mu;
+    S = 2 * s.sigma1 * s.k /pow(h,2);
+    
+    hx = s.Lx/Nx;
+    hy = s.Ly/Ny;
+    
+    plateConnTerm = (s.k*s.k)/(s.rho*s.H*h*h*(1+s.sigma0*s.k));
+}
+
+void PlateGeometry::calculateShape()
+{
+    // Distances from the centre relative to the clamped edge lines l = 1, l = Nx-2, m = 1 and m = Ny-2
+    const double lCentre = 0.5 * (Nx-1), mCentre = 0.5 * (Ny-1);
+    const double lRadius = std::max (lCentre - 1, 1.0), mRadius = std::max (mCentre - 1, 1.0);
+    const auto shape = settings.implicitScheme ? Rectangle : settings.plateShape;
+    auto isInside = [&] (int l, int m)
+    {
+        const double x = (l - lCentre) / lRadius, y = (m - mCentre) / mRadius;
+        switch (shape)
+        {
+            case Disc: return x*x + y*y < 1;
+            case Notched: return x <= 0 || y <= 0;
+            case Rectangle:
+            default: return true;
+        }
+    };
+
+    cellMask.assign (static_cast<size_t> (std::max (Nx * Ny, 0)), 0);
+    cellRuns.clear();
+    rowRuns.assign (1, 0);
+    numPlateCells = 0;
+    for (int l = 0; l < Nx; ++l)
+    {
+        int runBegin = -1;
+        for (int m = 2; m <= Ny-2; ++m)
+        {
+            const bool inside = m < Ny-2 && l >= 2 && l < Nx-2 && isInside (l, m);
+            if (inside)
+            {
+                cellMask[static_cast<size_t> (l * Ny + m)] = 1;
+                ++numPlateCells;
+                if (runBegin < 0)
+                    runBegin = m;
+            }
+            else if (runBegin >= 0)
+            {
+                cellRuns.push_back ({ runBegin, m });
+                runBegin = -1;
+            }
+        }
+        rowRuns.push_back (static_cast<int> (cellRuns.size()));
+    }
+
+    mirrorSymmetric = true;
+    for (int l = 0; l < Nx && mirrorSymmetric; ++l)
+        mirrorSymmetric = std::equal (cellMask.begin() + l * Ny, cellMask.begin() + (l+1) * Ny, cellMask.begin() + (Nx-1-l) * Ny);
+}
+
+void PlateGeometry::calculateStrings()
+{
+    const auto& s = settings;
+    const auto numStrings = s.numStrings;
+    kS = s.k / s.stringRatio;
+    
+    for (auto* table : { &TS, &NS, &cSSq, &hS, &lambdaSSq, &muSSq, &uS1, &uS2, &uS3, &stringConnTerm, &connXPos })
+        table->resize(numStrings);
+    lcS.resize(numStrings);
+    lcS2.resize(numStrings);
+    lcP.resize(numStrings);
+    
+    IS = M_PI * s.rS*s.rS*s.rS*s.rS / 4;
+    AS = M_PI * s.rS*s.rS;
+    kappaSSq = s.ES * IS / (s.rhoS * AS);
+    As = 1 + s.sigma0S * kS;
+    
+    connSPos = 0.1 * s.LS;
+    connSPos2 = s.LS - connSPos;
+    connYPos = s.Ly * 0.5 + s.LS * 0.4;
+    connYPos2 = s.Ly * 0.5 - s.LS * 0.4;
+    mcP = floor(connYPos/hy);
+    mcP2 = floor(connYPos2/hy);
+    
+    for (int nS = 0; nS < numStrings; ++nS)
+    {
+        if (nS == 0)
+        {
+            connXPos[nS] = s.Lx * 0.5;
+            TS[nS] = s.TavgS;
+        }
+        else if (nS % 2)
+        {
+            connXPos[nS] = s.Lx * 0.5 + s.Lx * 0.5 * nS/numStrings * s.sPosSpread/100;
+            TS[nS] = s.TavgS + s.TavgS*s.TDiffS/(200*nS);
+        }
+        else
+        {
+            connXPos[nS] = s.Lx * 0.5 - s.Lx * 0.5 * (nS-1)/numStrings * s.sPosSpread/100;
+            TS[nS] = s.TavgS - s.TavgS*s.TDiffS/(200*(nS-1));
+        }
+        cSSq[nS] = TS[nS] / (s.rhoS * AS);
+        hS[nS] = sqrt((cSSq[nS]  * kS*kS + 4 * s.sigma1S * kS + sqrt((cSSq[nS]  * kS*kS + 4 * s.sigma1S * kS)*(cSSq[nS]  * kS*kS + 4 * s.sigma1S * kS) + 16 * kappaSSq * kS*kS))/2);
+        NS[nS]  = floor(s.LS/hS[nS]);
+        hS[nS] = s.LS / NS[nS];
+        lambdaSSq[nS] = cSSq[nS]*kS*kS/(hS[nS]*hS[nS]);
+        muSSq[nS] = kappaSSq*kS*kS/(hS[nS]*hS[nS]*hS[nS]*hS[nS]);
+        uS1[nS]  = 2-2*lambdaSSq[nS]-6*muSSq[nS]-4*s.sigma1S*kS/(hS[nS]*hS[nS]);
+        uS2[nS] = lambdaSSq[nS]+4*muSSq[nS]+2*s.sigma1S*kS/(hS[nS]*hS[nS]);
+        uS3[nS] = -1+s.sigma0S*kS + 4*s.sigma1S*kS/(hS[nS]*hS[nS]);
+        
+        stringConnTerm[nS] = kS * kS / (s.rhoS * AS * hS[nS] * (1.0 + s.sigma0S * kS));
+        
+        lcS[nS]  = floor(connSPos/hS[nS]);
+        lcP[nS] = floor(connXPos[nS]/hx);
+        lcS2[nS]  = floor(connSPos2/hS[nS]);
+    }
+    NSMax = *std::max_element(NS.begin(), NS.end());
+}
+
+void PlateGeometry::calculateTube()
+{
+    const auto& s = settings;
+    kT = s.k / s.tubeRatio;
+    cT = 343;
+    rhoT = 1.225;
+    LT = s.cLT + s.bLT;
+    hT = cT *kT; // Stability limit of the tube at its own time step
+    nCT = floor(s.cLT/hT);
+    nBT = floor(s.bLT/hT);
+    NT = nCT + nBT;
+    hT = LT/NT;
+    lambdaT = cT*kT/hT;
+    ST.resize(NT+1,0);
+    calculateBoreShape();
+    R1 = rhoT*cT;
+    R2 = 0.505* rhoT*cT;
+    
+    Lr = 0.613*rhoT*sqrt(ST[NT]/juce::MathConstants<double>::pi);
+    Cr = 1.111* sqrt(ST[NT])/(rhoT*cT*cT*sqrt(juce::MathConstants<double>::pi));
+    zeta1=(2*R2*kT)/(2*R1*R2*Cr+kT*(R1+R2));
+    zeta2 = (2*R1*R2*Cr-kT*(R1+R2))/(2*R1*R2*Cr+kT*(R1+R2));
+    zeta3 = kT/(2*Lr)+zeta1/(2*R2)+(Cr*zeta1)/kT;
+    zeta4 = (zeta2+1)/(2*R2)+(Cr*zeta2-Cr)/kT;
+}
+
+void PlateGeometry::calculateBoreShape()
+{
+    const auto cRT = settings.cRT;
+    const auto bRT = settings.bRT;
+    std::vector<double> sC (nCT+1, 0);
+    std::vector<double> sB (nBT, 0);
+    for (int i = 0; i <= nCT; i++)
+    {
+        sC[i] = juce::MathConstants<double>::pi * cRT*cRT;
+    }
+    // if bell is linear
+    if(settings.shape == 1)
+    {
+        auto r = cRT;
+        auto rGrowth = (bRT - cRT) / nBT;
+        for (int i = 1; i<= nBT; i++)
+        {
+            r = r + rGrowth;
+            sB[i-1] = juce::MathConstants<double>::pi*r*r;
+        }
+    }
+    // if bell is exponential
+    else if(settings.shape == 2)
+    {
+        auto r = cRT;
+        auto rGrowth = exp(log(bRT/cRT)/nBT);
+        for (int i = 1; i<= nBT; i++)
+        {
+            r = cRT * pow(rGrowth,i);
+            sB[i-1] = juce::MathConstants<double>::pi*r*r;
+        }
+    }
+    // if bell is logarithmic
+    else if(settings.shape == 3)
+    {
+        auto r = cRT;
+        auto rGrowth = (bRT-cRT)/log(nBT);
+        for (int i = 1; i<= nBT; i++)
+        {
+            r = cRT + rGrowth * log(i);
+            sB[i-1] = juce::MathConstants<double>::pi*r*r;
+        }
+    }
+    sC.insert( sC.end(), sB.begin(), sB.end() );
+    
+    for (int i = 0; i <= NT; i++)
+        ST[i] = sC[i];
+}
+
+//==============================================================================
+namespace
+{
+    struct GeometryEntry
+    {
+        juce::MemoryBlock key;
+        std::weak_ptr<const PlateGeometry> geometry;
+    };
+
+    juce::SpinLock geometryLock;
+    std::map<juce::uint64, GeometryEntry> geometries;
+
+    juce::uint64 getHash (const juce::MemoryBlock& key)
+    {
+        // FNV-1a
+        juce::uint64 hash = 14695981039346656037ull;
+        for (size_t i = 0; i < key.getSize(); ++i)
+            hash = (hash ^ static_cast<juce::uint8> (key[i])) * 1099511628211ull;
+        return hash;
+    }
+
+    std::shared_ptr<const PlateGeometry> findGeometry (juce::uint64 hash, const juce::MemoryBlock& key)
+    {
+        auto entry = geometries.find (hash);
+        if (entry != geometries.end() && entry->second.key == key)
+            return entry->second.geometry.lock();
+        return {};
+    }
+}
+
+std::shared_ptr<const PlateGeometry> getPlateGeometry (const PlateGeometry::Settings& settings)
+{
+    /*
+        This can run on the audio thread, so it never waits for the table. If another plate holds
+        the lock, the geometry is built here and simply not shared. Nothing is built, allocated or
+        freed while the lock is held.
+    */
+    auto key = settings.getKey();
+    auto hash = getHash (key);
+    {
+        const juce::SpinLock::ScopedTryLockType lock (geometryLock);
+        if (lock.isLocked())
+            if (auto geometry = findGeometry (hash, key))
+                return geometry;
+    }
+
+    auto geometry = std::make_shared<const PlateGeometry> (settings);
+    std::map<juce::uint64, GeometryEntry> added { { hash, { key, geometry } } };
+    std::map<juce::uint64, GeometryEntry> dropped;
+
+    {
+        const juce::SpinLock::ScopedTryLockType lock (geometryLock);
+        if (! lock.isLocked())
+            return geometry;
+
+        if (auto other = findGeometry (hash, key))
+            return other; // Built by another plate in the meantime
+
+        // Drop the entries nobody holds any more. A hash collision keeps the older entry and leaves the new geometry unshared
+        for (auto it = geometries.begin(); it != geometries.end();)
+        {
+            auto next = std::next (it);
+            if (it->second.geometry.expired())
+                dropped.insert (geometries.extract (it));
+            it = next;
+        }
+
+        if (geometries.find (hash) == geometries.end())
+            geometries.insert (added.extract (hash));
+    }
+    return geometry;
+}
+
+int getNumSharedPlateGeometries()
+{
+    const juce::SpinLock::ScopedLockType lock (geometryLock);
+    int count = 0;
+    for (auto& entry : geometries)
+        if (! entry.second.geometry.expired())
+            ++count;
+    return count;
+}
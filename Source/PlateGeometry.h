@@ -0,0 +1,114 @@
+/*
+  ==============================================================================
+
+    PlateGeometry.h
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/*
+    Everything ThinPlate::initParameters() derives from its settings without touching the
+    state: plate stiffness and grid, string coefficients and connection points, and the
+    bore shape and radiation terms of the tube.
+
+    The plate shape is a mask over the Nx x Ny grid. Cells outside it are clamped: they stay at
+    zero like the two edge lines of the rectangle, so every cell inside uses the interior stencil.
+    The cells inside are listed as runs along each row, which the kernels loop over, so a disc
+    costs its area rather than its bounding box. The implicit scheme is always rectangular.
+
+    Geometries are immutable and shared. getPlateGeometry() keeps a process-wide table of the
+    geometries in use, keyed by a hash of the settings, so plates set up the same way (other
+    plugin instances, or the same instance after a new note) share one copy that is built
+    once. An entry lives as long as some plate holds it.
+*/
+struct PlateGeometry
+{
+    enum Shape
+    {
+        Rectangle,
+        Disc, // The ellipse inside the rectangle, with a clamped rim like a gong
+        Notched, // The rectangle without its quarter at large l and m
+        NumShapes
+    };
+
+    static const char* getShapeName (int shape);
+
+    struct Settings
+    {
+        double k = 0;
+        double E = 0, H = 0, nu = 0, rho = 0, sigma0 = 0, sigma1 = 0; // Plate material
+        double Lx = 0, Ly = 0;
+        int plateShape = Rectangle;
+        bool implicitScheme = false;
+        double gridScale = 1;
+
+        int numStrings = 0;
+        int stringRatio = 1;
+        double LS = 0, rS = 0, rhoS = 0, ES = 0, sigma0S = 0, sigma1S = 0, TavgS = 0, TDiffS = 0, sPosSpread = 0;
+
+        bool tubeConn = false;
+        int tubeRatio = 1;
+        double cLT = 0, bLT = 0, cRT = 0, bRT = 0;
+        int shape = 1; // Bell growth: 1 = linear, 2 = exponential, 3 = logarithmic
+
+        // The settings that take part in the geometry. String and tube settings are left out while they are off
+        juce::MemoryBlock getKey() const;
+
+        // True if getKey() would give the same key, without building it
+        bool hasSameKey (const Settings& other) const;
+    };
+
+    explicit PlateGeometry (const Settings& settingsToUse);
+
+    const Settings settings;
+
+    // Plate
+    double D, kappa, h, mu, muSq, S, hx, hy, plateConnTerm;
+    int Nx, Ny, N;
+
+    // Cells [mBegin, mEnd) of a row inside the shape
+    struct CellRun
+    {
+        int mBegin, mEnd;
+    };
+
+    // The runs of row l are cellRuns[rowRuns[l]] to cellRuns[rowRuns[l+1] - 1]. The mask is flat (l * Ny + m)
+    std::vector<CellRun> cellRuns;
+    std::vector<int> rowRuns;
+    std::vector<char> cellMask;
+    int numPlateCells = 0;
+    bool mirrorSymmetric = true; // Row l has the same cells as row Nx-1-l
+
+    // Strings, one entry per string
+    double kS, IS, AS, kappaSSq, As;
+    double connSPos, connSPos2, connYPos, connYPos2, mcP, mcP2;
+    std::vector<double> TS, NS, cSSq, hS, lambdaSSq, muSSq, uS1, uS2, uS3, stringConnTerm, connXPos;
+    std::vector<int> lcS, lcS2, lcP;
+    double NSMax = 0;
+
+    // Tube
+    double kT, cT, rhoT, LT, hT, lambdaT, R1, R2, Lr, Cr, zeta1, zeta2, zeta3, zeta4;
+    int nCT = 0, nBT = 0, NT = 0;
+    std::vector<double> ST; // Cross-sectional area at each grid point
+
+private:
+    void calculatePlate();
+    void calculateShape();
+    void calculateStrings();
+    void calculateTube();
+    void calculateBoreShape();
+
+    JUCE_DECLARE_NON_COPYABLE (PlateGeometry)
+};
+
+// The shared geometry for the settings. Thread safe and never waits: while another thread holds the
+// table, a new geometry is built and returned unshared
+std::shared_ptr<const PlateGeometry> getPlateGeometry (const PlateGeometry::Settings& settings);
+
+// Number of geometries currently held by some plate
+int getNumSharedPlateGeometries();
@@ -0,0 +1,40 @@
+/*
+  ==============================================================================
+
+    PlateHeatMap.cpp
+
+  ==============================================================================
+*/
+
+#include "PlateHeatMap.h"
+
+bool PlateHeatMap::update (PlateFieldBuffer& buffer)
+{
+    auto* frame = buffer.read();
+    if (frame == nullptr || frame->nx == 0 || frame->ny == 0)
+        return false;
+
+    if (image.getWidth() != frame->nx || image.getHeight() != frame->ny)
+        image = juce::Image (juce::Image::RGB, frame->nx, frame->ny, true);
+
+    auto numValues = static_cast<size_t> (frame->nx * frame->ny);
+    float peak = 0;
+    for (size_t i = 0; i < numValues; ++i)
+        peak = juce::jmax (peak, std::abs (frame->values[i]));
+
+    // Falls by about 20 dB a second at 30 frames per second
+    scale = juce::jmax (peak, scale * 0.93f);
+    auto gain = scale > 0 ? 1.0f / scale : 0.0f;
+
+    juce::Image::BitmapData pixels (image, juce::Image::BitmapData::writeOnly);
+    for (int i = 0; i < frame->nx; ++i)
+    {
+        for (int j = 0; j < frame->ny; ++j)
+        {
+            auto value = juce::jlimit (-1.0f, 1.0f, frame->values[static_cast<size_t> (i * frame->ny + j)] * gain);
+            auto level = static_cast<juce::uint8> (std::sqrt (std::abs (value)) * 255.0f);
+            pixels.setPixelColour (i, j, value >= 0 ? juce::Colour::fromRGB (level, 0, 0) : juce::Colour::fromRGB (0, 0, level));
+        }
+    }
+    return true;
+}
@@ -0,0 +1,30 @@
+/*
+  ==============================================================================
+
+    PlateHeatMap.h
+
+    Keeps an image of the plate displacement for the editor, one pixel per grid point
+    of the frames from the PlateFieldBuffer. Positive displacement is drawn red, negative
+    blue. The colour scale follows the loudest recent frame, so a decaying note stays
+    visible.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "PlateFieldBuffer.h"
+
+class PlateHeatMap
+{
+public:
+    // Takes the newest frame from the buffer, returns true if the image changed
+    bool update (PlateFieldBuffer& buffer);
+
+    const juce::Image& getImage() const { return image; }
+
+private:
+    juce::Image image;
+    float scale = 0;
+};
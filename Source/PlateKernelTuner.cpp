@@ -0,0 +1,115 @@
+/*
+  ==============================================================================
+
+    PlateKernelTuner.cpp
+
+  ==============================================================================
+*/
+
+#include "PlateKernelTuner.h"
+
+std::vector<KernelTiming> calibratePlateKernels (ThinPlate& plate)
+{
+    // About half a million point updates per run, a few milliseconds
+    auto numSteps = juce::jlimit (16, 4096, 500000 / juce::jmax (1, plate.getNx() * plate.getNy()));
+
+    std::vector<KernelTiming> timings;
+    for (int i = 0; i < ThinPlate::NumPlateKernels; ++i)
+        timings.push_back ({ static_cast<ThinPlate::PlateKernel> (i), 0.0 });
+
+    auto originalKernel = plate.getPlateKernel();
+
+    // The kernels take turns, so a change of clock speed halfway affects them all alike. Each gets its best run
+    for (int run = 0; run < 3; ++run)
+    {
+        for (auto& timing : timings)
+        {
+            plate.setPlateKernel (timing.kernel);
+            plate.calculateFullPlateUpdate();
+
+            auto start = juce::Time::getHighResolutionTicks();
+            for (int n = 0; n < numSteps; ++n)
+                plate.calculateFullPlateUpdate();
+            auto ns = juce::Time::highResolutionTicksToSeconds (juce::Time::getHighResolutionTicks() - start) / numSteps * 1e9;
+
+            if (run == 0 || ns < timing.nsPerStep)
+                timing.nsPerStep = ns;
+        }
+    }
+
+    plate.setPlateKernel (originalKernel);
+    std::sort (timings.begin(), timings.end(), [] (const KernelTiming& a, const KernelTiming& b) { return a.nsPerStep < b.nsPerStep; });
+    return timings;
+}
+
+juce::String getKernelCacheKey (ThinPlate& plate, double fs)
+{
+    return "v" + juce::String (kernelCacheFormat) + ", " + juce::SystemStats::getCpuModel() + ", " + juce::String (plate.getNx()) + "x" + juce::String (plate.getNy()) + ", " + juce::String (fs, 0) + " Hz";
+}
+
+juce::File getDefaultKernelCacheFile()
+{
+    return juce::File::getSpecialLocation (juce::File::userApplicationDataDirectory).getChildFile ("Plate").getChildFile ("PlateKernels.txt");
+}
+
+static bool findKernel (const juce::String& name, ThinPlate::PlateKernel& kernel)
+{
+    for (int i = 0; i < ThinPlate::NumPlateKernels; ++i)
+    {
+        if (name == ThinPlate::getPlateKernelName (static_cast<ThinPlate::PlateKernel> (i)))
+        {
+            kernel = static_cast<ThinPlate::PlateKernel> (i);
+            return true;
+        }
+    }
+    return false;
+}
+
+static juce::StringArray readCacheLines (const juce::File& cacheFile)
+{
+    juce::StringArray lines;
+    if (cacheFile.existsAsFile())
+        cacheFile.readLines (lines);
+    lines.removeEmptyStrings();
+    return lines;
+}
+
+bool findCachedPlateKernel (const juce::String& key, const juce::File& cacheFile, ThinPlate::PlateKernel& kernel)
+{
+    for (auto& line : readCacheLines (cacheFile))
+        if (line.upToFirstOccurrenceOf ("\t", false, false) == key && findKernel (line.fromFirstOccurrenceOf ("\t", false, false), kernel))
+            return true;
+    return false;
+}
+
+bool cachePlateKernel (const juce::String& key, ThinPlate::PlateKernel kernel, const juce::File& cacheFile)
+{
+    auto lines = readCacheLines (cacheFile);
+    for (int i = lines.size(); --i >= 0;)
+        if (lines[i].upToFirstOccurrenceOf ("\t", false, false) == key)
+            lines.remove (i);
+    lines.add (key + "\t" + ThinPlate::getPlateKernelName (kernel));
+
+    // Other instances may write the table at the same time. The file is replaced in one go, the last writer wins
+    if (! cacheFile.getParentDirectory().createDirectory())
+        return false;
+    juce::TemporaryFile temporaryFile (cacheFile);
+    return temporaryFile.getFile().replaceWithText (lines.joinIntoString ("\n") + "\n") && temporaryFile.overwriteTargetFileWithTemporary();
+}
+
+bool selectPlateKernel (ThinPlate& plate, double fs, const juce::File& cacheFile)
+{
+    auto key = getKernelCacheKey (plate, fs);
+    ThinPlate::PlateKernel kernel;
+    if (findCachedPlateKernel (key, cacheFile, kernel))
+    {
+        plate.setPlateKernel (kernel);
+        return false;
+    }
+
+    // A failed write only costs another calibration next time
+    kernel = calibratePlateKernels (plate).front().kernel;
+    plate.setPlateKernel (kernel);
+    cachePlateKernel (key, kernel, cacheFile);
+    return true;
+}
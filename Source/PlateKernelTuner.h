@@ -0,0 +1,49 @@
+/*
+  ==============================================================================
+
+    PlateKernelTuner.h
+
+    Picks the fastest ThinPlate::PlateKernel for a grid by timing each of them for a
+    moment, and keeps the winners in a small table on disk so the calibration is only paid
+    once per CPU model, grid size and sample rate. The table is a text file with a line
+    per entry:
+        <key> <tab> <kernel name>
+    Entries with an unknown kernel name are calibrated again, so a table written by
+    another version of the plugin does no harm.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "ThinPlate.h"
+
+struct KernelTiming
+{
+    ThinPlate::PlateKernel kernel;
+    double nsPerStep = 0;
+};
+
+// Times every kernel on the current grid of the plate, fastest first. Overwrites u^n+1,
+// so call it between time steps
+std::vector<KernelTiming> calibratePlateKernels (ThinPlate& plate);
+
+// Format of the table entries. Entries of another format are never found, so their grids are calibrated
+// again. 2: the kernels are timed on the whole grid, not on the active region of a plate at rest
+constexpr int kernelCacheFormat = 2;
+
+// Table format, CPU model, grid size and sample rate
+juce::String getKernelCacheKey (ThinPlate& plate, double fs);
+
+// PlateKernels.txt in the Plate folder of the user's application data
+juce::File getDefaultKernelCacheFile();
+
+bool findCachedPlateKernel (const juce::String& key, const juce::File& cacheFile, ThinPlate::PlateKernel& kernel);
+
+// Adds or replaces the entry for the key. Returns false if the table can't be written
+bool cachePlateKernel (const juce::String& key, ThinPlate::PlateKernel kernel, const juce::File& cacheFile);
+
+// Sets the cached kernel for the plate's grid, or calibrates and caches the fastest one.
+// Returns true if it had to calibrate
+bool selectPlateKernel (ThinPlate& plate, double fs, const juce::File& cacheFile = getDefaultKernelCacheFile());
@@ -0,0 +1,253 @@
+/*
+  ==============================================================================
+
+    PlateNetwork.cpp
+
+  ==============================================================================
+*/
+
+#include "PlateNetwork.h"
+#include <thread>
+
+//==============================================================================
+class PlateNetwork::Worker : public juce::Thread
+{
+public:
+    Worker (PlateNetwork& networkToUse, int plateIdxToUse)
+        : juce::Thread ("Plate worker " + juce::String (plateIdxToUse)), network (networkToUse), plateIdx (plateIdxToUse)
+    {
+    }
+
+    void run() override
+    {
+        while (! threadShouldExit())
+        {
+            if (startEvent.wait (100) == false || threadShouldExit())
+                continue;
+
+            network.runPlate (plateIdx, network.blockFirstStep, network.blockNumSamples);
+            finishedStep.store (network.blockFirstStep + network.blockNumSamples, std::memory_order_release);
+        }
+    }
+
+    juce::WaitableEvent startEvent;
+    std::atomic<juce::int64> finishedStep { 0 };
+
+private:
+    PlateNetwork& network;
+    int plateIdx;
+};
+
+//==============================================================================
+PlateNetwork::PlateNetwork (double kIn) : k (kIn)
+{
+}
+
+PlateNetwork::~PlateNetwork()
+{
+    releaseWorkers();
+}
+
+int PlateNetwork::addPlate()
+{
+    plates.push_back (std::make_unique<ThinPlate> (k));
+    plates.back()->getSampleRate (1.0 / k);
+    return getNumPlates() - 1;
+}
+
+int PlateNetwork::getPointIndex (int plateIdx, int l, int m)
+{
+    for (int i = 0; i < static_cast<int> (points.size()); ++i)
+        if (points[i].index == plateIdx && points[i].l == l && points[i].m == m)
+            return i;
+
+    points.push_back ({ConnectionObject::Plate, plateIdx, l, m, 0});
+    return static_cast<int> (points.size()) - 1;
+}
+
+void PlateNetwork::addLink (int plateA, int lA, int mA, int plateB, int lB, int mB, double K1, double K3, double R)
+{
+    auto pointA = getPointIndex (plateA, lA, mA);
+    auto pointB = getPointIndex (plateB, lB, mB);
+    links.push_back ({pointA, pointB, K1, K3, R});
+}
+
+void PlateNetwork::clearLinks()
+{
+    links.clear();
+    points.clear();
+}
+
+void PlateNetwork::prepare (int maxBlockSize)
+{
+    releaseWorkers();
+
+    auto numPlates = getNumPlates();
+    pointsOfPlate.assign (numPlates, {});
+    isLinked.assign (numPlates, false);
+
+    for (int i = 0; i < static_cast<int> (points.size()); ++i)
+    {
+        auto& point = points[i];
+        auto& plate = *plates[point.index];
+        // Keep the points away from the clamped boundaries
+        point.l = juce::jlimit (2, plate.getNx() - 3, point.l);
+        point.m = juce::jlimit (2, plate.getNy() - 3, point.m);
+        point.massTerm = plate.getPlateConnTerm (point.l, point.m);
+        pointsOfPlate[point.index].push_back (i);
+        isLinked[point.index] = true;
+    }
+
+    ConnectionGraph graph;
+    graph.clear();
+    for (auto& link : links)
+        graph.addConnection ({points[link.pointA], points[link.pointB], link.K1, link.K3, link.R, true});
+
+    // Plates using the implicit scheme also couple links at different points of the same plate
+    auto numLinks = static_cast<int> (links.size());
+    for (int i = 0; i < numLinks; ++i)
+    {
+        for (int j = 0; j < numLinks; ++j)
+        {
+            if (i == j)
+                continue;
+
+            double coupling = 0;
+            for (auto pi : { links[i].pointA, links[i].pointB })
+            {
+                for (auto pj : { links[j].pointA, links[j].pointB })
+                {
+                    if (pi == pj || points[pi].index != points[pj].index)
+                        continue;
+
+                    auto sign = (pi == links[i].pointA ? 1.0 : -1.0) * (pj == links[j].pointA ? 1.0 : -1.0);
+                    coupling += sign * plates[points[pi].index]->getPlateCoupling (points[pi].l, points[pi].m, points[pj].l, points[pj].m);
+                }
+            }
+            if (coupling != 0)
+                graph.addCoupling (i, j, coupling);
+        }
+    }
+    graph.prepare (1.0 / k);
+    graphs.assign (numPlates, graph);
+
+    for (auto& values : pointValues)
+        values.assign (3 * points.size(), 0);
+
+    currentStep = 0;
+    publishedStep.reset (new std::atomic<juce::int64>[numPlates]);
+    for (int i = 0; i < numPlates; ++i)
+        publishedStep[i].store (-1);
+
+    outputs.assign (numPlates, std::vector<float> (maxBlockSize, 0));
+
+    for (int i = 1; i < numPlates; ++i)
+    {
+        workers.push_back (std::make_unique<Worker> (*this, i));
+        workers.back()->startThread (juce::Thread::Priority::highest);
+    }
+}
+
+void PlateNetwork::releaseWorkers()
+{
+    for (auto& worker : workers)
+    {
+        worker->signalThreadShouldExit();
+        worker->startEvent.signal();
+    }
+    for (auto& worker : workers)
+        worker->stopThread (1000);
+
+    workers.clear();
+}
+
+void PlateNetwork::process (float* output, int numSamples)
+{
+    numSamples = std::min (numSamples, static_cast<int> (outputs.empty() ? 0 : outputs[0].size()));
+    blockFirstStep = currentStep;
+    blockNumSamples = numSamples;
+
+    for (auto& worker : workers)
+        worker->startEvent.signal();
+
+    if (0 < getNumPlates())
+        runPlate (0, blockFirstStep, numSamples);
+
+    auto lastStep = blockFirstStep + numSamples;
+    for (auto& worker : workers)
+    {
+        while (worker->finishedStep.load (std::memory_order_acquire) < lastStep)
+            std::this_thread::yield();
+    }
+    currentStep = lastStep;
+
+    for (int i = 0; i < numSamples; ++i)
+    {
+        output[i] = 0;
+        for (auto& plateOutput : outputs)
+            output[i] += plateOutput[i];
+    }
+}
+
+void PlateNetwork::runPlate (int plateIdx, juce::int64 firstStep, int numSamples)
+{
+    auto& plate = *plates[plateIdx];
+    auto& graph = graphs[plateIdx];
+    auto numPlates = getNumPlates();
+    auto numLinks = static_cast<int> (links.size());
+
+    for (int i = 0; i < numSamples; ++i)
+    {
+        auto step = firstStep + i;
+        auto& values = pointValues[step & 1];
+
+        plate.calculateNextState();
+
+        if (isLinked[plateIdx] == true)
+        {
+            for (auto pointIdx : pointsOfPlate[plateIdx])
+            {
+                const auto& point = points[pointIdx];
+                for (int timeIdx = 0; timeIdx < 3; ++timeIdx)
+                    values[3 * pointIdx + timeIdx] = plate.getPlateState (point.l, point.m, timeIdx);
+            }
+            publishedStep[plateIdx].store (step, std::memory_order_release);
+
+            for (int q = 0; q < numPlates; ++q)
+            {
+                if (q == plateIdx || isLinked[q] == false)
+                    continue;
+
+                int spins = 0;
+                while (publishedStep[q].load (std::memory_order_acquire) < step)
+                {
+                    if (++spins > 64)
+                        std::this_thread::yield();
+                }
+            }
+
+            for (int c = 0; c < numLinks; ++c)
+            {
+                auto a = 3 * links[c].pointA;
+                auto b = 3 * links[c].pointB;
+                graph.etaNext[c] = values[a] - values[b];
+                graph.eta[c] = values[a + 1] - values[b + 1];
+                graph.etaPrev[c] = values[a + 2] - values[b + 2];
+            }
+            graph.solve();
+
+            for (int c = 0; c < numLinks; ++c)
+            {
+                const auto& pointA = points[links[c].pointA];
+                const auto& pointB = points[links[c].pointB];
+                if (pointA.index == plateIdx)
+                    plate.addPlateForce (pointA.l, pointA.m, -graph.force[c]);
+                if (pointB.index == plateIdx)
+                    plate.addPlateForce (pointB.l, pointB.m, graph.force[c]);
+            }
+        }
+
+        plate.updateStates();
+        outputs[plateIdx][i] = plate.getOutput();
+    }
+}
@@ -0,0 +1,84 @@
+/*
+  ==============================================================================
+
+    PlateNetwork.h
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "ThinPlate.h"
+#include "ConnectionGraph.h"
+
+//==============================================================================
+/*
+    Several plates coupled through the nonlinear spring model of the strings (K1, K3, R).
+
+    Each plate advances on its own worker thread (the first one on the calling thread).
+    Per time step a plate publishes the states at its link points and a step counter, waits
+    for the step counters of the other linked plates and then solves the link forces itself.
+    The forces are solved from identical data on every worker, so they agree without a
+    second handoff. The point states are double buffered by step parity, so a plate can be at
+    most one step ahead of the others.
+*/
+class PlateNetwork
+{
+public:
+    PlateNetwork (double k);
+    ~PlateNetwork();
+
+    // Returns the index of the new plate
+    int addPlate();
+
+    ThinPlate& getPlate (int plateIdx) { return *plates[plateIdx]; }
+
+    int getNumPlates() const { return static_cast<int> (plates.size()); }
+
+    // Couple two plate points (discrete domain)
+    void addLink (int plateA, int lA, int mA, int plateB, int lB, int mB, double K1, double K3, double R);
+
+    void clearLinks();
+
+    // Build the link graph and start the workers. Call again after initParameters() on any plate
+    void prepare (int maxBlockSize);
+
+    void releaseWorkers();
+
+    // Advance all plates by numSamples steps and write the summed output
+    void process (float* output, int numSamples);
+
+private:
+    class Worker;
+
+    void runPlate (int plateIdx, juce::int64 firstStep, int numSamples);
+
+    int getPointIndex (int plateIdx, int l, int m);
+
+    double k;
+
+    std::vector<std::unique_ptr<ThinPlate>> plates;
+    std::vector<std::unique_ptr<Worker>> workers;
+
+    struct Link
+    {
+        int pointA, pointB;
+        double K1, K3, R;
+    };
+    std::vector<Link> links;
+    std::vector<ConnectionPoint> points; // Unique plate points used by the links (index = plate)
+    std::vector<std::vector<int>> pointsOfPlate;
+    std::vector<bool> isLinked;
+
+    std::vector<ConnectionGraph> graphs; // One copy of the link graph per plate
+    std::vector<double> pointValues[2]; // Per step parity: 3 values (n+1, n, n-1) per point
+    std::unique_ptr<std::atomic<juce::int64>[]> publishedStep;
+
+    std::vector<std::vector<float>> outputs;
+    juce::int64 currentStep = 0;
+    juce::int64 blockFirstStep = 0;
+    int blockNumSamples = 0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (PlateNetwork)
+};
@@ -0,0 +1,163 @@
+/*
+  ==============================================================================
+
+    PlateSettings.cpp
+
+  ==============================================================================
+*/
+
+#include "PlateSettings.h"
+#include <cmath>
+
+static const std::pair<const char*, float ChainSettings::*> floatParameters[] =
+{
+    { "Frequency Independent Damping", &ChainSettings::sig0 },
+    { "Frequency Dependent Damping", &ChainSettings::sig1 },
+    { "Plate length X", &ChainSettings::lengthX },
+    { "Plate length Y", &ChainSettings::lengthY },
+    { "Excitation pos X", &ChainSettings::excX },
+    { "Excitation pos Y", &ChainSettings::excY },
+    { "Listening pos X", &ChainSettings::lisX },
+    { "Listening pos Y", &ChainSettings::lisY },
+    { "Plate thickness", &ChainSettings::thickness },
+    { "Excitation time", &ChainSettings::excT },
+    { "Bow velocity", &ChainSettings::vB },
+    { "Bow force", &ChainSettings::FB },
+    { "Friction", &ChainSettings::a },
+    { "Bow attack 1", &ChainSettings::bAtt1 },
+    { "Bow decay 1", &ChainSettings::bDec1 },
+    { "Bow sustain 1", &ChainSettings::bSus1 },
+    { "Bow release 1", &ChainSettings::bRel1 },
+    { "Bow force env 1", &ChainSettings::FBEnv1 },
+    { "Bow velocity env 1", &ChainSettings::vBEnv1 },
+    { "LFO Rate", &ChainSettings::lfoRate },
+    { "String Length", &ChainSettings::sLen },
+    { "String Radius", &ChainSettings::sRad },
+    { "String Position Spread", &ChainSettings::sPosSpread },
+    { "String Damping", &ChainSettings::sSig0 },
+    { "Cylinder Length", &ChainSettings::cylinderLength },
+    { "Bell Length", &ChainSettings::bellLength },
+    { "Grid Coarsening", &ChainSettings::gridScale },
+    { "Nonlinearity", &ChainSettings::nonlinearity },
+    { "Impact Density", &ChainSettings::impactDensity },
+    { "Impact Force", &ChainSettings::impactForce },
+    { "Impact Force Spread", &ChainSettings::impactForceSpread },
+    { "Impact Spread", &ChainSettings::impactSpread }
+};
+
+static const std::pair<const char*, int ChainSettings::*> intParameters[] =
+{
+    { "Excitation force", &ChainSettings::excF },
+    { "X Pos Mod Depth", &ChainSettings::xPosMod },
+    { "Y Pos Mod Depth", &ChainSettings::yPosMod },
+    { "Number of Strings", &ChainSettings::numStrings },
+    { "String Tension", &ChainSettings::sTen },
+    { "String Tension Difference", &ChainSettings::sTenDiff },
+    { "Cylinder Radius", &ChainSettings::cylinderRadius },
+    { "Bell Radius", &ChainSettings::bellRadius }
+};
+
+ChainSettings getChainSettings (juce::AudioProcessorValueTreeState& tree)
+{
+    ChainSettings settings;
+    for (const auto& parameter : floatParameters)
+        settings.*parameter.second = tree.getRawParameterValue (parameter.first)->load();
+    for (const auto& parameter : intParameters)
+        settings.*parameter.second = static_cast<int> (tree.getRawParameterValue (parameter.first)->load());
+    return settings;
+}
+
+ChainSettings getChainSettings (const juce::ValueTree& state)
+{
+    ChainSettings settings;
+    for (const auto& child : state)
+    {
+        if (child.hasType ("PARAM"))
+            setChainSetting (settings, child.getProperty ("id").toString(), child.getProperty ("value"));
+    }
+    return settings;
+}
+
+bool setChainSetting (ChainSettings& settings, const juce::String& parameterID, float value)
+{
+    for (const auto& parameter : floatParameters)
+    {
+        if (parameterID == parameter.first)
+        {
+            settings.*parameter.second = value;
+            return true;
+        }
+    }
+    for (const auto& parameter : intParameters)
+    {
+        if (parameterID == parameter.first)
+        {
+            settings.*parameter.second = static_cast<int> (value);
+            return true;
+        }
+    }
+    return false;
+}
+
+PlateOptions getPlateOptions (const juce::ValueTree& state)
+{
+    PlateOptions options;
+    options.excTypeId = state.getProperty ("excType", options.excTypeId);
+    options.plateMaterialId = state.getProperty ("plateMaterial", options.plateMaterialId);
+    options.bellGrowthMenuId = state.getProperty ("bellGrowth", options.bellGrowthMenuId);
+    options.tubeConn = state.getProperty ("tubeConn", options.tubeConn);
+    options.springConn = state.getProperty ("springConn", options.springConn);
+    options.plateShapeId = state.getProperty ("plateShape", options.plateShapeId);
+    return options;
+}
+
+void setPlateOptions (juce::ValueTree& state, const PlateOptions& options)
+{
+    state.setProperty ("excType", options.excTypeId, nullptr);
+    state.setProperty ("plateMaterial", options.plateMaterialId, nullptr);
+    state.setProperty ("bellGrowth", options.bellGrowthMenuId, nullptr);
+    state.setProperty ("tubeConn", options.tubeConn, nullptr);
+    state.setProperty ("springConn", options.springConn, nullptr);
+    state.setProperty ("plateShape", options.plateShapeId, nullptr);
+}
+
+bool setPlateOption (PlateOptions& options, const juce::String& name, float value)
+{
+    if (name == "excType")
+        options.excTypeId = static_cast<int> (value);
+    else if (name == "plateMaterial")
+        options.plateMaterialId = static_cast<int> (value);
+    else if (name == "bellGrowth")
+        options.bellGrowthMenuId = static_cast<int> (value);
+    else if (name == "tubeConn")
+        options.tubeConn = value != 0;
+    else if (name == "springConn")
+        options.springConn = value != 0;
+    else if (name == "plateShape")
+        options.plateShapeId = static_cast<int> (value);
+    else
+        return false;
+    return true;
+}
+
+void applyChainSettings (ThinPlate& plate, const ChainSettings& settings, const PlateOptions& options)
+{
+    plate.updateParameters (settings.sig0, settings.sig1, settings.lengthX, settings.lengthY, settings.excX, settings.excY, settings.lisX, settings.lisY, settings.thickness, settings.excF, settings.excT, settings.vB, settings.FB, settings.a, options.excTypeId, settings.bAtt1, settings.bDec1, settings.bSus1, settings.bRel1, settings.FBEnv1, settings.vBEnv1, settings.lfoRate, settings.xPosMod, settings.yPosMod, settings.numStrings, settings.sLen, settings.sPosSpread, settings.sTen, settings.sTenDiff, settings.sRad, settings.sSig0, settings.cylinderLength, settings.cylinderRadius, settings.bellLength, settings.bellRadius, options.bellGrowthMenuId, options.tubeConn, options.springConn);
+    plate.updatePlateMaterial (options.plateMaterialId);
+    plate.setPlateShape (options.plateShapeId - 1);
+    plate.setImplicitScheme (settings.gridScale > 1, settings.gridScale);
+
+    // 0 to 1 spans the displacement gain from where a hard hit just starts to shimmer to where any
+    // hit does (10 to 1e5)
+    plate.setNonlinearity (settings.nonlinearity > 0 ? std::pow (10.0, 1 + 4 * settings.nonlinearity) : 0.0);
+
+    // Around the excitation position
+    StochasticExcitation::Settings impacts;
+    impacts.density = settings.impactDensity;
+    impacts.force = settings.impactForce;
+    impacts.forceSpread = settings.impactForceSpread;
+    impacts.xCentre = settings.excX;
+    impacts.yCentre = settings.excY;
+    impacts.spread = settings.impactSpread;
+    plate.setStochasticExcitation (impacts);
+}
@@ -0,0 +1,48 @@
+/*
+  ==============================================================================
+
+    PlateSettings.h
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "ThinPlate.h"
+
+// Values of the plugin parameters. The defaults match PlateAudioProcessor::createParameterLayout()
+struct ChainSettings
+{
+    int  excF { 10 }, xPosMod { 0 }, yPosMod { 0 }, numStrings { 0 }, sTenDiff { 25 }, sTen { 1000 }, cylinderRadius { 2 },  bellRadius { 10 };
+    float sig0 { 1 }, sig1 { 0.0005f }, lengthX { 0.5f }, lengthY { 0.5f }, excX { 0.5f }, excY { 0.5f }, lisX { 0.5f }, lisY { 0.5f }, thickness { 8 }, excT { 1 }, vB { 0.1f }, FB { 0.1f }, a { 1 }, bAtt1 { 0.01f }, bDec1 { 0.01f }, bSus1 { 0 }, bRel1 { 0.01f }, FBEnv1 { 0 }, vBEnv1 { 0 }, lfoRate { 0.1f }, sLen { 0.2f }, sRad { 1 }, sPosSpread { 50 }, sSig0 { 0.2f }, cylinderLength { 1.77f }, bellLength { 0.8f }, gridScale { 1 }, nonlinearity { 0 }, impactDensity { 0 }, impactForce { 10 }, impactForceSpread { 0.5f }, impactSpread { 1 };
+};
+
+// Settings the editor keeps outside the parameter tree
+struct PlateOptions
+{
+    int excTypeId = 2; // 1 = bow, 2 = mallet, 3 = audio input
+    int plateMaterialId = 1;
+    int bellGrowthMenuId = 1;
+    bool tubeConn = false;
+    bool springConn = true;
+    int plateShapeId = 1; // PlateGeometry::Shape + 1
+};
+
+ChainSettings getChainSettings (juce::AudioProcessorValueTreeState& apvts);
+
+// From a saved parameter tree (PARAM children with an id and a value). Missing parameters keep their defaults
+ChainSettings getChainSettings (const juce::ValueTree& state);
+
+// Returns false if the parameter ID is unknown
+bool setChainSetting (ChainSettings& settings, const juce::String& parameterID, float value);
+
+// The options are stored as properties of the saved parameter tree
+PlateOptions getPlateOptions (const juce::ValueTree& state);
+void setPlateOptions (juce::ValueTree& state, const PlateOptions& options);
+
+// Sets an option by its property name (excType, plateMaterial, bellGrowth, tubeConn, springConn, plateShape). Returns false if the name is unknown
+bool setPlateOption (PlateOptions& options, const juce::String& name, float value);
+
+// Everything processBlock() passes to the plate before a note
+void applyChainSettings (ThinPlate& plate, const ChainSettings& settings, const PlateOptions& options);
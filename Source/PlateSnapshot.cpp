@@ -0,0 +1,83 @@
+/*
+  ==============================================================================
+
+    PlateSnapshot.cpp
+
+  ==============================================================================
+*/
+
+#include "PlateSnapshot.h"
+
+static const char snapshotMagic[] = { 'P', 'L', 'S', 'N' };
+// Bump whenever the layout written by ThinPlate::writeState() changes.
+// 2: stress function of the nonlinear plate
+// 3: queued mallet pulses
+// 4: random impact generator
+static constexpr int snapshotVersion = 4;
+
+juce::Result savePlateSnapshot (ThinPlate& plate, const juce::File& file, const juce::MemoryBlock& extraData)
+{
+    juce::MemoryOutputStream state;
+    plate.writeState (state);
+
+    auto partFile = file.getSiblingFile (file.getFileName() + ".part");
+    partFile.deleteFile();
+    {
+        juce::FileOutputStream stream (partFile);
+        if (! stream.openedOk())
+            return juce::Result::fail ("Can't write to " + partFile.getFullPathName());
+
+        stream.write (snapshotMagic, sizeof (snapshotMagic));
+        stream.writeInt (snapshotVersion);
+        stream.writeInt64 (static_cast<juce::int64> (state.getDataSize()));
+        stream.write (state.getData(), state.getDataSize());
+        stream.writeInt64 (static_cast<juce::int64> (extraData.getSize()));
+        stream.write (extraData.getData(), extraData.getSize());
+        stream.flush();
+        if (stream.getStatus().failed())
+            return juce::Result::fail ("Writing " + partFile.getFullPathName() + " failed: " + stream.getStatus().getErrorMessage());
+    }
+
+    if (! partFile.moveFileTo (file))
+        return juce::Result::fail ("Can't rename " + partFile.getFullPathName());
+    return juce::Result::ok();
+}
+
+juce::Result loadPlateSnapshot (ThinPlate& plate, const juce::File& file, juce::MemoryBlock* extraData)
+{
+    juce::MemoryMappedFile mappedFile (file, juce::MemoryMappedFile::readOnly);
+    if (mappedFile.getData() == nullptr)
+        return juce::Result::fail ("Can't read the snapshot " + file.getFullPathName());
+
+    juce::MemoryInputStream stream (mappedFile.getData(), mappedFile.getSize(), false);
+    char magic[sizeof (snapshotMagic)] = {};
+    if (stream.read (magic, sizeof (magic)) != static_cast<int> (sizeof (magic)) || std::memcmp (magic, snapshotMagic, sizeof (magic)) != 0)
+        return juce::Result::fail (file.getFullPathName() + " is not a plate snapshot");
+
+    auto version = stream.readInt();
+    if (version != snapshotVersion)
+        return juce::Result::fail (file.getFileName() + " has snapshot format " + juce::String (version) + ", this build reads format " + juce::String (snapshotVersion));
+
+    auto stateSize = stream.readInt64();
+    auto stateStart = stream.getPosition();
+    if (! juce::isPositiveAndBelow (stateSize, stream.getNumBytesRemaining() + 1) || ! stream.setPosition (stateStart + stateSize))
+        return juce::Result::fail (file.getFullPathName() + " is cut short");
+
+    // Checked before the plate is touched, so a damaged file leaves it as it was
+    auto extraSize = stream.readInt64();
+    if (! juce::isPositiveAndBelow (extraSize, stream.getNumBytesRemaining() + 1))
+        return juce::Result::fail (file.getFullPathName() + " is cut short");
+
+    // The plate reads the state straight from the mapped pages
+    juce::MemoryInputStream stateStream (static_cast<const char*> (mappedFile.getData()) + stateStart, static_cast<size_t> (stateSize), false);
+    auto result = plate.readState (stateStream);
+    if (result.failed())
+        return juce::Result::fail (file.getFileName() + ": " + result.getErrorMessage());
+
+    if (extraData != nullptr)
+    {
+        extraData->setSize (static_cast<size_t> (extraSize));
+        stream.read (extraData->getData(), static_cast<int> (extraSize));
+    }
+    return juce::Result::ok();
+}
@@ -0,0 +1,30 @@
+/*
+  ==============================================================================
+
+    PlateSnapshot.h
+
+    Snapshot files of the simulation state of a plate (ThinPlate::writeState()), so a
+    sustained bow can be loaded instead of played up from silence and long renders can be
+    resumed. Layout:
+        "PLSN", format version (int32)
+        state size (int64), state
+        extra size (int64), extra data of the caller (e.g. a render position)
+    The integers are little endian. The grids are stored as they are in memory, so a
+    snapshot doesn't load on a machine with a different double layout.
+
+    Loading maps the file instead of reading it, so the grids are copied into the plate
+    straight from the page cache.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "ThinPlate.h"
+
+// Writes the file under another name first, so a killed write never leaves a damaged snapshot
+juce::Result savePlateSnapshot (ThinPlate& plate, const juce::File& file, const juce::MemoryBlock& extraData = {});
+
+// The plate has to be set up with the parameters the snapshot was saved with
+juce::Result loadPlateSnapshot (ThinPlate& plate, const juce::File& file, juce::MemoryBlock* extraData = nullptr);
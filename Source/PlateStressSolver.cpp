@@ -0,0 +1,346 @@
+/*
+  ==============================================================================
+
+    PlateStressSolver.cpp
+
+  ==============================================================================
+*/
+
+#include "PlateStressSolver.h"
+
+void PlateStressSolver::SineTransform::prepare (int size, int numLinesToUse)
+{
+    n = size;
+    numLines = numLinesToUse;
+    half = (n + 1) / 2;
+
+    // The odd extension [0, x, 0, -reversed x] has 2 (n + 1) points. It is split into its prime factors
+    fftSize = 2 * (n + 1);
+    factors.clear();
+    auto remaining = fftSize;
+    for (int radix = 2; remaining > 1; ++radix)
+    {
+        while (remaining % radix == 0)
+        {
+            remaining /= radix;
+            factors.push_back (radix);
+        }
+    }
+
+    // Multiply-adds per line. A radix p stage costs about p per point (1 for radix 2), and the FFT
+    // is about 2.5 times slower per operation than the matrix product, as measured
+    double fftCost = 0;
+    for (auto radix : factors)
+        fftCost += 2.5 * fftSize * (radix == 2 ? 1 : radix);
+    useFft = fftCost < 0.5 * n * n;
+
+    if (! useFft)
+    {
+        sines.resize (static_cast<size_t> (n * n));
+        for (int p = 0; p < n; ++p)
+            for (int j = 0; j < n; ++j)
+                sines[static_cast<size_t> (p * n + j)] = std::sin (juce::MathConstants<double>::pi * (p + 1) * (j + 1) / (n + 1));
+        even.assign (static_cast<size_t> (std::max (n, half * numLines)), 0);
+        odd.assign (even.size(), 0);
+        return;
+    }
+
+    rootsRe.resize (static_cast<size_t> (fftSize));
+    rootsIm.resize (static_cast<size_t> (fftSize));
+    for (int k = 0; k < fftSize; ++k)
+    {
+        rootsRe[static_cast<size_t> (k)] = std::cos (juce::MathConstants<double>::twoPi * k / fftSize);
+        rootsIm[static_cast<size_t> (k)] = -std::sin (juce::MathConstants<double>::twoPi * k / fftSize);
+    }
+
+    numPairs = (numLines + 1) / 2;
+    for (int i = 0; i < 2; ++i)
+    {
+        re[i].assign (static_cast<size_t> (fftSize * numPairs), 0);
+        im[i].assign (static_cast<size_t> (fftSize * numPairs), 0);
+    }
+}
+
+// The sine matrix is symmetric, so a row of the result is a sum of the matrix rows. The first
+// half of the sums of the even and odd rows gives both halves of the result
+void PlateStressSolver::SineTransform::transformRows (double* data)
+{
+    if (useFft)
+    {
+        transformWithFft (data, n, 1);
+        return;
+    }
+
+    for (int r = 0; r < numLines; ++r)
+    {
+        auto* row = data + r * n;
+        std::fill (even.begin(), even.begin() + half, 0.0);
+        std::fill (odd.begin(), odd.begin() + half, 0.0);
+        for (int j = 0; j < n; ++j)
+        {
+            auto* sum = j % 2 == 0 ? even.data() : odd.data(); // Matrix row j + 1
+            const auto x = row[j];
+            const auto* sine = &sines[static_cast<size_t> (j * n)];
+            for (int p = 0; p < half; ++p)
+                sum[p] += x * sine[p];
+        }
+        for (int p = 0; p < half; ++p)
+        {
+            row[n - 1 - p] = even[static_cast<size_t> (p)] - odd[static_cast<size_t> (p)];
+            row[p] = even[static_cast<size_t> (p)] + odd[static_cast<size_t> (p)];
+        }
+    }
+}
+
+// Row p of the result is a sum of the rows of the block. The rows are folded about the centre
+// first: the symmetric rows of the matrix take the sums of the mirrored rows, the others their differences
+void PlateStressSolver::SineTransform::transformColumns (double* data)
+{
+    if (useFft)
+    {
+        transformWithFft (data, 1, numLines);
+        return;
+    }
+
+    auto* sums = even.data();
+    auto* differences = odd.data();
+    for (int j = 0; j < half; ++j)
+    {
+        const auto* a = data + j * numLines;
+        const auto* b = data + (n - 1 - j) * numLines;
+        auto* sum = sums + j * numLines;
+        auto* difference = differences + j * numLines;
+        for (int i = 0; i < numLines; ++i)
+        {
+            sum[i] = j == n - 1 - j ? a[i] : a[i] + b[i]; // The centre row of an odd n isn't mirrored
+            difference[i] = a[i] - b[i];
+        }
+    }
+
+    for (int p = 0; p < n; ++p)
+    {
+        auto* out = data + p * numLines;
+        const auto* folded = p % 2 == 0 ? sums : differences;
+        std::fill (out, out + numLines, 0.0);
+        for (int j = 0; j < half; ++j)
+        {
+            const auto sine = sines[static_cast<size_t> (p * n + j)];
+            const auto* in = folded + j * numLines;
+            for (int i = 0; i < numLines; ++i)
+                out[i] += sine * in[i];
+        }
+    }
+}
+
+// A mixed radix Stockham FFT of all pairs at once, so the inner loops run over the pairs. With
+// line a in the real and line b in the imaginary part, the FFT of the odd extension is
+// -2i DST(a) + 2 DST(b), so both transforms are read off one spectrum
+void PlateStressSolver::SineTransform::transformWithFft (double* data, int lineStride, int pointStride)
+{
+    const auto pairs = static_cast<size_t> (numPairs);
+    auto* xRe = re[0].data();
+    auto* xIm = im[0].data();
+    auto* yRe = re[1].data();
+    auto* yIm = im[1].data();
+
+    std::fill (xRe, xRe + pairs, 0.0);
+    std::fill (xIm, xIm + pairs, 0.0);
+    std::fill (xRe + (n + 1) * pairs, xRe + (n + 2) * pairs, 0.0);
+    std::fill (xIm + (n + 1) * pairs, xIm + (n + 2) * pairs, 0.0);
+    for (int j = 1; j <= n; ++j)
+    {
+        const auto* in = data + (j - 1) * pointStride;
+        auto* reJ = xRe + j * pairs;
+        auto* imJ = xIm + j * pairs;
+        auto* reMirror = xRe + (fftSize - j) * pairs;
+        auto* imMirror = xIm + (fftSize - j) * pairs;
+        for (int i = 0; i < numPairs; ++i)
+        {
+            reJ[i] = in[i * lineStride];
+            imJ[i] = i + numPairs < numLines ? in[(i + numPairs) * lineStride] : 0.0;
+            reMirror[i] = -reJ[i];
+            imMirror[i] = -imJ[i];
+        }
+    }
+
+    int length = fftSize; // Length of the sub-transforms of this stage
+    int stride = 1; // Number of them
+    for (auto radix : factors)
+    {
+        const auto m = length / radix;
+        for (int p = 0; p < m; ++p)
+        {
+            if (radix == 2)
+            {
+                const auto wRe = rootsRe[static_cast<size_t> (p * stride)];
+                const auto wIm = rootsIm[static_cast<size_t> (p * stride)];
+                for (int q = 0; q < stride; ++q)
+                {
+                    const auto* aRe = xRe + (q + stride * p) * pairs;
+                    const auto* aIm = xIm + (q + stride * p) * pairs;
+                    const auto* bRe = xRe + (q + stride * (p + m)) * pairs;
+                    const auto* bIm = xIm + (q + stride * (p + m)) * pairs;
+                    auto* sumRe = yRe + (q + stride * 2 * p) * pairs;
+                    auto* sumIm = yIm + (q + stride * 2 * p) * pairs;
+                    auto* differenceRe = yRe + (q + stride * (2 * p + 1)) * pairs;
+                    auto* differenceIm = yIm + (q + stride * (2 * p + 1)) * pairs;
+                    for (size_t i = 0; i < pairs; ++i)
+                    {
+                        const auto dRe = aRe[i] - bRe[i];
+                        const auto dIm = aIm[i] - bIm[i];
+                        sumRe[i] = aRe[i] + bRe[i];
+                        sumIm[i] = aIm[i] + bIm[i];
+                        differenceRe[i] = dRe * wRe - dIm * wIm;
+                        differenceIm[i] = dRe * wIm + dIm * wRe;
+                    }
+                }
+                continue;
+            }
+
+            for (int q = 0; q < stride; ++q)
+            {
+                // Output t = w^pt * sum_r x_r e^(-2 pi i r t / radix)
+                for (int t = 0; t < radix; ++t)
+                {
+                    auto* outRe = yRe + (q + stride * (radix * p + t)) * pairs;
+                    auto* outIm = yIm + (q + stride * (radix * p + t)) * pairs;
+                    const auto* inRe = xRe + (q + stride * p) * pairs;
+                    const auto* inIm = xIm + (q + stride * p) * pairs;
+                    std::copy (inRe, inRe + pairs, outRe);
+                    std::copy (inIm, inIm + pairs, outIm);
+
+                    int root = 0;
+                    for (int r = 1; r < radix; ++r)
+                    {
+                        root = (root + t * (fftSize / radix)) % fftSize;
+                        const auto wRe = rootsRe[static_cast<size_t> (root)];
+                        const auto wIm = rootsIm[static_cast<size_t> (root)];
+                        inRe = xRe + (q + stride * (p + r * m)) * pairs;
+                        inIm = xIm + (q + stride * (p + r * m)) * pairs;
+                        for (size_t i = 0; i < pairs; ++i)
+                        {
+                            outRe[i] += inRe[i] * wRe - inIm[i] * wIm;
+                            outIm[i] += inRe[i] * wIm + inIm[i] * wRe;
+                        }
+                    }
+
+                    const auto twiddle = static_cast<size_t> (p * t * stride);
+                    if (twiddle != 0)
+                    {
+                        const auto wRe = rootsRe[twiddle];
+                        const auto wIm = rootsIm[twiddle];
+                        for (size_t i = 0; i < pairs; ++i)
+                        {
+                            const auto a = outRe[i];
+                            outRe[i] = a * wRe - outIm[i] * wIm;
+                            outIm[i] = a * wIm + outIm[i] * wRe;
+                        }
+                    }
+                }
+            }
+        }
+        std::swap (xRe, yRe);
+        std::swap (xIm, yIm);
+        length = m;
+        stride *= radix;
+    }
+
+    for (int p = 1; p <= n; ++p)
+    {
+        auto* out = data + (p - 1) * pointStride;
+        const auto* reP = xRe + p * pairs;
+        const auto* imP = xIm + p * pairs;
+        for (int i = 0; i < numPairs; ++i)
+        {
+            out[i * lineStride] = -0.5 * imP[i];
+            if (i + numPairs < numLines)
+                out[(i + numPairs) * lineStride] = 0.5 * reP[i];
+        }
+    }
+}
+
+void PlateStressSolver::prepare (int NxToUse, int NyToUse, double hToUse)
+{
+    Nx = NxToUse;
+    Ny = NyToUse;
+    nx = std::max (0, Nx - 4);
+    ny = std::max (0, Ny - 4);
+    invH4 = 1 / (hToUse * hToUse * hToUse * hToUse);
+
+    transformX.prepare (nx, ny);
+    transformY.prepare (ny, nx);
+
+    // The Laplacian's eigenvalues along a line are -4 sin^2 (pi p / (2 (n + 1))) / h^2. The h^4 of
+    // D4 cancels the one of L(u, u), so both are left out
+    weights.resize (static_cast<size_t> (nx * ny));
+    for (int p = 0; p < nx; ++p)
+    {
+        auto sx = std::sin (0.5 * juce::MathConstants<double>::pi * (p + 1) / (nx + 1));
+        for (int q = 0; q < ny; ++q)
+        {
+            auto sy = std::sin (0.5 * juce::MathConstants<double>::pi * (q + 1) / (ny + 1));
+            auto eigenvalue = -4 * (sx * sx + sy * sy);
+            weights[static_cast<size_t> (p * ny + q)] = 4.0 / ((nx + 1) * (ny + 1)) / (eigenvalue * eigenvalue);
+        }
+    }
+
+    bracket.assign (static_cast<size_t> (nx * ny), 0);
+    phiUxx.assign (static_cast<size_t> (Nx * Ny), 0);
+    phiUyy.assign (phiUxx.size(), 0);
+    phiUxy.assign (phiUxx.size(), 0);
+    work.assign (bracket.size(), 0);
+    phi.assign (static_cast<size_t> (Nx * Ny), 0);
+}
+
+double PlateStressSolver::calculateStress (const std::vector<double>* u, double scale)
+{
+    if (nx == 0 || ny == 0)
+        return 0;
+
+    // L(u, u) = 2 (u_xx u_yy - u_xy^2)
+    for (int l = 2; l < Nx - 2; ++l)
+    {
+        const auto& uC = u[l];
+        const auto& uL = u[l - 1];
+        const auto& uR = u[l + 1];
+        auto* out = &bracket[static_cast<size_t> ((l - 2) * ny)];
+        for (int m = 2; m < Ny - 2; ++m)
+        {
+            auto uxx = uR[m] - 2 * uC[m] + uL[m];
+            auto uyy = uC[m + 1] - 2 * uC[m] + uC[m - 1];
+            auto uxy = 0.25 * (uR[m + 1] - uR[m - 1] - uL[m + 1] + uL[m - 1]);
+            out[m - 2] = 2 * (uxx * uyy - uxy * uxy);
+        }
+    }
+
+    std::copy (bracket.begin(), bracket.end(), work.begin());
+    transformY.transformRows (work.data());
+    transformX.transformColumns (work.data());
+
+    for (size_t i = 0; i < work.size(); ++i)
+        work[i] *= -scale * weights[i];
+
+    transformY.transformRows (work.data());
+    transformX.transformColumns (work.data());
+
+    double sum = 0;
+    for (size_t i = 0; i < work.size(); ++i)
+        sum += work[i] * bracket[i];
+
+    for (int l = 2; l < Nx - 2; ++l)
+    {
+        const auto& uC = u[l];
+        const auto& uL = u[l - 1];
+        const auto& uR = u[l + 1];
+        const auto* f = &work[static_cast<size_t> ((l - 2) * ny)];
+        std::copy (f, f + ny, phi.begin() + getIndex (l, 2));
+        for (int m = 2; m < Ny - 2; ++m)
+        {
+            auto i = static_cast<size_t> (getIndex (l, m));
+            phiUxx[i] = f[m - 2] * (uR[m] - 2 * uC[m] + uL[m]);
+            phiUyy[i] = f[m - 2] * (uC[m + 1] - 2 * uC[m] + uC[m - 1]);
+            phiUxy[i] = f[m - 2] * 0.25 * (uR[m + 1] - uR[m - 1] - uL[m + 1] + uL[m - 1]);
+        }
+    }
+    return sum * invH4;
+}
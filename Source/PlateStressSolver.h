@@ -0,0 +1,104 @@
+/*
+  ==============================================================================
+
+    PlateStressSolver.h
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/*
+    Airy stress function of the von Karman plate. For the displacement u it solves
+        D4 phi = -scale * L(u, u)
+    where D4 is the biharmonic and L(f, g) = f_xx g_yy + f_yy g_xx - 2 f_xy g_xy, both with
+    centred differences of spacing h, and gives L(phi, u) for the plate update.
+
+    phi is zero on the clamped lines of the plate, and so is its Laplacian (a simply supported
+    stress function), so the sine transform (DST-I) of the interior diagonalises D4: the solve
+    is a forward transform along both axes, a division by the squared Laplacian eigenvalues
+    and the inverse transform. The transforms and the eigenvalue weights are planned once in
+    prepare() and the buffers are reused, so a step doesn't allocate.
+
+    Each axis gets the cheaper of two plans: a complex FFT of the odd extension of the lines, two
+    lines at a time, or the product with the precomputed sine matrix. The product does about
+    n^2 / 2 multiply-adds per line but runs them as long vectorisable loops, and wins up to a few
+    hundred points per line, which covers every grid the plugin sets up.
+*/
+class PlateStressSolver
+{
+public:
+    // Grid of Nx x Ny points with the clamped lines at 1 and Nx - 2 (1 and Ny - 2), as ThinPlate's
+    void prepare (int NxToUse, int NyToUse, double hToUse);
+
+    // phi for the displacement u (Nx rows of Ny points). Returns the sum of phi L(u, u) over the
+    // interior. With u in metres and scale = E H / 2, the stress energy is -h^2 / 4 times that
+    double calculateStress (const std::vector<double>* u, double scale);
+
+    // L(phi, u) at the interior point (l, m), for the u of the last calculateStress(). It is
+    // taken as (phi u_xx)_yy + (phi u_yy)_xx - 2 (phi u_xy)_xy, which is the same in the continuum
+    // but makes it exactly the gradient of the discrete stress energy
+    double getCoupling (int l, int m) const
+    {
+        auto i = getIndex (l, m);
+        const auto* a = &phiUxx[i];
+        const auto* b = &phiUyy[i];
+        const auto* c = &phiUxy[i];
+
+        return (a[1] - 2 * a[0] + a[-1]
+                + b[Ny] - 2 * b[0] + b[-Ny]
+                - 0.5 * (c[Ny + 1] - c[Ny - 1] - c[-Ny + 1] + c[-Ny - 1])) * invH4;
+    }
+
+    int getIndex (int l, int m) const { return l * Ny + m; }
+
+    // phi on the whole grid (flat, l * Ny + m)
+    const std::vector<double>& getStress() const { return phi; }
+
+private:
+    // y_p = sum_j x_j sin (pi p j / (n + 1)) for p, j = 1..n, on the rows or the columns of a
+    // block of numLines lines. Applying it twice scales by (n + 1) / 2
+    struct SineTransform
+    {
+        void prepare (int size, int numLinesToUse);
+
+        // numLines contiguous rows of n points
+        void transformRows (double* data);
+
+        // The columns of n rows of numLines points
+        void transformColumns (double* data);
+
+    private:
+        // Line i starts at data + i * lineStride, and its points are pointStride apart
+        void transformWithFft (double* data, int lineStride, int pointStride);
+
+        int n = 0, numLines = 0;
+        bool useFft = false;
+
+        // Row p of the sine matrix is symmetric about its centre for odd p and antisymmetric for
+        // even p, so the matrix path sums the products of half of it
+        int half = 0; // (n + 1) / 2
+        std::vector<double> sines; // n x n
+        std::vector<double> even, odd; // Products with the even and odd rows (rows) or the folded lines (columns)
+
+        // The FFT path transforms all lines at once, half of them in the real and half in the
+        // imaginary part, so the inner loops run over the lines
+        int fftSize = 0, numPairs = 0;
+        std::vector<int> factors; // Radix of each stage
+        std::vector<double> rootsRe, rootsIm; // exp (-2 pi i k / fftSize)
+        std::vector<double> re[2], im[2]; // fftSize x numPairs, for alternate stages
+    };
+
+    int Nx = 0, Ny = 0;
+    int nx = 0, ny = 0; // Interior points
+    double invH4 = 1;
+
+    SineTransform transformX, transformY;
+    std::vector<double> weights; // Inverse squared eigenvalues of D4 with the transform scaling (nx x ny)
+    std::vector<double> bracket, work; // L(u, u) and the transforms, on the interior (nx x ny)
+    std::vector<double> phi;
+    std::vector<double> phiUxx, phiUyy, phiUxy; // phi times the second differences of u (flat, zero off the interior)
+};
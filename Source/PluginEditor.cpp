@@ -205,6 +205,20 @@ bellEndRadiusSliderAttachment(audioProcessor.tree, "Bell Radius", bellEndRadiusS
             
     };
     
+    inputExcButton.setColour(juce::TextButton::ColourIds::buttonOnColourId, juce::Colours::purple);
+    inputExcButton.setRadioGroupId(1);
+    inputExcButton.setToggleable(true);
+    inputExcButton.setClickingTogglesState(true);
+    addAndMakeVisible(inputExcButton);
+    inputExcButton.onStateChange = [this]
+    {
+        if (inputExcButton.getToggleState() == true)
+        {
+            resized();
+            audioProcessor.excTypeId = 3;
+        }
+    };
+    
     stringConnButton.setColour(juce::TextButton::ColourIds::buttonOnColourId, juce::Colours::purple);
     stringConnButton.setRadioGroupId(2);
     stringConnButton.setToggleable(true);
@@ -333,6 +347,20 @@ bellEndRadiusSliderAttachment(audioProcessor.tree, "Bell Radius", bellEndRadiusS
     plateMaterialMenuLabel.setJustificationType(juce::Justification::left);
     plateMaterialMenuLabel.attachToComponent(&plateMaterialMenu , false);
     
+    plateShapeMenu.addItem("Rectangle", PlateGeometry::Rectangle + 1);
+    plateShapeMenu.addItem("Disc", PlateGeometry::Disc + 1);
+    plateShapeMenu.addItem("Notched", PlateGeometry::Notched + 1);
+    plateShapeMenu.setSelectedId(audioProcessor.plateShapeId);
+    plateShapeMenu.onChange = [this]
+    {
+        audioProcessor.plateShapeId = plateShapeMenu.getSelectedId(); // takes effect at the next note
+    };
+    addAndMakeVisible(plateShapeMenu);
+    plateShapeMenuLabel.setText("Plate Shape:", juce::dontSendNotification);
+    plateShapeMenuLabel.setFont(18.0f);
+    plateShapeMenuLabel.setJustificationType(juce::Justification::left);
+    plateShapeMenuLabel.attachToComponent(&plateShapeMenu , false);
+    
     setSliderAndLabelHorizontal(cylinderLengthSlider, cylinderLengthLabel, "Cylinder Length");
     cylinderLengthSlider.setTextValueSuffix(" m");
     cylinderLengthSlider.setSkewFactor(0.4);
@@ -399,6 +427,15 @@ bellEndRadiusSliderAttachment(audioProcessor.tree, "Bell Radius", bellEndRadiusS
         }
     };
     
+    cpuLabel.setFont(13.0f);
+    cpuLabel.setJustificationType(juce::Justification::centredLeft);
+    addAndMakeVisible(cpuLabel);
+    saveProfileButton.onClick = [this] { saveProfileButtonClicked(); };
+    addAndMakeVisible(saveProfileButton);
+    recordFieldButton.onClick = [this] { recordFieldButtonClicked(); };
+    addAndMakeVisible(recordFieldButton);
+    startTimerHz(30);
+    
     setResizable(true, true);
     setResizeLimits(400, 250, 1600, 1000);
     getConstrainer() -> setFixedAspectRatio(1.6);
@@ -410,6 +447,62 @@ PlateAudioProcessorEditor::~PlateAudioProcessorEditor()
 {
 }
 
+void PlateAudioProcessorEditor::timerCallback()
+{
+    // Only the plate is repainted for a new frame
+    if (plateHeatMap.update(audioProcessor.plateField))
+    {
+        repaint(plateGUIX, plateGUIY, plateGUIWidth, plateGUIHeight);
+    }
+    audioProcessor.plateField.requestFrame();
+    
+    timerTicks = (timerTicks + 1) % 8;
+    if (timerTicks != 0)
+    {
+        return;
+    }
+    
+    auto& profiler = audioProcessor.blockProfiler;
+    profiler.collect();
+    auto load = profiler.getLoadStats();
+    cpuLabel.setText("CPU mean " + juce::String(load.mean, 0) + "%  p99 " + juce::String(load.p99, 0) + "%  max " + juce::String(load.max, 0) + "%  overruns " + juce::String(profiler.getNumOverruns()) + "  quality " + QualityGovernor::getLevelName(audioProcessor.qualityGovernor.getLevel()), juce::dontSendNotification);
+}
+
+void PlateAudioProcessorEditor::saveProfileButtonClicked()
+{
+    auto& profiler = audioProcessor.blockProfiler;
+    profiler.collect();
+    auto file = juce::File::getSpecialLocation(juce::File::userDocumentsDirectory).getNonexistentChildFile("PlateCpuProfile", ".txt");
+    if (file.replaceWithText(profiler.getReport()))
+    {
+        juce::AlertWindow::showMessageBoxAsync(juce::AlertWindow::InfoIcon, "CPU profile", "Saved to " + file.getFullPathName());
+    }
+}
+
+void PlateAudioProcessorEditor::recordFieldButtonClicked()
+{
+    auto& recorder = audioProcessor.wavefieldRecorder;
+    if (recorder.isRecording())
+    {
+        recorder.stop();
+        recordFieldButton.setButtonText("Record plate");
+        auto message = "Saved to " + recordingFile.getFullPathName();
+        if (recorder.getNumDropped() > 0)
+            message << "\n" << recorder.getNumDropped() << " frames were dropped";
+        juce::AlertWindow::showMessageBoxAsync(juce::AlertWindow::InfoIcon, "Plate recording", message);
+        return;
+    }
+    
+    recordingFile = juce::File::getSpecialLocation(juce::File::userDocumentsDirectory).getNonexistentChildFile("PlateWavefield", ".plwf");
+    auto result = audioProcessor.startWavefieldRecording(recordingFile);
+    if (result.failed())
+    {
+        juce::AlertWindow::showMessageBoxAsync(juce::AlertWindow::WarningIcon, "Plate recording", result.getErrorMessage());
+        return;
+    }
+    recordFieldButton.setButtonText("Stop recording");
+}
+
 void PlateAudioProcessorEditor::hitButtonClicked()
 {
     audioProcessor.hit = true;
@@ -477,6 +570,11 @@ void PlateAudioProcessorEditor::paint (juce::Graphics& g)
     plateGUIX = plateRect.getX();
     plateGUIY = plateRect.getY();
     
+    if (plateHeatMap.getImage().isValid())
+    {
+        g.drawImage(plateHeatMap.getImage(), plateRect.toFloat());
+    }
+    
     auto stringLength = plateGUIHeight*stringLengthSlider.getValue();
     numString = numStringSlider.getValue();
     for (int nS=0; nS < numStringSlider.getValue(); ++nS)
@@ -538,6 +636,11 @@ void PlateAudioProcessorEditor::paint (juce::Graphics& g)
             bowComponent.setBounds(plateRect.getX()+excXSlider.getValue()*plateRect.getWidth(), plateRect.getY()+excYSlider.getValue()*plateRect.getHeight(), plateArea.getWidth(), plateArea.getWidth());
         }
     }
+    if (inputExcButton.getToggleState() == true)
+    {
+        hammerComponent.setVisible(false);
+        bowComponent.setVisible(false);
+    }
     
     
         /*
@@ -597,6 +700,10 @@ void PlateAudioProcessorEditor::resized()
     auto dampingArea = plateArea.removeFromTop(plateArea.getHeight()*0.25);
     auto dampingAreaHeigth = dampingArea.getHeight();
     auto plateMaterialArea = connectionArea.removeFromBottom(connectionArea.getHeight()*0.15);
+    auto cpuArea = plateArea.removeFromBottom(plateArea.getHeight()*0.05);
+    saveProfileButton.setBounds(cpuArea.removeFromRight(cpuArea.getWidth()*0.3));
+    recordFieldButton.setBounds(cpuArea.removeFromRight(cpuArea.getWidth()*0.3));
+    cpuLabel.setBounds(cpuArea);
     dampingArea.removeFromTop(dampingAreaHeigth*0.3);
     auto rotaryWidth = dampingArea.getWidth()*0.33;
     sig0Slider.setBounds(dampingArea.removeFromLeft(rotaryWidth));
@@ -674,7 +781,10 @@ void PlateAudioProcessorEditor::resized()
         
     }
     plateMaterialArea.removeFromTop(plateMaterialArea.getHeight()*0.2);
-    plateMaterialMenu.setBounds(plateMaterialArea.removeFromRight(plateMaterialArea.getWidth()*0.5));
+    auto plateMenuArea = plateMaterialArea.removeFromRight(plateMaterialArea.getWidth()*0.5);
+    plateMaterialMenu.setBounds(plateMenuArea.removeFromTop(plateMenuArea.getHeight()*0.4));
+    plateMenuArea.removeFromTop(plateMenuArea.getHeight()*0.33); // label of the shape menu
+    plateShapeMenu.setBounds(plateMenuArea);
     springConnButton.setBounds(plateMaterialArea.removeFromTop(plateMaterialArea.getHeight()*0.25));
     rigidConnButton.setBounds(plateMaterialArea.removeFromTop(plateMaterialArea.getHeight()*0.33));
     stringConnButton.setBounds(plateMaterialArea.removeFromTop(plateMaterialArea.getHeight()*0.5));
@@ -682,8 +792,9 @@ void PlateAudioProcessorEditor::resized()
     
     
     auto excitationTypeArea = excitationArea.removeFromTop(excitationArea.getHeight()*0.1);
-    bowExcButton.setBounds(excitationTypeArea.removeFromLeft(excitationArea.getWidth()*0.5));
-    malletExcButton.setBounds(excitationTypeArea);
+    bowExcButton.setBounds(excitationTypeArea.removeFromLeft(excitationArea.getWidth()*0.33));
+    malletExcButton.setBounds(excitationTypeArea.removeFromLeft(excitationArea.getWidth()*0.33));
+    inputExcButton.setBounds(excitationTypeArea);
     if (bowExcButton.getToggleState() == true)
     {
         hitButton.setVisible(false);
@@ -761,5 +872,34 @@ void PlateAudioProcessorEditor::resized()
         excXSlider.setBounds(excitationArea.removeFromLeft(excitationArea.getWidth()*0.5));
         excYSlider.setBounds(excitationArea);
     }
+    
+    // The input drives the plate with the excitation force per unit sample, at the excitation
+    // position (left) and its mirror image (right)
+    if (inputExcButton.getToggleState() == true)
+    {
+        vBSlider.setVisible(false);
+        fBSlider.setVisible(false);
+        fricSlider.setVisible(false);
+        bAtt1Slider.setVisible(false);
+        bDec1Slider.setVisible(false);
+        bSus1Slider.setVisible(false);
+        bRel1Slider.setVisible(false);
+        FBEnv1Slider.setVisible(false);
+        vBEnv1Slider.setVisible(false);
+        lfoRateSlider.setVisible(false);
+        xPosLFOModSlider.setVisible(false);
+        yPosLFOModSlider.setVisible(false);
+        startBowButton.setVisible(false);
+        hitButton.setVisible(false);
+        excTSlider.setVisible(false);
+        excFSlider.setVisible(true);
+        repaint();
+        auto excFArea = excitationArea.removeFromTop(dampingAreaHeigth);
+        excFArea.removeFromTop(dampingAreaHeigth*0.3);
+        excFSlider.setBounds(excFArea.removeFromLeft(excitationArea.getWidth()*0.5));
+        excitationArea.removeFromTop(dampingAreaHeigth*0.3);
+        excXSlider.setBounds(excitationArea.removeFromLeft(excitationArea.getWidth()*0.5));
+        excYSlider.setBounds(excitationArea);
+    }
 
 }
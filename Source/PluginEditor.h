@@ -11,6 +11,7 @@
 #include <JuceHeader.h>
 #include "PluginProcessor.h"
 #include "ThinPlate.h"
+#include "PlateHeatMap.h"
 
 
 //==============================================================================
@@ -44,7 +45,7 @@ public:
 
 };
 
-class PlateAudioProcessorEditor  : public juce::AudioProcessorEditor, public juce::Slider::Listener
+class PlateAudioProcessorEditor  : public juce::AudioProcessorEditor, public juce::Slider::Listener, private juce::Timer
 {
 public:
     PlateAudioProcessorEditor (PlateAudioProcessor&);
@@ -78,6 +79,13 @@ public:
     
     void malletExcButtonClicked();
     
+    // Redraws the plate heat map at 30 fps and shows the CPU load from the block timings a few times a second
+    void timerCallback() override;
+    
+    void saveProfileButtonClicked();
+    
+    void recordFieldButtonClicked();
+    
 private:
 
     PlateAudioProcessor& audioProcessor;
@@ -87,20 +95,28 @@ private:
     
     juce::Slider sig0Slider, sig1Slider, lengthXSlider, lengthYSlider, excXSlider, excYSlider, lisXSlider, lisYSlider, excFSlider, excTSlider, thicknessSlider, vBSlider, fBSlider, fricSlider, bAtt1Slider, bDec1Slider, bSus1Slider, bRel1Slider, FBEnv1Slider, vBEnv1Slider, xPosLFOModSlider, yPosLFOModSlider, lfoRateSlider, numStringSlider, stringTensionDiffSlider, stringLengthSlider, stringRadiusSlider, stringTensionSlider, stringPosSpreadSlider, stringPosOffSetSlider, sSig0Slider, cylinderLengthSlider, cylinderRadiusSlider, bellLengthSlider, bellEndRadiusSlider;
     
-    juce::Label sig0Label, sig1Label, lengthXLabel, lengthYLabel, excXLabel, excYLabel, lisXLabel, lisYLabel, excFLabel, excTLabel, thicknessLabel, plateMaterialMenuLabel, vBLabel, fBLabel, fricLabel, bAtt1Label, bDec1Label, bSus1Label, bRel1Label, FBEnv1Label, vBEnv1Label, xPosLFOModLabel, yPosLFOModLabel, lfoRateLabel, numStringLabel, stringTensionDiffLabel, stringLengthLabel, stringRadiusLabel, stringTensionLabel, stringPosSpreadLabel, stringPosOffSetLabel, sSig0Label, cylinderLengthLabel, cylinderRadiusLabel, bellLengthLabel, bellEndRadiusLabel, bellGrowthLabel, connTubeLabel;
+    juce::Label sig0Label, sig1Label, lengthXLabel, lengthYLabel, excXLabel, excYLabel, lisXLabel, lisYLabel, excFLabel, excTLabel, thicknessLabel, plateMaterialMenuLabel, vBLabel, fBLabel, fricLabel, bAtt1Label, bDec1Label, bSus1Label, bRel1Label, FBEnv1Label, vBEnv1Label, xPosLFOModLabel, yPosLFOModLabel, lfoRateLabel, numStringLabel, stringTensionDiffLabel, stringLengthLabel, stringRadiusLabel, stringTensionLabel, stringPosSpreadLabel, stringPosOffSetLabel, sSig0Label, cylinderLengthLabel, cylinderRadiusLabel, bellLengthLabel, bellEndRadiusLabel, bellGrowthLabel, connTubeLabel, plateShapeMenuLabel;
     
-    juce::ComboBox plateMaterialMenu, bellGrowthMenu;
+    juce::ComboBox plateMaterialMenu, bellGrowthMenu, plateShapeMenu;
     
     sliderAttachment sig0SliderAttachment, sig1SliderAttachment, lengthXSliderAttachment, lengthYSliderAttachment, excXSliderAttachment, excYSliderAttachment, lisXSliderAttachment, lisYSliderAttachment, thicknessSliderAttachment, excFSliderAttachment, excTSliderAttachment, vBSliderAttachment, fBSliderAttachment, fricSliderAttachment, bAtt1SliderAttachment, bDec1SliderAttachment, bSus1SliderAttachment, bRel1SliderAttachment, FBEnv1SliderAttachment, vBEnv1SliderAttachment, xPosLFOModSliderAttachment, yPosLFOModSliderAttachment, lfoRateSliderAttachment, numStringSliderAttachment, stringTensionDiffSliderAttachment, stringLengthSliderAttachment, stringRadiusSliderAttachment, stringTensionSliderAttachment, stringPosSpreadSliderAttachment, sSig0SliderAttachment, cylinderLengthSliderAttachment, cylinderRadiusSliderAttachment, bellLengthSliderAttachment, bellEndRadiusSliderAttachment;
     
-    juce::TextButton hitButton{"Hit plate"}, bowExcButton{"Bow"}, malletExcButton{"Mallet"}, linkFBvB{"Link"}, startBowButton{"Start bowing"}, stringConnButton{"Connect strings"}, tubeConnButton{"Connect tube"}, rigidConnButton{"Rigid Connection"}, springConnButton{"Spring Connection"};
+    juce::TextButton hitButton{"Hit plate"}, bowExcButton{"Bow"}, malletExcButton{"Mallet"}, inputExcButton{"Input"}, linkFBvB{"Link"}, startBowButton{"Start bowing"}, stringConnButton{"Connect strings"}, tubeConnButton{"Connect tube"}, rigidConnButton{"Rigid Connection"}, springConnButton{"Spring Connection"};
 
     juce::ToggleButton connTubeToggle;
     
+    juce::Label cpuLabel;
+    juce::TextButton saveProfileButton{"Save CPU profile"};
+    juce::TextButton recordFieldButton{"Record plate"};
+    juce::File recordingFile;
+    
     bool hammerDrag = false;
     bool bowDrag = false;
     
-    int plateGUIWidth, plateGUIHeight, plateGUIX, plateGUIY, numString;
+    int plateGUIWidth = 0, plateGUIHeight = 0, plateGUIX = 0, plateGUIY = 0, numString;
+    
+    PlateHeatMap plateHeatMap;
+    int timerTicks = 0;
     
     //juce::Image hammer = juce::ImageCache::getFromMemory (BinaryData::Hammer_png, BinaryData::Hammer_pngSize);
     //juce::Image bow = juce::ImageCache::getFromMemory (BinaryData::Bow_png, BinaryData::Bow_pngSize);
@@ -8,23 +8,15 @@
 
 #include "PluginProcessor.h"
 #include "PluginEditor.h"
-
-struct ChainSettings
-{
-    int  excF { 0 }, xPosMod { 0 }, yPosMod { 0 }, numStrings { 0 }, sTenDiff { 0 }, sTen { 0 }, cylinderRadius { 0 },  bellRadius { 0 };
-    float sig0 { 0 }, sig1 { 0 }, lengthX { 0 }, lengthY { 0 }, excX { 0 }, excY { 0 }, lisX { 0 }, lisY { 0 }, thickness { 0 }, excT { 0 }, vB { 0 }, FB { 0 }, a { 0 }, bAtt1 { 0 }, bDec1 { 0 }, bSus1 { 0 }, bRel1 { 0 }, FBEnv1 { 0 }, vBEnv1 { 0 }, lfoRate { 0 }, sLen { 0 }, sRad { 0 }, sPosSpread { 0 }, sSig0 { 0 }, cylinderLength { 0 }, bellLength { 0 };
-};
-
-ChainSettings getChainSettings(juce::AudioProcessorValueTreeState& apvts);
+#include "PlateSettings.h"
+#include "PlateKernelTuner.h"
 
 //==============================================================================
 PlateAudioProcessor::PlateAudioProcessor()
 #ifndef JucePlugin_PreferredChannelConfigurations
      : AudioProcessor (BusesProperties()
                      #if ! JucePlugin_IsMidiEffect
-                      #if ! JucePlugin_IsSynth
-                       .withInput  ("Input",  juce::AudioChannelSet::stereo(), true)
-                      #endif
+                       .withInput  ("Input",  juce::AudioChannelSet::stereo(), true) // Only read by the input excitation
                        .withOutput ("Output", juce::AudioChannelSet::stereo(), true)
                      #endif
                        )
@@ -105,15 +97,63 @@ void PlateAudioProcessor::prepareToPlay (double sampleRate, int samplesPerBlock)
     firstHit = false;
     // Retrieve sample rate
     fs = sampleRate;
-    thinPlate = std::make_unique<ThinPlate> (1.0 / fs);
-    thinPlate-> getSampleRate(fs);
+    
+    // Every start is at full quality
+    qualityGovernor.prepare(sampleRate);
+    qualityLevel = QualityGovernor::FullQuality;
+    offlineProfile = false;
+    plateOversampling = 1;
+    activeRateDivider = plateRateDivider;
+    rateGain = 1;
+    offlineDecimator.prepare();
+    fadeLength = std::max(1, static_cast<int>(0.01*fs));
+    plateQuiet = true;
+    crossfade = 0;
+    fadingPlate = nullptr;
+    
+    // A plate still being set up is for the last sample rate
+    plateBuilder.stop();
+    plateBuilder.start();
+    
+    thinPlate = std::make_unique<ThinPlate> (getPlateTimeStep());
+    thinPlate-> getSampleRate(getPlateRate());
+    thinPlate-> setSubsystemRates(stringRateRatio, tubeRateRatio);
+    thinPlate-> setStageTiming(true);
+    thinPlate-> setSymmetryReduction(true); // Turns itself off for excitations and connections off the centre line
+    applyChainSettings(*thinPlate, getChainSettings(tree), {excTypeId, plateMaterialId, bellGrowthMenuId, tubeConn, springConn, plateShapeId});
     thinPlate-> initParameters();
+    
+    // The fastest plate loop for the current grid. Timed once per machine, grid and sample rate, then read from a table
+    selectPlateKernel(*thinPlate, getPlateRate());
+    realtimeKernel = thinPlate->getPlateKernel();
+    if (isNonRealtime() == true)
+    {
+        startOfflineProfile();
+        thinPlate-> initParameters();
+        selectPlateKernel(*thinPlate, getPlateRate());
+    }
+    setLatencySamples(offlineProfile ? offlineDecimator.getLatency() : 0);
+    prevOutput = 0;
+    nextOutput = 0;
+    rateCounter = 0;
+    inputAsleep = true;
+    inputSums[0] = inputSums[1] = 0;
+    noteOnSamples.reserve(128);
+    noteExpression.prepare(sampleRate, samplesPerBlock);
 }
 
 void PlateAudioProcessor::releaseResources()
 {
     // When playback stops, you can use this as an opportunity to free up any
     // spare memory, etc.
+    plateBuilder.stop();
+    fadingPlate = nullptr;
+    
+    // The row threads of the offline profile are started again by the next prepareToPlay()
+    if (thinPlate != nullptr)
+    {
+        thinPlate->setPlateThreads(1);
+    }
 }
 
 #ifndef JucePlugin_PreferredChannelConfigurations
@@ -135,6 +175,12 @@ bool PlateAudioProcessor::isBusesLayoutSupported (const BusesLayout& layouts) co
    #if ! JucePlugin_IsSynth
     if (layouts.getMainOutputChannelSet() != layouts.getMainInputChannelSet())
         return false;
+   #else
+    // The input excitation takes a mono or stereo input, or runs without one
+    if (! layouts.getMainInputChannelSet().isDisabled()
+     && layouts.getMainInputChannelSet() != juce::AudioChannelSet::mono()
+     && layouts.getMainInputChannelSet() != juce::AudioChannelSet::stereo())
+        return false;
    #endif
 
     return true;
@@ -145,20 +191,37 @@ bool PlateAudioProcessor::isBusesLayoutSupported (const BusesLayout& layouts) co
 void PlateAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages)
 {
     juce::ScopedNoDenormals noDenormals;
+    blockProfiler.startBlock();
     auto totalNumInputChannels  = getTotalNumInputChannels();
     auto totalNumOutputChannels = getTotalNumOutputChannels();
-
+    
+    // The input wakes the plate up. Notes don't reset it, as it is an effect then
+    const bool inputExcitation = excTypeId == 3;
+    const int numInputPoints = inputExcitation ? juce::jmin(totalNumInputChannels, 2) : 0;
+    bool inputSilent = true;
+    for (int channel = 0; channel < numInputPoints; ++channel)
+    {
+        if (buffer.getMagnitude(channel, 0, buffer.getNumSamples()) > inputSleepLevel)
+        {
+            inputSilent = false;
+            inputAsleep = false;
+        }
+    }
     
     //Allow midi notes to activate a plate hit
     juce::MidiBuffer::Iterator mIt(midiMessages);
     juce::MidiMessage curMes;
     int samplePosition;
-    while (mIt.getNextEvent(curMes, samplePosition))
+    while (inputExcitation == false && mIt.getNextEvent(curMes, samplePosition))
     {
         if (curMes.isNoteOn())
         {
             hit = true;
             bowStart = true;
+            if (noteOnSamples.size() < noteOnSamples.capacity())
+            {
+                noteOnSamples.push_back(samplePosition);
+            }
         }
         if (curMes.isNoteOff())
         {
@@ -166,24 +229,120 @@ void PlateAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer, juce::
         }
     }
     
+    // Pressure, slide and pitch bend of the playing note, smoothed per sample for the bow
+    noteExpression.renderNextBlock(midiMessages, buffer.getNumSamples());
+    
     for (auto i = totalNumInputChannels; i < totalNumOutputChannels; ++i)
         buffer.clear (i, 0, buffer.getNumSamples());
 
     auto* channelDataL = buffer.getWritePointer (0);
-    auto* channelDataR = buffer.getWritePointer (1);
     
     auto chainSettings = getChainSettings(tree);
     
-    thinPlate -> updateParameters(chainSettings.sig0, chainSettings.sig1, chainSettings.lengthX, chainSettings.lengthY, chainSettings.excX, chainSettings.excY, chainSettings.lisX, chainSettings.lisY, chainSettings.thickness, chainSettings.excF, chainSettings.excT, chainSettings.vB, chainSettings.FB, chainSettings.a, excTypeId, chainSettings.bAtt1, chainSettings.bDec1 , chainSettings.bSus1, chainSettings.bRel1, chainSettings.FBEnv1, chainSettings.vBEnv1, chainSettings.lfoRate, chainSettings.xPosMod, chainSettings.yPosMod, chainSettings.numStrings, chainSettings.sLen, chainSettings.sPosSpread, chainSettings.sTen, chainSettings.sTenDiff, chainSettings.sRad, chainSettings.sSig0, chainSettings.cylinderLength, chainSettings.cylinderRadius, chainSettings.bellLength, chainSettings.bellRadius, bellGrowthMenuId, tubeConn, springConn);
-    thinPlate -> updatePlateMaterial(plateMaterialId);
-    thinPlate -> getSampleRate(fs);
-
+    // The plate of the governor's level, or of the profile the host switched to, is set up on the
+    // builder thread and switched to once it is ready. It goes on with the sound of the playing
+    // plate, so notes keep ringing across the switch
+    const int requestedLevel = qualityGovernor.getRequestedLevel();
+    const bool offline = isNonRealtime();
+    
+    // A bounce has no deadline, so it waits for its plate and renders with it from the start
+    const bool waitForPlate = offline == true && offlineProfile == false;
+    if (waitForPlate == true)
+    {
+        plateBuilder.waitForJob();
+    }
+    auto builtPlate = plateBuilder.takePlate();
+    if (builtPlate != nullptr && buildOffline == offline)
+    {
+        switchPlate(std::move(builtPlate), buildLevel, buildOffline);
+    }
+    else
+    {
+        if (builtPlate != nullptr)
+        {
+            plateBuilder.release(builtPlate); // Set up for the profile before the host changed it
+        }
+        if (offline != offlineProfile && fadingPlate == nullptr)
+        {
+            if (waitForPlate == true)
+            {
+                plateBuilder.waitForJob();
+            }
+            if (plateBuilder.build(getBuildJob(chainSettings, QualityGovernor::FullQuality, offline)) == true)
+            {
+                buildLevel = QualityGovernor::FullQuality;
+                buildOffline = offline;
+                if (waitForPlate == true)
+                {
+                    plateBuilder.waitForJob();
+                    if (auto offlinePlate = plateBuilder.takePlate())
+                    {
+                        switchPlate(std::move(offlinePlate), buildLevel, buildOffline);
+                    }
+                }
+            }
+        }
+        else if (requestedLevel != qualityLevel && fadingPlate == nullptr && offline == false)
+        {
+            if (plateBuilder.build(getBuildJob(chainSettings, requestedLevel, false)) == true)
+            {
+                buildLevel = requestedLevel;
+                buildOffline = false;
+            }
+        }
+    }
+    
+    QualityGovernor::limitSettings(qualityLevel, chainSettings);
+    if (offlineProfile == true)
+    {
+        chainSettings.gridScale = 1;
+    }
+    applyChainSettings(*thinPlate, chainSettings, {excTypeId, plateMaterialId, bellGrowthMenuId, tubeConn, springConn, plateShapeId});
+    QualityGovernor::limitPlate(qualityLevel, *thinPlate, chainSettings);
+    thinPlate -> getSampleRate(getPlateRate());
+    thinPlate -> setSubsystemRates(stringRateRatio, tubeRateRatio);
+
+    // A note on a plate that is already playing doesn't start it over, so the earlier notes of a
+    // roll keep ringing: the mallet adds a pulse at the note's sample and the bow restarts its
+    // envelope. Only settings that need initParameters() still reset the plate
+    if ((hit == true || bowStart == true) && (firstHit == true || firstBow == true) && thinPlate->needsInit() == false)
+    {
+        if (excTypeId == 2 && hit == true)
+        {
+            if (noteOnSamples.empty())
+            {
+                noteOnSamples.push_back(0); // the editor's hit button
+            }
+            for (auto sample : noteOnSamples)
+            {
+                thinPlate->addMalletPulse(chainSettings.excX, chainSettings.excY, chainSettings.excF, chainSettings.excT*0.001, sample * plateOversampling / activeRateDivider);
+                if (0 < crossfade)
+                {
+                    fadingPlate->addMalletPulse(chainSettings.excX, chainSettings.excY, chainSettings.excF, chainSettings.excT*0.001, sample / fadingRateDivider);
+                }
+            }
+        }
+        if (bowStart == true)
+        {
+            thinPlate->startBow();
+            if (0 < crossfade)
+            {
+                fadingPlate->startBow();
+            }
+        }
+        hit = false;
+        bowStart = false;
+    }
+    noteOnSamples.clear();
+    
     if (hit == true)
     {
         firstHit = true;
         thinPlate-> initParameters();
         thinPlate -> plateHit();
         hit = false;
+        crossfade = 0; // The plate starts over
+        offlineDecimator.reset();
     }
     
     if (bowStart == true)
@@ -192,26 +351,234 @@ void PlateAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer, juce::
         thinPlate-> initParameters();
         thinPlate -> startBow();
         bowStart = false;
+        crossfade = 0;
+        offlineDecimator.reset();
     }
     
     if (bowEnd == true)
     {
         thinPlate -> endBow();
+        if (0 < crossfade)
+        {
+            fadingPlate->endBow();
+        }
         bowEnd = false;
     }
+    blockProfiler.endStage(BlockProfiler::Parameters);
+    
+    thinPlate -> resetStageTicks();
+    
+    // The random impacts play without notes, like the input
+    const bool impactsActive = 0 < chainSettings.impactDensity;
+    const bool plateRunning = impactsActive || (inputExcitation ? inputAsleep == false : (firstHit == true || firstBow == true));
+    
+    // The left input drives the excitation position and the right input its mirror image through the
+    // centre, with the excitation force per unit sample. Averaged over the samples of a plate step,
+    // and held over the plate steps of a sample
+    auto addInputForces = [&] (ThinPlate& plate, float* sums, int rateDivider, bool clearSums)
+    {
+        for (int channel = 0; channel < numInputPoints; ++channel)
+        {
+            auto xRatio = channel == 0 ? chainSettings.excX : 1 - chainSettings.excX;
+            auto yRatio = channel == 0 ? chainSettings.excY : 1 - chainSettings.excY;
+            plate.addExcitationForce(xRatio, yRatio, chainSettings.excF * sums[channel] / rateDivider);
+            if (clearSums == true)
+            {
+                sums[channel] = 0;
+            }
+        }
+    };
+    
+    // Steps a plate once every rateDivider samples and interpolates linearly between its outputs
+    auto stepPlate = [&] (ThinPlate& plate, float* sums, int rateDivider, int& counter, float& prev, float& next)
+    {
+        if (counter == 0)
+        {
+            addInputForces(plate, sums, rateDivider, true);
+            plate.calculateScheme();
+            if (&plate == thinPlate.get())
+            {
+                wavefieldRecorder.pushFrame(plate);
+            }
+            prev = next;
+            next = plate.getOutput();
+        }
+        if (rateDivider == 1)
+        {
+            return next;
+        }
+        auto stepOutput = prev + (next - prev) * counter / rateDivider;
+        counter = (counter + 1) % rateDivider;
+        return stepOutput;
+    };
+    float outputLevel = 0;
     for (int i = 0; i < buffer.getNumSamples(); ++i)
     {
-        if (firstHit == true || firstBow == true)
+        // Read before channel 0 is overwritten with the output
+        for (int channel = 0; channel < numInputPoints; ++channel)
+        {
+            inputSums[channel] += buffer.getSample(channel, i);
+            if (0 < crossfade)
+            {
+                fadingInputSums[channel] += buffer.getSample(channel, i);
+            }
+        }
+        if (plateRunning == true)
         {
-            thinPlate->calculateScheme();
-            output = thinPlate->getOutput();
+            auto positionOffset = noteExpression.getPositionOffset(i);
+            thinPlate->setBowExpression(noteExpression.getForceScale(i), noteExpression.getVelocityScale(i), positionOffset, positionOffset);
+            if (activeRateDivider == 1 && plateOversampling > 1)
+            {
+                // Two plate steps per sample, taken back to the sample rate by the half-band filter
+                float stepOutputs[offlineOversampling];
+                for (int step = 0; step < offlineOversampling; ++step)
+                {
+                    addInputForces(*thinPlate, inputSums, activeRateDivider, step == offlineOversampling - 1);
+                    thinPlate->calculateScheme();
+                    wavefieldRecorder.pushFrame(*thinPlate);
+                    stepOutputs[step] = thinPlate->getOutput();
+                }
+                output = offlineDecimator.process(stepOutputs[0], stepOutputs[1]);
+            }
+            else
+            {
+                output = stepPlate(*thinPlate, inputSums, activeRateDivider, rateCounter, prevOutput, nextOutput);
+            }
+            output *= rateGain;
+            
+            // Both plates move the same way, so a linear crossfade keeps the level
+            if (0 < crossfade)
+            {
+                fadingPlate->setBowExpression(noteExpression.getForceScale(i), noteExpression.getVelocityScale(i), positionOffset, positionOffset);
+                auto fadingOutput = stepPlate(*fadingPlate, fadingInputSums, fadingRateDivider, fadingRateCounter, fadingPrevOutput, fadingNextOutput);
+                auto fade = static_cast<float>(crossfade--) / fadeLength;
+                output += fade * (fadingOutput * fadingRateGain - output);
+            }
             channelDataL[i] = limit(output, -1, 1);
-            channelDataR[i] = channelDataL[i];
+            outputLevel = std::max(outputLevel, std::abs(channelDataL[i]));
+        }
+        else
+        {
+            channelDataL[i] = 0; // the input isn't passed through
         }
     }
+    if (plateRunning == true)
+    {
+        plateField.write(*thinPlate);
+    }
+    plateQuiet = plateRunning == false || outputLevel <= inputSleepLevel;
+    
+    // Once the input is silent and the plate has rung out, stop stepping it until the input returns
+    if (inputExcitation == true && plateRunning == true && inputSilent == true && impactsActive == false && outputLevel <= inputSleepLevel)
+    {
+        inputAsleep = true;
+        thinPlate->clearState();
+        inputSums[0] = inputSums[1] = 0;
+    }
+    if (fadingPlate != nullptr && (crossfade == 0 || plateRunning == false))
+    {
+        crossfade = 0;
+        plateBuilder.release(fadingPlate); // Tried again in the next block while the builder is busy
+    }
+    blockProfiler.addStageTicks(BlockProfiler::Strings, thinPlate -> getStringTicks());
+    blockProfiler.addStageTicks(BlockProfiler::Tube, thinPlate -> getTubeTicks());
+    blockProfiler.endStage(BlockProfiler::Plate);
+    
+    for (int channel = 1; channel < totalNumOutputChannels; ++channel)
+    {
+        buffer.copyFrom(channel, 0, buffer, 0, 0, buffer.getNumSamples());
+    }
+    blockProfiler.endStage(BlockProfiler::Output);
+    blockProfiler.endBlock(buffer.getNumSamples(), fs);
+    if (offlineProfile == false)
+    {
+        qualityGovernor.update(blockProfiler.getLastLoad(), buffer.getNumSamples());
+    }
+}
+
+void PlateAudioProcessor::setQualityLevel(int level)
+{
+    qualityLevel = level;
+    qualityGovernor.setLevel(level);
+    
+    // The outputs of the old rate are dropped
+    activeRateDivider = offlineProfile ? 1 : plateRateDivider * QualityGovernor::getRateDivider(level);
+    thinPlate->setTimeStep(getPlateTimeStep());
+    
+    // u is in units of k^2, so a plate slower than the set rate is quieter by the square of the ratio,
+    // and an oversampled one louder
+    const float rateRatio = static_cast<float>(activeRateDivider) / (plateRateDivider * plateOversampling);
+    rateGain = rateRatio * rateRatio;
+    rateCounter = 0;
+    prevOutput = 0;
+    nextOutput = 0;
+}
+
+PlateBuilder::Job PlateAudioProcessor::getBuildJob(const ChainSettings& chainSettings, int level, bool offline) const
+{
+    PlateBuilder::Job job;
+    job.settings = chainSettings;
+    job.options = {excTypeId, plateMaterialId, bellGrowthMenuId, tubeConn, springConn, plateShapeId};
+    job.level = level;
+    job.plateRate = offline ? fs * offlineOversampling : fs / (plateRateDivider * QualityGovernor::getRateDivider(level));
+    job.stringRateRatio = stringRateRatio;
+    job.tubeRateRatio = tubeRateRatio;
+    job.kernel = realtimeKernel;
+    job.offline = offline;
+    job.plateThreads = offline ? getOfflinePlateThreads() : 1;
+    return job;
+}
+
+void PlateAudioProcessor::switchPlate(std::shared_ptr<ThinPlate> nextPlate, int level, bool offline)
+{
+    // The last plate keeps its rate for the crossfade. A quiet one is released at the end of the block
+    nextPlate->transferState(*thinPlate);
+    fadingPlate = std::move(thinPlate);
+    fadingRateDivider = activeRateDivider;
+    fadingRateGain = rateGain;
+    fadingRateCounter = rateCounter;
+    fadingPrevOutput = prevOutput;
+    fadingNextOutput = nextOutput;
+    fadingInputSums[0] = inputSums[0];
+    fadingInputSums[1] = inputSums[1];
+    crossfade = (plateQuiet == true || offline != offlineProfile) ? 0 : fadeLength;
+    
+    thinPlate = std::move(nextPlate);
+    if (offline != offlineProfile)
+    {
+        offlineProfile = offline;
+        plateOversampling = offline ? offlineOversampling : 1;
+        offlineDecimator.reset();
+    }
+    setQualityLevel(level);
+    
+    // The interpolation of a slower plate starts from the displacement it took over
+    prevOutput = nextOutput = thinPlate->getOutput();
+}
+
+void PlateAudioProcessor::startOfflineProfile()
+{
+    offlineProfile = true;
+    plateOversampling = offlineOversampling;
+    setQualityLevel(QualityGovernor::FullQuality);
+    thinPlate->getSampleRate(getPlateRate());
+    
+    // The full grid without coarsening. A bounce can take all the time it needs, so it also spreads
+    // the rows over half the cores, which leaves the rest to the host and the other tracks
+    thinPlate->setImplicitScheme(false, 1);
+    thinPlate->setPlateThreads(getOfflinePlateThreads());
 }
 
 
+juce::Result PlateAudioProcessor::startWavefieldRecording(const juce::File& file)
+{
+    if (thinPlate == nullptr)
+        return juce::Result::fail("The plate is not running yet");
+    
+    // A frame every 32 plate steps and the last 4096 frames, about three seconds at 44.1 kHz
+    return wavefieldRecorder.start(file, thinPlate->getNx(), thinPlate->getNy(), getPlateRate(), {});
+}
+
 //==============================================================================
 bool PlateAudioProcessor::hasEditor() const
 {
@@ -227,7 +594,9 @@ juce::AudioProcessorEditor* PlateAudioProcessor::createEditor()
 void PlateAudioProcessor::getStateInformation (juce::MemoryBlock& destData)
 {
     juce::MemoryOutputStream mos(destData,true);
-    tree.state.writeToStream(mos);
+    auto state = tree.copyState();
+    setPlateOptions(state, {excTypeId, plateMaterialId, bellGrowthMenuId, tubeConn, springConn, plateShapeId});
+    state.writeToStream(mos);
 }
 
 void PlateAudioProcessor::setStateInformation (const void* data, int sizeInBytes)
@@ -236,49 +605,15 @@ void PlateAudioProcessor::setStateInformation (const void* data, int sizeInBytes
     if( valueTree.isValid() )
     {
         tree.replaceState(valueTree);
-    }
-}
 
-ChainSettings getChainSettings(juce::AudioProcessorValueTreeState& tree)
-{
-    ChainSettings settings;
-    
-    settings.sig0 = tree.getRawParameterValue("Frequency Independent Damping")->load();
-    settings.sig1 = tree.getRawParameterValue("Frequency Dependent Damping")->load();
-    settings.lengthX = tree.getRawParameterValue("Plate length X")->load();
-    settings.lengthY = tree.getRawParameterValue("Plate length Y")->load();
-    settings.excX = tree.getRawParameterValue("Excitation pos X")->load();
-    settings.excY = tree.getRawParameterValue("Excitation pos Y")->load();
-    settings.lisX = tree.getRawParameterValue("Listening pos X")->load();
-    settings.lisY = tree.getRawParameterValue("Listening pos Y")->load();
-    settings.thickness = tree.getRawParameterValue("Plate thickness")->load();
-    settings.excF = tree.getRawParameterValue("Excitation force")->load();
-    settings.excT = tree.getRawParameterValue("Excitation time")->load();
-    settings.vB = tree.getRawParameterValue("Bow velocity")->load();
-    settings.FB = tree.getRawParameterValue("Bow force")->load();
-    settings.a = tree.getRawParameterValue("Friction")-> load();
-    settings.bAtt1 = tree.getRawParameterValue("Bow attack 1")-> load();
-    settings.bDec1 = tree.getRawParameterValue("Bow decay 1")-> load();
-    settings.bSus1 = tree.getRawParameterValue("Bow sustain 1")-> load();
-    settings.bRel1 = tree.getRawParameterValue("Bow release 1")-> load();
-    settings.FBEnv1 = tree.getRawParameterValue("Bow force env 1")-> load();
-    settings.vBEnv1 = tree.getRawParameterValue("Bow velocity env 1")-> load();
-    settings.lfoRate = tree.getRawParameterValue("LFO Rate")-> load();
-    settings.xPosMod = tree.getRawParameterValue("X Pos Mod Depth")-> load();
-    settings.yPosMod = tree.getRawParameterValue("Y Pos Mod Depth")-> load();
-    settings.numStrings = tree.getRawParameterValue("Number of Strings")-> load();
-    settings.sLen = tree.getRawParameterValue("String Length")-> load();
-    settings.sRad = tree.getRawParameterValue("String Radius")-> load();
-    settings.sTen = tree.getRawParameterValue("String Tension")-> load();
-    settings.sTenDiff = tree.getRawParameterValue("String Tension Difference")-> load();
-    settings.sPosSpread = tree.getRawParameterValue("String Position Spread")-> load();
-    settings.sSig0 = tree.getRawParameterValue("String Damping") -> load();
-    settings.cylinderLength = tree.getRawParameterValue("Cylinder Length")->load();
-    settings.cylinderRadius = tree.getRawParameterValue("Cylinder Radius")->load();
-    settings.bellLength = tree.getRawParameterValue("Bell Length")->load();
-    settings.bellRadius = tree.getRawParameterValue("Bell Radius")->load();
-    //settings.sSig1 = tree.getRawParameterValue("String Freq Dep Damp") -> load();
-    return settings;
+        auto options = getPlateOptions(valueTree);
+        excTypeId = options.excTypeId;
+        plateMaterialId = options.plateMaterialId;
+        bellGrowthMenuId = options.bellGrowthMenuId;
+        tubeConn = options.tubeConn;
+        springConn = options.springConn;
+        plateShapeId = options.plateShapeId;
+    }
 }
 
 juce::AudioProcessorValueTreeState::ParameterLayout PlateAudioProcessor::createParameterLayout()
@@ -319,6 +654,12 @@ juce::AudioProcessorValueTreeState::ParameterLayout PlateAudioProcessor::createP
     layout.add(std::make_unique<juce::AudioParameterFloat>("Cylinder Length", "Cylinder Length", 0.1f, 4, 1.77f));
     layout.add(std::make_unique<juce::AudioParameterFloat>("Bell Length", "Bell Length", 0.f, 1.f, 0.8f));
     layout.add(std::make_unique<juce::AudioParameterInt>("Bell Radius", "Bell Radius", 1, 100, 10));
+    layout.add(std::make_unique<juce::AudioParameterFloat>("Grid Coarsening", "Grid Coarsening", 1.f, 4.f, 1.f));
+    layout.add(std::make_unique<juce::AudioParameterFloat>("Nonlinearity", "Nonlinearity", 0.f, 1.f, 0.f));
+    layout.add(std::make_unique<juce::AudioParameterFloat>("Impact Density", "Impact Density", juce::NormalisableRange<float>(0.f, 10000.f, 0.f, 0.3f), 0.f));
+    layout.add(std::make_unique<juce::AudioParameterFloat>("Impact Force", "Impact Force", juce::NormalisableRange<float>(0.1f, 100.f, 0.f, 0.3f), 10.f));
+    layout.add(std::make_unique<juce::AudioParameterFloat>("Impact Force Spread", "Impact Force Spread", 0.f, 2.f, 0.5f));
+    layout.add(std::make_unique<juce::AudioParameterFloat>("Impact Spread", "Impact Spread", 0.f, 1.f, 1.f));
     //layout.add(std::make_unique<juce::AudioParameterFloat>("String Freq Dep Damp", "String Freq Dep Damp", juce::NormalisableRange<float>(0.0001f, 0.1f, 0.00001f, 0.35f), 0.005f));
     return layout;
 }
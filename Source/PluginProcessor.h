@@ -10,6 +10,13 @@
 
 #include <JuceHeader.h>
 #include "ThinPlate.h"
+#include "BlockProfiler.h"
+#include "WavefieldRecorder.h"
+#include "PlateFieldBuffer.h"
+#include "NoteExpression.h"
+#include "QualityGovernor.h"
+#include "PlateBuilder.h"
+#include "HalfBandDecimator.h"
 
 //==============================================================================
 /**
@@ -73,12 +80,92 @@ public:
     int bellGrowthMenuId = 1;
     bool tubeConn = false;
     bool springConn = true;
+    int plateShapeId = 1;
+    
+    // Plate steps once every plateRateDivider samples, strings and tube take several steps per plate step.
+    // The divider takes effect at the next prepareToPlay()
+    int plateRateDivider = 1;
+    int stringRateRatio = 1;
+    int tubeRateRatio = 1;
+    
+    // Stage timings of every block. Collected and read by the editor
+    BlockProfiler blockProfiler;
+    
+    // Lowers the quality when the blocks get too slow, and raises it again with headroom
+    QualityGovernor qualityGovernor;
+    
+    // Records the plate displacement into a file while the editor has it switched on
+    WavefieldRecorder wavefieldRecorder;
+    
+    // Starts the recorder for the current plate grid
+    juce::Result startWavefieldRecording(const juce::File& file);
+    
+    // Copies of the plate displacement for the editor's heat map
+    PlateFieldBuffer plateField;
     
 private:
     //==============================================================================
     
     double fs; // Sample rate
     float output;
+    float prevOutput = 0; // Plate outputs to interpolate between when plateRateDivider > 1
+    float nextOutput = 0;
+    int rateCounter = 0;
+    std::vector<int> noteOnSamples; // Sample positions of the note ons in the block
+    NoteExpression noteExpression; // Per-note expression (MPE) for the bow
+    
+    // The quality level the plate runs at, and the plate rate divider at that level. The plate of
+    // a new level is set up by plateBuilder, takes over the motion of the playing plate and
+    // crossfades with it over fadeLength samples
+    int qualityLevel = QualityGovernor::FullQuality;
+    int activeRateDivider = 1;
+    float rateGain = 1; // Keeps the output level of the set rate
+    int fadeLength = 1;
+    bool plateQuiet = true; // The plate was stopped or silent in the last block
+    PlateBuilder plateBuilder;
+    int buildLevel = QualityGovernor::FullQuality; // Level of the plate plateBuilder sets up
+    bool buildOffline = false; // Profile of the plate plateBuilder sets up
+    
+    // The plate of the last level during the crossfade. It steps at its own rate until it is faded out
+    std::shared_ptr<ThinPlate> fadingPlate;
+    int fadingRateDivider = 1, fadingRateCounter = 0;
+    float fadingRateGain = 1, fadingPrevOutput = 0, fadingNextOutput = 0;
+    float fadingInputSums[2] = { 0, 0 };
+    int crossfade = 0; // Samples left of the crossfade
+    
+    void setQualityLevel(int level);
+    
+    // The job for plateBuilder that sets up a plate like prepareToPlay() does
+    PlateBuilder::Job getBuildJob(const ChainSettings& chainSettings, int level, bool offline) const;
+    
+    // Makes the plate of plateBuilder the playing one, and fades the last one out if it plays. A plate
+    // of the other profile takes over at once, as a bounce doesn't continue the real-time sound
+    void switchPlate(std::shared_ptr<ThinPlate> nextPlate, int level, bool offline);
+    
+    // Offline profile for bounces (isNonRealtime()): the plate steps offlineOversampling times per
+    // sample on the full grid, with the row threads and without the governor. prepareToPlay() picks
+    // the profile. A host that changes the flag without preparing the plugin again gets the plate of
+    // the other profile from plateBuilder, so the audio thread neither sets up a plate nor starts or
+    // stops the row threads. The latency stays the one reported in prepareToPlay()
+    static constexpr int offlineOversampling = 2;
+    bool offlineProfile = false;
+    
+    // Takes the offline plate back to the sample rate. Its delay is reported to the host as latency
+    static_assert(offlineOversampling == 2, "The decimator halves the rate");
+    HalfBandDecimator offlineDecimator;
+    int plateOversampling = 1; // Plate steps per sample at a rate divider of 1
+    ThinPlate::PlateKernel realtimeKernel = ThinPlate::RowKernel;
+    
+    void startOfflineProfile();
+    static int getOfflinePlateThreads() { return juce::jlimit(1, 4, juce::SystemStats::getNumCpus() / 2); }
+    double getPlateRate() const { return fs * plateOversampling / activeRateDivider; }
+    double getPlateTimeStep() const { return activeRateDivider / (fs * plateOversampling); }
+    
+    // Input excitation (excTypeId 3), which runs the plate as an effect on the audio input. The plate
+    // sleeps while the input and its output stay below inputSleepLevel
+    bool inputAsleep = true;
+    float inputSums[2] = { 0, 0 }; // Input of each channel since the last plate step
+    static constexpr float inputSleepLevel = 1e-5f; // -100 dB
 
     std::shared_ptr<ThinPlate> thinPlate;
     
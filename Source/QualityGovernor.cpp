@@ -0,0 +1,79 @@
+/*
+  ==============================================================================
+
+    QualityGovernor.cpp
+
+  ==============================================================================
+*/
+
+#include "QualityGovernor.h"
+
+const char* QualityGovernor::getLevelName (int level)
+{
+    switch (level)
+    {
+        case FullQuality: return "full";
+        case FewerStrings: return "fewer strings";
+        case WaveguideStrings: return "waveguide strings";
+        case HalfRate: return "half rate";
+        case CoarseGrid: return "coarse grid";
+        default: return "";
+    }
+}
+
+void QualityGovernor::limitSettings (int level, ChainSettings& settings)
+{
+    if (level >= FewerStrings)
+        settings.numStrings = juce::jmin (settings.numStrings, maxStrings);
+}
+
+void QualityGovernor::limitPlate (int level, ThinPlate& plate, const ChainSettings& settings)
+{
+    // An inharmonicity limit of 1 runs every string that can be one as a waveguide
+    plate.setWaveguideStiffnessLimit (level >= WaveguideStrings ? 1.0 : ThinPlate::defaultWaveguideStiffnessLimit);
+
+    // The explicit plate stays explicit, as the implicit scheme costs more per grid point
+    if (level >= CoarseGrid)
+        plate.setImplicitScheme (settings.gridScale > 1, juce::jmax (1.0, (double) settings.gridScale) * coarseGridScale);
+}
+
+void QualityGovernor::prepare (double sampleRateToUse)
+{
+    sampleRate = sampleRateToUse;
+    upHoldSeconds = minUpHoldSeconds;
+    steppedUp = false;
+    setLevel (FullQuality);
+}
+
+void QualityGovernor::update (float load, int numSamples)
+{
+    auto seconds = numSamples / sampleRate;
+    secondsAtLevel += seconds;
+    if (secondsAtLevel < settleSeconds)
+        return;
+
+    peakLoad = juce::jmax (load, peakLoad * (float) std::exp (-seconds / settleSeconds));
+
+    auto currentLevel = level.load();
+    if (peakLoad > stepDownLoad && currentLevel < numLevels - 1)
+        requestedLevel = currentLevel + 1;
+    else if (peakLoad < stepUpLoad && 0 < currentLevel && secondsAtLevel > upHoldSeconds)
+        requestedLevel = currentLevel - 1;
+    else
+        requestedLevel = currentLevel;
+}
+
+void QualityGovernor::setLevel (int levelToSet)
+{
+    auto currentLevel = level.load();
+    if (levelToSet > currentLevel && steppedUp && secondsAtLevel < upHoldSeconds)
+        upHoldSeconds = juce::jmin (2 * upHoldSeconds, maxUpHoldSeconds);
+    else if (secondsAtLevel > maxUpHoldSeconds)
+        upHoldSeconds = minUpHoldSeconds;
+
+    steppedUp = levelToSet < currentLevel;
+    level = levelToSet;
+    requestedLevel = levelToSet;
+    peakLoad = 0;
+    secondsAtLevel = 0;
+}
@@ -0,0 +1,87 @@
+/*
+  ==============================================================================
+
+    QualityGovernor.h
+
+    Lowers the simulation quality when the blocks take too long for real time, and
+    raises it again when there is headroom. The levels add up in the order of what is
+    heard least: the strings beyond the first maxStrings go, the strings run as
+    waveguides, the plate runs at half the internal rate, and the grid gets coarser.
+
+    The governor only asks for a level, one step from the current one. The processor
+    decides when to switch and tells it with setLevel(), which also gives the new
+    level time to settle before the load counts again (the plate of the new level is
+    set up on a background thread, and both plates run during the crossfade).
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "PlateSettings.h"
+
+class QualityGovernor
+{
+public:
+    enum Level
+    {
+        FullQuality,
+        FewerStrings,
+        WaveguideStrings,
+        HalfRate,
+        CoarseGrid,
+        numLevels
+    };
+
+    static const char* getLevelName (int level);
+
+    static constexpr int maxStrings = 2; // Strings kept from FewerStrings on
+    static constexpr double coarseGridScale = 1.5; // Grid spacing at CoarseGrid, relative to the set one
+
+    // Lowers the settings to the level (before applyChainSettings())
+    static void limitSettings (int level, ChainSettings& settings);
+
+    // The string model and grid at the level (after applyChainSettings())
+    static void limitPlate (int level, ThinPlate& plate, const ChainSettings& settings);
+
+    // Plate steps per sample divider at the level, relative to the set one
+    static int getRateDivider (int level) { return level >= HalfRate ? 2 : 1; }
+
+    //==============================================================================
+    // Audio thread
+
+    // Starts at full quality
+    void prepare (double sampleRateToUse);
+
+    // At the end of every block, with the block time as a ratio of its budget
+    void update (float load, int numSamples);
+
+    int getRequestedLevel() const { return requestedLevel; }
+
+    // The level the plate now runs at
+    void setLevel (int levelToSet);
+
+    //==============================================================================
+    // Any thread
+
+    int getLevel() const { return level.load(); }
+
+private:
+    static constexpr float stepDownLoad = 0.8f; // Peak load that lowers the quality
+    static constexpr float stepUpLoad = 0.4f; // Peak load that raises it again
+    static constexpr double settleSeconds = 0.5;
+    static constexpr double minUpHoldSeconds = 3, maxUpHoldSeconds = 60;
+
+    double sampleRate = 44100;
+    std::atomic<int> level { FullQuality };
+    int requestedLevel = FullQuality;
+
+    float peakLoad = 0; // Decays with a time constant of settleSeconds
+    double secondsAtLevel = 0;
+
+    // Time without overload before a step up. Doubles when a step up had to be taken back, so a
+    // load just above the threshold doesn't switch back and forth
+    double upHoldSeconds = minUpHoldSeconds;
+    bool steppedUp = false;
+};
@@ -0,0 +1,78 @@
+/*
+  ==============================================================================
+
+    StochasticExcitation.cpp
+
+  ==============================================================================
+*/
+
+#include "StochasticExcitation.h"
+
+void StochasticExcitation::setSeed (juce::int64 seed)
+{
+    random.setSeed (seed);
+    stepsToNext = getInterval();
+}
+
+void StochasticExcitation::setTimeStep (double kToUse)
+{
+    stepsToNext *= k / kToUse;
+    k = kToUse;
+}
+
+void StochasticExcitation::setSettings (const Settings& settingsToUse)
+{
+    auto densityChanged = settingsToUse.density != settings.density;
+    settings = settingsToUse;
+
+    // The process has no memory, so the wait can start over at the new rate
+    if (densityChanged)
+        stepsToNext = getInterval();
+}
+
+int StochasticExcitation::startStep()
+{
+    int numImpacts = 0;
+    while (stepsToNext < 1)
+    {
+        ++numImpacts;
+        stepsToNext += getInterval();
+    }
+    stepsToNext -= 1;
+    return numImpacts;
+}
+
+StochasticExcitation::Impact StochasticExcitation::getImpact()
+{
+    const auto twoPi = juce::MathConstants<double>::twoPi;
+
+    // Uniform over the ellipse: the square root of the radius spreads the points evenly over the area
+    auto radius = 0.5 * settings.spread * std::sqrt (random.nextDouble());
+    auto angle = twoPi * random.nextDouble();
+    auto x = juce::jlimit (0.0, 1.0, settings.xCentre + radius * std::cos (angle));
+    auto y = juce::jlimit (0.0, 1.0, settings.yCentre + radius * std::sin (angle));
+
+    // Box-Muller for the normal deviate of the log of the force
+    auto normal = std::sqrt (-2 * std::log (1 - random.nextDouble())) * std::cos (twoPi * random.nextDouble());
+    return { x, y, settings.force * std::exp (settings.forceSpread * normal) };
+}
+
+void StochasticExcitation::writeState (juce::OutputStream& stream) const
+{
+    stream.writeInt64 (random.getSeed());
+    stream.writeDouble (stepsToNext);
+}
+
+bool StochasticExcitation::readState (juce::InputStream& stream)
+{
+    random.setSeed (stream.readInt64());
+    stepsToNext = stream.readDouble();
+    return ! std::isnan (stepsToNext);
+}
+
+double StochasticExcitation::getInterval()
+{
+    if (! isActive())
+        return std::numeric_limits<double>::infinity();
+    return -std::log (1 - random.nextDouble()) / (settings.density * k);
+}
@@ -0,0 +1,71 @@
+/*
+  ==============================================================================
+
+    StochasticExcitation.h
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <limits>
+
+//==============================================================================
+/*
+    Random impacts for textures like rain, gravel or brushes. The impacts arrive as a Poisson
+    process of the given density, and each one is a force held over a single time step. The
+    force is log-normal around its median. The positions are uniform over an ellipse around the
+    centre, which covers the plate at spread 1.
+
+    The plate asks for the number of impacts at the start of each step and draws them one by one
+    into its list of point forces, which it adds after the update in one pass. So the cost grows
+    with the number of impacts and not with the grid, and thousands of impacts per second cost
+    less than one extra row of the plate.
+*/
+class StochasticExcitation
+{
+public:
+    struct Settings
+    {
+        double density = 0; // Mean impacts per second (0 = off)
+        double force = 10; // Median force of an impact (in N)
+        double forceSpread = 0.5; // Standard deviation of the log of the force
+        double xCentre = 0.5, yCentre = 0.5; // Centre of the impact area (ratio of the plate)
+        double spread = 1; // Radius of the impact area relative to half the plate
+    };
+
+    struct Impact
+    {
+        double xRatio, yRatio, force;
+    };
+
+    // Each instance starts from a seed of its own. Set one for impacts that repeat from run to run
+    void setSeed (juce::int64 seed);
+
+    // Keeps the wait for the next impact in seconds and the generator as they are
+    void setTimeStep (double kToUse);
+
+    // A new density starts a new wait for the next impact
+    void setSettings (const Settings& settingsToUse);
+
+    bool isActive() const { return 0 < settings.density; }
+
+    // Number of impacts in the next time step, which getImpact() then draws
+    int startStep();
+
+    Impact getImpact();
+
+    // Generator and wait for a snapshot
+    void writeState (juce::OutputStream& stream) const;
+    bool readState (juce::InputStream& stream);
+
+private:
+    // Exponential time to the next impact, in steps
+    double getInterval();
+
+    Settings settings;
+    double k = 1;
+    juce::Random random { juce::Random::getSystemRandom().nextInt64() };
+    double stepsToNext = std::numeric_limits<double>::infinity();
+};
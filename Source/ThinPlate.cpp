@@ -10,6 +10,57 @@
 
 #include "ThinPlate.h"
 #include <math.h>
+#include <thread>
+
+//==============================================================================
+class ThinPlate::RowWorker : public juce::Thread
+{
+public:
+    RowWorker (ThinPlate& plateToUse, int bandToUse)
+        : juce::Thread ("Plate rows " + juce::String (bandToUse)), plate (plateToUse), band (bandToUse)
+    {
+    }
+
+    void run() override
+    {
+        juce::int64 step = 0;
+        int spins = 0;
+        while (! threadShouldExit())
+        {
+            // Spins while the plate steps, and parks once it stops until calculatePlateBands() wakes
+            // it. The step is read again after parked is set, so a step handed over meanwhile either
+            // is seen here or finds parked set and notifies
+            if (plate.rowStep.load (std::memory_order_acquire) == step)
+            {
+                if (++spins > 4096)
+                {
+                    parked.store (true);
+                    if (plate.rowStep.load() == step)
+                        wait (-1);
+                    parked.store (false);
+                    spins = 0;
+                }
+                else if (spins > 64)
+                {
+                    std::this_thread::yield();
+                }
+                continue;
+            }
+
+            spins = 0;
+            ++step;
+            plate.calculatePlateBand (plate.rowBands[band], plate.rowBands[band + 1]);
+            finishedStep.store (step, std::memory_order_release);
+        }
+    }
+
+    std::atomic<juce::int64> finishedStep { 0 };
+    std::atomic<bool> parked { false };
+
+private:
+    ThinPlate& plate;
+    int band;
+};
 
 //==============================================================================
 ThinPlate::ThinPlate (double kIn) : k (kIn) // <- This is an initialiser list. It initialises the member variable 'k' (in the "private" section in OneDWave.h), using the argument of the constructor 'kIn'.
@@ -17,6 +68,12 @@ ThinPlate::ThinPlate (double kIn) : k (kIn) // <- This is an initialiser list. I
     firstHit = false;
     tubeConn= false;
     tol = 1e-7;
+    vRel = 0;
+    vRelPrev = 0;
+    currentAngleLFO = 0;
+    envelopeSegments.reserve(maxEnvelopeSegments);
+    excitationForces.reserve(4 * (maxMalletPulses + maxInputForces + maxStepImpacts));
+    stochasticExcitation.setTimeStep(k);
     Lx= 0.5;
     Ly = 0.5; //side length (y)
     c = 343; //speed of sound
@@ -70,12 +127,15 @@ ThinPlate::ThinPlate (double kIn) : k (kIn) // <- This is an initialiser list. I
     sigma0S = 0.2;
     sigma1S = 0.005;
     TavgS = 1200;
+    TDiffS = 25;
     numStrings= 7;
+    springConn = true;
     initParameters();
 }
 
 ThinPlate::~ThinPlate()
 {
+    setPlateThreads(1);
 }
 
 void ThinPlate::getSampleRate(double fsToSet)
@@ -83,24 +143,76 @@ void ThinPlate::getSampleRate(double fsToSet)
     fs = fsToSet;
 }
 
+void ThinPlate::setTimeStep(double kToSet)
+{
+    k = kToSet;
+    stochasticExcitation.setTimeStep(k);
+}
+
 
 
+PlateGeometry::Settings ThinPlate::getGeometrySettings()
+{
+    PlateGeometry::Settings settings;
+    settings.k = k;
+    settings.E = E;
+    settings.H = H;
+    settings.nu = nu;
+    settings.rho = rho;
+    settings.sigma0 = sigma0;
+    settings.sigma1 = sigma1;
+    settings.Lx = Lx;
+    settings.Ly = Ly;
+    settings.plateShape = plateShape;
+    settings.implicitScheme = implicitScheme;
+    settings.gridScale = gridScale;
+    settings.numStrings = numStrings;
+    settings.stringRatio = pendingStringRatio;
+    settings.LS = LS;
+    settings.rS = rS;
+    settings.rhoS = rhoS;
+    settings.ES = ES;
+    settings.sigma0S = sigma0S;
+    settings.sigma1S = sigma1S;
+    settings.TavgS = TavgS;
+    settings.TDiffS = TDiffS;
+    settings.sPosSpread = sPosSpread;
+    settings.tubeConn = tubeConn;
+    settings.tubeRatio = pendingTubeRatio;
+    settings.cLT = cLT;
+    settings.bLT = bLT;
+    settings.cRT = cRT;
+    settings.bRT = bRT;
+    settings.shape = shape;
+    return settings;
+}
+
 void ThinPlate::initParameters()
 {
-    D = E*pow(H,3)/(12*(1-pow(nu,2))); // stifness coefficient
-    kappa = sqrt(D/(rho*H)); // stifness paramater
-    h = 2*sqrt(k*(sigma1+sqrt(pow(kappa,2)+pow(sigma1,2))));
-    Nx = floor(Lx/h); //grid steps (x)
-    Ny = floor(Ly/h); //grid steps (y)
-    h = std::min (Lx / Nx, Ly / Ny); //redefine grid spacing (using the smallest dimension)
-    N = (Nx+1)*(Ny+1);
+    stringRatio = pendingStringRatio;
+    tubeRatio = pendingTubeRatio;
     
-    mu = kappa*k/pow(h,2);
-    muSq = mu * mu;
-    S = 2 * sigma1 * k /pow(h,2);
+    // The derived coefficients are shared with every plate set up the same way
+    geometry = getPlateGeometry(getGeometrySettings());
+    const auto& g = *geometry;
     
-    hx = Lx/Nx;
-    hy = Ly/Ny;
+    D = g.D;
+    kappa = g.kappa;
+    h = g.h;
+    implicitActive = implicitScheme;
+    Nx = g.Nx;
+    Ny = g.Ny;
+    N = g.N;
+    
+    mu = g.mu;
+    muSq = g.muSq;
+    S = g.S;
+    
+    hx = g.hx;
+    hy = g.hy;
+    cellRuns = g.cellRuns.data();
+    rowRuns = g.rowRuns.data();
+    cellMask = g.cellMask.data();
     
     excXpos = excXposRatio*Lx;
     excYpos = excYposRatio*Ly;
@@ -111,12 +223,49 @@ void ThinPlate::initParameters()
     
     J=0;
     n=0;
+    stringOut = 0;
+    tubeOut = 0;
     
     
     uStates = std::vector<std::vector<std::vector<double>>> (3, std::vector<std::vector<double>>(Nx, std::vector<double>(Ny, 0)));
     uNext = &uStates[0][0]; //Initialise time step u^n+1
     u = &uStates[1][0]; //Initialise time step u^n
     uPrev = &uStates[2][0]; //Initialise time step u^n-1
+    
+    // The plate is at rest, so only the connection points are active (added in buildConnections())
+    activeRegion = {};
+    if (activeTracking == false || implicitActive == true)
+    {
+        setFullActiveRegion();
+    }
+    
+    // A plate at rest is symmetric. buildConnections() turns the reduction off for connections off the centre line
+    mirrorSymmetric = symmetryReduction == true && implicitActive == false && g.mirrorSymmetric == true;
+    
+    plateConnTerm = g.plateConnTerm;
+    
+    nonlinearActive = 0 < nonlinearGain && implicitActive == false;
+    stressPsi = 0;
+    if (nonlinearActive == true)
+    {
+        forceTerm = k*k/(rho*H*(1+sigma0*k));
+        displacementScale = nonlinearGain*forceTerm;
+        stressScale = 0.5*E*H;
+        stressSolver.prepare(Nx, Ny, h);
+        stressGradient.assign(Nx*Ny, 0);
+    }
+    
+    if (implicitActive == true)
+    {
+        implicitSolver.prepare(Nx, Ny, 1 + sigma0*k, theta*muSq, 0.5*S);
+        implicitRhs.assign(implicitSolver.getSize(), 0);
+        implicitX.assign(implicitSolver.getSize(), 0);
+        implicitW.assign(implicitSolver.getSize(), 0);
+        
+        // Room for both plate ends of every connection, so the step never has to look for a response it lacks
+        plateResponses.clear();
+        plateResponses.reserve(2 * (2 * numStrings + 1 + addedConnections.size()));
+    }
     //auto NSMaxP =  std::max_element(std::begin(NS),std::end(NS));
 
     if (0 < numStrings)
@@ -128,88 +277,53 @@ void ThinPlate::initParameters()
         stringConn = false;
     }
     
+    kS = k / stringRatio;
+    kT = k / tubeRatio;
+    
     if (stringConn == true)
     {
-        eta.resize(numStrings);
-        etaPrev.resize(numStrings);
-        etaNext.resize(numStrings);
-        rPlus.resize(numStrings);
-        rMinus.resize(numStrings);
-        connF.resize(numStrings);
-        connXPos.resize(numStrings);
-        connXPos2.resize(numStrings);
-        lcS.resize(numStrings);
-        lcP.resize(numStrings);
-        lcS2.resize(numStrings);
-        lcP2.resize(numStrings);
-        NS.resize(numStrings);
-        cSSq.resize(numStrings);
-        TS.resize(numStrings);
-        hS.resize(numStrings);
-        lambdaSSq.resize(numStrings);
-        muSSq.resize(numStrings);
-        uS1.resize(numStrings);
-        uS2.resize(numStrings);
-        uS3.resize(numStrings);
-        stringConnTerm.resize(numStrings);
+        lcS = g.lcS;
+        lcP = g.lcP;
+        lcS2 = g.lcS2;
+        stringConnTerm = g.stringConnTerm;
+        waveguides.resize(numStrings);
+        waveguideString.assign(numStrings, false);
+        waveguideOut.resize(numStrings);
+        
+        IS = g.IS;
+        AS = g.AS;
+        kappaSSq = g.kappaSSq;
+        As = g.As;
+        TS = g.TS.data();
+        NS = g.NS.data();
+        cSSq = g.cSSq.data();
+        hS = g.hS.data();
+        lambdaSSq = g.lambdaSSq.data();
+        muSSq = g.muSSq.data();
+        uS1 = g.uS1.data();
+        uS2 = g.uS2.data();
+        uS3 = g.uS3.data();
         
-        IS = M_PI * rS*rS*rS*rS / 4;
-        AS = M_PI * rS*rS;
-        kappaSSq = ES * IS / (rhoS * AS);
-        As = 1 + sigma0S * k;
+        connSPos = g.connSPos;
+        connSPos2 = g.connSPos2;
+        mcP = g.mcP;
+        mcP2 = g.mcP2;
         
         for (int nS = 0; nS < numStrings; ++nS)
         {
-            connSPos = 0.1 * LS;
-            connSPos2 = LS - connSPos;
-            if (nS == 0)
-            {
-                connXPos[nS] = Lx * 0.5;
-                connYPos =  Ly * 0.5 + LS * 0.4;
-                //connXPos2[nS] = connXPos[nS];
-                connYPos2 = Ly * 0.5 - LS * 0.4;
-                TS[nS] = TavgS;
-                
-            }
-            else if (nS % 2)
-            {
-                connXPos[nS] = Lx * 0.5 + Lx * 0.5 * nS/numStrings * sPosSpread/100;
-                connYPos = Ly * 0.5 + LS * 0.4;
-                //connXPos2[nS] = connXPos[nS];
-                connYPos2 = Ly * 0.5 - LS * 0.4;
-                TS[nS] = TavgS + TavgS*TDiffS/(200*nS);
-            }
-            else
+            // A lightly stiff string is cheaper as a waveguide at the plate rate. It only keeps its
+            // state at the connection and output points, so those become its taps
+            if (WaveguideString::getInharmonicity(ES, IS, TS[nS], LS) < waveguideStiffnessLimit
+                && waveguides[nS].prepare(k, LS, TS[nS], rhoS * AS, ES, IS, sigma0S, sigma1S))
             {
-                connXPos[nS] = Lx * 0.5 - Lx * 0.5 * (nS-1)/numStrings * sPosSpread/100;
-                connYPos = Ly * 0.5 + LS * 0.4;
-                //connXPos2[nS] = connXPos[nS];
-                connYPos2 = Ly * 0.5 - LS * 0.4;
-                TS[nS] = TavgS - TavgS*TDiffS/(200*(nS-1));
+                waveguideString[nS] = true;
+                lcS[nS] = waveguides[nS].addTap(connSPos/LS);
+                lcS2[nS] = waveguides[nS].addTap(connSPos2/LS);
+                waveguideOut[nS] = waveguides[nS].addTap(0.5);
+                stringConnTerm[nS] = waveguides[nS].getMassTerm();
             }
-            //TS[nS] = TavgS;
-            cSSq[nS] = TS[nS] / (rhoS * AS);
-            hS[nS] = sqrt((cSSq[nS]  * k*k + 4 * sigma1S * k + sqrt((cSSq[nS]  * k*k + 4 * sigma1S * k)*(cSSq[nS]  * k*k + 4 * sigma1S * k) + 16 * kappaSSq * k*k))/2);
-            NS[nS]  = floor(LS/hS[nS]);
-            hS[nS] = LS / NS[nS];
-            lambdaSSq[nS] = cSSq[nS]*k*k/(hS[nS]*hS[nS]);
-            muSSq[nS] = kappaSSq*k*k/(hS[nS]*hS[nS]*hS[nS]*hS[nS]);
-            uS1[nS]  = 2-2*lambdaSSq[nS]-6*muSSq[nS]-4*sigma1S*k/(hS[nS]*hS[nS]);
-            uS2[nS] = lambdaSSq[nS]+4*muSSq[nS]+2*sigma1S*k/(hS[nS]*hS[nS]);
-            uS3[nS] = -1+sigma0S*k + 4*sigma1S*k/(hS[nS]*hS[nS]);
-            
-            stringConnTerm[nS] = k * k / (rhoS * AS * hS[nS] * (1.0 + sigma0S * k));
-            
-            //alphaConnS[nS] = connSPos[nS]/hS[nS] - lcS(i)
-            lcS[nS]  = floor(connSPos/hS[nS]);
-            lcP[nS] = floor(connXPos[nS]/hx);
-            mcP = floor(connYPos/hy);
-            
-            lcS2[nS]  = floor(connSPos2/hS[nS]);
-            //lcP2[nS] = floor(connXPos2[nS]/hx);
-            mcP2 = floor(connYPos2/hy);
         }
-        NSMax = NS[0];
+        NSMax = g.NSMax;
         uStringStates =std::vector<std::vector<std::vector<double>>> (3, std::vector<std::vector<double>>(numStrings, std::vector<double>(NSMax+1, 0)));
         
         uStringNext = &uStringStates[0][0]; //Initialise time step u^n+1
@@ -230,33 +344,26 @@ void ThinPlate::initParameters()
     
     if (tubeConn == true)
     {
-        cT = 343;
-        rhoT = 1.225;
-        LT = cLT + bLT;
-        hT = cT *k;
-        nCT = floor(cLT/h);
-        nBT = floor(bLT/h);
-        NT = nCT + nBT;
-        hT = LT/NT;
-        lambdaT = cT*k/hT;
-        sC.clear();
-        sC.resize(nCT+1,0);
-        sB.clear();
-        sB.resize(nBT,0);
-        ST.clear();
-        ST.resize(NT+1,0);
-        calculateBoreShape();
-        R1 = rhoT*cT;
-        R2 = 0.505* rhoT*cT;
-        
-        Lr = 0.613*rhoT*sqrt(ST[NT]/juce::MathConstants<double>::pi);
-        Cr = 1.111* sqrt(ST[NT])/(rhoT*cT*cT*sqrt(juce::MathConstants<double>::pi));
-        zeta1=(2*R2*k)/(2*R1*R2*Cr+k*(R1+R2));
-        zeta2 = (2*R1*R2*Cr-k*(R1+R2))/(2*R1*R2*Cr+k*(R1+R2));
-        zeta3 = k/(2*Lr)+zeta1/(2*R2)+(Cr*zeta1)/k;
-        zeta4 = (zeta2+1)/(2*R2)+(Cr*zeta2-Cr)/k;
+        cT = g.cT;
+        rhoT = g.rhoT;
+        LT = g.LT;
+        hT = g.hT;
+        nCT = g.nCT;
+        nBT = g.nBT;
+        NT = g.NT;
+        lambdaT = g.lambdaT;
+        ST = g.ST.data();
+        R1 = g.R1;
+        R2 = g.R2;
+        Lr = g.Lr;
+        Cr = g.Cr;
+        zeta1 = g.zeta1;
+        zeta2 = g.zeta2;
+        zeta3 = g.zeta3;
+        zeta4 = g.zeta4;
         vInt = 0;
         pInt = 0;
+        mouthDisplacement[0] = mouthDisplacement[1] = mouthDisplacement[2] = 0;
         
         vStates.reserve(2 * NT);
         vStates = std::vector<std::vector<double>> (2,
@@ -275,15 +382,504 @@ void ThinPlate::initParameters()
         for (int i = 0; i < 3; ++i)
             p[i] = &pStates[i][0];
         
-        tubeConn = k* k / (rhoT * ST[0] * hT);
+        // The tube's end of the connection is the air at the mouth, which moves with the first velocity
+        // point. A force F on it is a pressure F / S there, and moves it by kT^2 F / (rho S h) in one step
+        tubeConnTerm = kT* kT / (rhoT * ST[0] * hT);
         lcPT = floor(Nx*0.5);
         mcPT = floor(Ny*0.5);
         lcT = 0;
     }
     
-    plateConnTerm = (k*k)/(rho*H*h*h*(1+sigma0*k));
+    buildConnections();
+    snapExcitationToAxis();
+}
+
+void ThinPlate::clearState()
+{
+    for (auto& grids : uStates)
+        for (auto& row : grids)
+            std::fill(row.begin(), row.end(), 0.0);
+    if (stringConn == true)
+    {
+        for (auto& strings : uStringStates)
+            for (auto& string : strings)
+                std::fill(string.begin(), string.end(), 0.0);
+        for (int nS = 0; nS < numStrings; ++nS)
+            if (waveguideString[nS] == true)
+                waveguides[nS].clearState();
+    }
+    if (tubeConn == true)
+    {
+        for (auto* states : { &pStates, &vStates })
+            for (auto& state : *states)
+                std::fill(state.begin(), state.end(), 0.0);
+        mouthDisplacement[0] = mouthDisplacement[1] = mouthDisplacement[2] = 0;
+        vInt = 0;
+        pInt = 0;
+    }
+    
+    connectionGraph.clearState();
+    for (auto* history : { &historyA, &historyB, &etaHalfPrev })
+        std::fill(history->begin(), history->end(), 0.0);
+    stressPsi = 0;
+    stringOut = 0;
+    tubeOut = 0;
+    numMalletPulses = 0;
+    excitationForces.clear();
+    excitationForceRegion = {};
+    
+    activeRegion = {};
+    activeRegion.include(activeSources);
+    if (activeTracking == false || implicitActive == true)
+    {
+        setFullActiveRegion();
+    }
+}
+
+void ThinPlate::transferState(ThinPlate& other)
+{
+    clearState();
+    
+    /*
+        u is in units of k^2 / (rho H (1 + sigma0 k)), so the displacement is rescaled by the ratio
+        of these. The grids are mapped onto each other between the clamped edges at l = 1, Nx-2 and
+        m = 1, Ny-2, and u^n-1 is taken a step of this plate back from u^n, along the velocity of
+        the other plate's last step
+    */
+    const auto scale = (other.k*other.k/(1+other.sigma0*other.k)) / (k*k/(1+sigma0*k));
+    const auto stepRatio = k / other.k;
+    const auto xRatio = (other.Nx-3.0) / (Nx-3.0);
+    const auto yRatio = (other.Ny-3.0) / (Ny-3.0);
+    for (int l = 2; l < Nx-2; ++l)
+    {
+        auto x = 1 + (l-1)*xRatio;
+        auto lOther = juce::jlimit(1, other.Nx-3, static_cast<int> (x));
+        auto ax = x - lOther;
+        for (int m = 2; m < Ny-2; ++m)
+        {
+            if (implicitActive == false && isPlateCell(l, m) == false)
+                continue;
+            
+            auto y = 1 + (m-1)*yRatio;
+            auto mOther = juce::jlimit(1, other.Ny-3, static_cast<int> (y));
+            auto ay = y - mOther;
+            auto interpolate = [&] (const std::vector<double>* grid)
+            {
+                return (1-ax)*(1-ay)*grid[lOther][mOther] + (1-ax)*ay*grid[lOther][mOther+1]
+                    + ax*(1-ay)*grid[lOther+1][mOther] + ax*ay*grid[lOther+1][mOther+1];
+            };
+            auto uCur = interpolate(other.u);
+            u[l][m] = scale*uCur;
+            uPrev[l][m] = scale*(uCur + stepRatio*(interpolate(other.uPrev) - uCur));
+        }
+    }
+    
+    const bool sameRate = k == other.k;
+    if (stringConn == true && other.stringConn == true && sameRate == true && stringRatio == other.stringRatio
+        && numStrings == other.numStrings && NSMax == other.NSMax && waveguideString == other.waveguideString)
+    {
+        for (int nS = 0; nS < numStrings; ++nS)
+        {
+            if (waveguideString[nS] == true)
+            {
+                waveguides[nS] = other.waveguides[nS];
+                continue;
+            }
+            std::copy(other.uString[nS].begin(), other.uString[nS].end(), uString[nS].begin());
+            std::copy(other.uStringPrev[nS].begin(), other.uStringPrev[nS].end(), uStringPrev[nS].begin());
+        }
+        stringOut = other.stringOut;
+    }
+    if (tubeConn == true && other.tubeConn == true && sameRate == true && tubeRatio == other.tubeRatio && NT == other.NT)
+    {
+        for (int i = 0; i < 3; ++i)
+            std::copy(other.p[i], other.p[i] + NT+1, p[i]);
+        for (int i = 0; i < 2; ++i)
+            std::copy(other.v[i], other.v[i] + NT, v[i]);
+        std::copy(other.mouthDisplacement, other.mouthDisplacement + 3, mouthDisplacement);
+        vInt = other.vInt;
+        pInt = other.pInt;
+        tubeOut = other.tubeOut;
+    }
+    resetConnectionHistory();
+    
+    // The excitation goes on where it was, with its step counts in steps of this plate
+    t = other.t;
+    n = juce::roundToInt(other.n / stepRatio);
+    currentAngleLFO = other.currentAngleLFO;
+    vRel = other.vRel;
+    vRelPrev = other.vRelPrev;
+    firstHit = other.firstHit;
+    isBowing = other.isBowing;
+    bowEnd = other.bowEnd;
+    adsr1 = other.adsr1;
+    setADSR(fs);
+    envelopeSegments.clear();
+    for (auto samples : other.envelopeSegments)
+        envelopeSegments.push_back(juce::roundToInt(samples / stepRatio));
+    numMalletPulses = other.numMalletPulses;
+    for (int i = 0; i < numMalletPulses; ++i)
+    {
+        auto& pulse = malletPulses[i];
+        pulse = other.malletPulses[i];
+        pulse.delay = juce::roundToInt(pulse.delay / stepRatio);
+        pulse.step = juce::roundToInt(pulse.step / stepRatio);
+        pulse.numSteps = std::max(pulse.step + 1, static_cast<int> (floor(pulse.duration*fs)));
+    }
+    
+    // The motion can be anywhere on the plate. The tracking narrows the region down again
+    setFullActiveRegion();
+    mirrorSymmetric = false;
+}
+
+void ThinPlate::buildConnections()
+{
+    connectionGraph.clear();
+    responsesA.clear();
+    responsesB.clear();
+    applyTermA.clear();
+    applyTermB.clear();
+    multirateConn.clear();
+    if (stringConn == true)
+    {
+        for (int nS = 0; nS < numStrings; ++nS)
+        {
+            addConnectionToGraph({{ConnectionObject::String, nS, lcS[nS], 0, stringConnTerm[nS]}, {ConnectionObject::Plate, 0, lcP[nS], static_cast<int> (mcP), plateConnTerm}, K1, K3, R, springConn});
+            addConnectionToGraph({{ConnectionObject::String, nS, lcS2[nS], 0, stringConnTerm[nS]}, {ConnectionObject::Plate, 0, lcP[nS], static_cast<int> (mcP2), plateConnTerm}, K1, K3, R, springConn});
+        }
+    }
+    if (tubeConn == true)
+    {
+        addConnectionToGraph({{ConnectionObject::Tube, 0, lcT, 0, tubeConnTerm}, {ConnectionObject::Plate, 0, lcPT, mcPT, plateConnTerm}, K1, K3, R, springConn});
+    }
+    for (auto& conn : addedConnections)
+    {
+        addConnectionToGraph(conn);
+    }
+    
+    // The implicit plate also couples connections at different plate points
+    auto numConn = connectionGraph.getNumConnections();
+    if (implicitActive == true)
+    {
+        for (int i = 0; i < numConn; ++i)
+        {
+            for (int j = 0; j < numConn; ++j)
+            {
+                if (i == j)
+                    continue;
+                
+                const auto& ci = connectionGraph.getConnection(i);
+                const auto& cj = connectionGraph.getConnection(j);
+                double coupling = 0;
+                for (const auto* pi : {&ci.a, &ci.b})
+                {
+                    for (const auto* pj : {&cj.a, &cj.b})
+                    {
+                        if (pi->object != ConnectionObject::Plate || pj->object != ConnectionObject::Plate || (pi->l == pj->l && pi->m == pj->m))
+                            continue;
+                        
+                        auto sign = (pi == &ci.a ? 1.0 : -1.0) * (pj == &cj.a ? 1.0 : -1.0);
+                        coupling += sign * getPlateCoupling(pi->l, pi->m, pj->l, pj->m);
+                    }
+                }
+                if (coupling != 0)
+                {
+                    connectionGraph.addCoupling(i, j, (multirateConn[i] == true ? 0.5 : 1.0) * coupling);
+                }
+            }
+        }
+    }
+    connectionGraph.prepare(1.0 / k);
+    
+    activeSources = {};
+    for (int i = 0; i < numConn; ++i)
+    {
+        const auto& conn = connectionGraph.getConnection(i);
+        for (const auto* point : {&conn.a, &conn.b})
+        {
+            if (point->object == ConnectionObject::Plate && point->l >= 2 && point->l < Nx-2 && point->m >= 2 && point->m < Ny-2)
+            {
+                activeSources.include(point->l, point->m);
+            }
+            if (point->object == ConnectionObject::Plate && 2*point->l != Nx-1)
+            {
+                mirrorSymmetric = false;
+            }
+        }
+    }
+    activeRegion.include(activeSources);
+    
+    historyA.resize(numConn);
+    historyB.resize(numConn);
+    etaHalfPrev.resize(numConn);
+    resetConnectionHistory();
+}
+
+void ThinPlate::resetConnectionHistory()
+{
+    for (int i = 0; i < connectionGraph.getNumConnections(); ++i)
+    {
+        const auto& conn = connectionGraph.getConnection(i);
+        historyA[i] = 0.5 * (getConnectionState(conn.a, 1) + getConnectionState(conn.a, 2));
+        historyB[i] = 0.5 * (getConnectionState(conn.b, 1) + getConnectionState(conn.b, 2));
+        etaHalfPrev[i] = historyA[i] - historyB[i];
+        connectionGraph.etaPrev[i] = etaHalfPrev[i];
+    }
+    connectionGraph.resetForces();
+}
+
+std::vector<int> ThinPlate::getStateLayout()
+{
+    std::vector<int> layout { juce::roundToInt(1 / k), Nx, Ny, implicitActive ? 1 : 0, stringRatio, tubeRatio, connectionGraph.getNumConnections() };
+    layout.push_back(stringConn == true ? numStrings : -1);
+    if (stringConn == true)
+    {
+        layout.push_back(static_cast<int> (NSMax));
+        for (int nS = 0; nS < numStrings; ++nS)
+            layout.push_back(waveguideString[nS] == true ? 1 : 0);
+    }
+    layout.push_back(tubeConn == true ? NT : -1);
+    return layout;
+}
+
+void ThinPlate::writeState(juce::OutputStream& stream)
+{
+    auto layout = getStateLayout();
+    stream.writeInt(static_cast<int> (layout.size()));
+    for (auto value : layout)
+        stream.writeInt(value);
+    
+    stream.writeInt(n);
+    for (auto value : { t, currentAngleLFO, vRel, vRelPrev, nextAdsr1, excitation, malletForce, excXpos, excYpos, alphaX, alphaY, stringOut, tubeOut })
+        stream.writeDouble(value);
+    stream.writeInt(excXidx);
+    stream.writeInt(excYidx);
+    stream.writeBool(isBowing);
+    stream.writeBool(bowEnd);
+    stream.writeBool(firstHit);
+    stream.writeInt(static_cast<int> (envelopeSegments.size()));
+    for (auto samples : envelopeSegments)
+        stream.writeInt(samples);
+    
+    for (auto* grid : { uNext, u, uPrev })
+        for (int l = 0; l < Nx; ++l)
+            stream.write(grid[l].data(), grid[l].size() * sizeof(double));
+    
+    for (int nS = 0; nS < numStrings && stringConn == true; ++nS)
+    {
+        if (waveguideString[nS] == true)
+        {
+            waveguides[nS].writeState(stream);
+            continue;
+        }
+        for (auto* strings : { uStringNext, uString, uStringPrev })
+            stream.write(strings[nS].data(), strings[nS].size() * sizeof(double));
+    }
+    
+    if (tubeConn == true)
+    {
+        for (int i = 0; i < 3; ++i)
+            stream.write(p[i], (NT+1) * sizeof(double));
+        for (int i = 0; i < 2; ++i)
+            stream.write(v[i], NT * sizeof(double));
+        stream.write(mouthDisplacement, 3 * sizeof(double));
+        stream.writeDouble(vInt);
+        stream.writeDouble(pInt);
+    }
+    
+    connectionGraph.writeState(stream);
+    for (auto* history : { &historyA, &historyB, &etaHalfPrev })
+        stream.write(history->data(), history->size() * sizeof(double));
+    stream.writeDouble(stressPsi);
+    stream.writeInt(numMalletPulses);
+    for (int i = 0; i < numMalletPulses; ++i)
+    {
+        const auto& pulse = malletPulses[i];
+        for (auto value : { pulse.xRatio, pulse.yRatio, pulse.force, pulse.duration })
+            stream.writeDouble(value);
+        for (auto value : { pulse.delay, pulse.step, pulse.numSteps })
+            stream.writeInt(value);
+    }
+    stochasticExcitation.writeState(stream);
+}
+
+static bool readDoubles(juce::InputStream& stream, double* data, size_t num)
+{
+    auto numBytes = static_cast<int> (num * sizeof(double));
+    return stream.read(data, numBytes) == numBytes;
+}
+
+juce::Result ThinPlate::readState(juce::InputStream& stream)
+{
+    auto layout = getStateLayout();
+    auto layoutOk = stream.readInt() == static_cast<int> (layout.size());
+    for (size_t i = 0; i < layout.size() && layoutOk; ++i)
+        layoutOk = stream.readInt() == layout[i];
+    if (! layoutOk)
+        return juce::Result::fail("The state is from a plate with a different grid or different connections");
+    
+    n = stream.readInt();
+    for (auto* value : { &t, &currentAngleLFO, &vRel, &vRelPrev, &nextAdsr1, &excitation, &malletForce, &excXpos, &excYpos, &alphaX, &alphaY, &stringOut, &tubeOut })
+        *value = stream.readDouble();
+    excXidx = stream.readInt();
+    excYidx = stream.readInt();
+    isBowing = stream.readBool();
+    bowEnd = stream.readBool();
+    firstHit = stream.readBool();
+    auto numSegments = stream.readInt();
+    envelopeSegments.clear();
+    for (int i = 0; i < numSegments && i < maxEnvelopeSegments; ++i)
+        envelopeSegments.push_back(stream.readInt());
+    
+    auto ok = juce::isPositiveAndBelow(numSegments, maxEnvelopeSegments + 1);
+    for (auto* grid : { uNext, u, uPrev })
+        for (int l = 0; l < Nx && ok; ++l)
+            ok = readDoubles(stream, grid[l].data(), grid[l].size());
+    
+    for (int nS = 0; nS < numStrings && stringConn == true && ok; ++nS)
+    {
+        if (waveguideString[nS] == true)
+        {
+            ok = waveguides[nS].readState(stream);
+            continue;
+        }
+        for (auto* strings : { uStringNext, uString, uStringPrev })
+            ok = ok && readDoubles(stream, strings[nS].data(), strings[nS].size());
+    }
+    
+    if (tubeConn == true && ok)
+    {
+        for (int i = 0; i < 3; ++i)
+            ok = ok && readDoubles(stream, p[i], NT+1);
+        for (int i = 0; i < 2; ++i)
+            ok = ok && readDoubles(stream, v[i], NT);
+        ok = ok && readDoubles(stream, mouthDisplacement, 3);
+        vInt = stream.readDouble();
+        pInt = stream.readDouble();
+    }
+    
+    ok = ok && connectionGraph.readState(stream);
+    for (auto* history : { &historyA, &historyB, &etaHalfPrev })
+        ok = ok && readDoubles(stream, history->data(), history->size());
+    ok = ok && readDoubles(stream, &stressPsi, 1);
+    numMalletPulses = ok ? stream.readInt() : 0;
+    ok = ok && juce::isPositiveAndNotGreaterThan(numMalletPulses, maxMalletPulses);
+    for (int i = 0; i < numMalletPulses && ok; ++i)
+    {
+        auto& pulse = malletPulses[i];
+        for (auto* value : { &pulse.xRatio, &pulse.yRatio, &pulse.force, &pulse.duration })
+            *value = stream.readDouble();
+        for (auto* value : { &pulse.delay, &pulse.step, &pulse.numSteps })
+            *value = stream.readInt();
+    }
+    ok = ok && stochasticExcitation.readState(stream);
+    
+    if (! ok || (isBowing == true && envelopeSegments.empty()))
+    {
+        numMalletPulses = 0;
+        initParameters();
+        isBowing = false;
+        bowEnd = true;
+        envelopeSegments.clear();
+        adsr1.reset();
+        return juce::Result::fail("The state is incomplete or damaged");
+    }
+    
+    // The state can be anywhere on the plate. The tracking narrows the region down again
+    setFullActiveRegion();
+    mirrorSymmetric = false;
+    
+    // Same envelope calls as the bows it went through
+    adsr1.reset();
+    for (auto samples : envelopeSegments)
+    {
+        adsr1.noteOn();
+        for (int i = 0; i < samples; ++i)
+            adsr1.getNextSample();
+    }
+    if (isBowing == false)
+        adsr1.noteOff();
+    return juce::Result::ok();
+}
+
+void ThinPlate::addConnectionToGraph(Connection conn)
+{
+    // A plate point outside the shape is clamped, so a force doesn't move it
+    for (auto* point : {&conn.a, &conn.b})
+    {
+        if (point->object == ConnectionObject::Plate && implicitActive == false && isPlateCell(point->l, point->m) == false)
+        {
+            point->massTerm = 0;
+        }
+    }
     
+    ForceResponse responseA, responseB;
+    applyTermA.push_back(conn.a.massTerm);
+    applyTermB.push_back(conn.b.massTerm);
+    multirateConn.push_back(isMultirate(conn.a) || isMultirate(conn.b));
     
+    /*
+        A connection to a substepped string or tube holds its force over the substeps and couples
+        the means of the last two (sub)steps of both ends. The work done on both ends then has the
+        same form F^n * (w^n+1/2 - w^n-1/2), so the coupling conserves energy for any ratio.
+        The mass terms become the change of these means per unit force.
+    */
+    prepareConnectionEnd(conn.a, responseA, multirateConn.back());
+    prepareConnectionEnd(conn.b, responseB, multirateConn.back());
+    connectionGraph.addConnection(conn, multirateConn.back());
+    responsesA.push_back(std::move(responseA));
+    responsesB.push_back(std::move(responseB));
+}
+
+void ThinPlate::prepareConnectionEnd(ConnectionPoint& point, ForceResponse& response, bool halfStep)
+{
+    if (isMultirate(point))
+    {
+        calculateSubstepResponse(point, response);
+        if (point.object == ConnectionObject::Tube)
+            point.massTerm = 0.5 * (response.mouthNext + response.mouthCur);
+        else
+            point.massTerm = 0.5 * (response.next[point.l] + response.cur[point.l]);
+        return;
+    }
+    if (hasResponse(point))
+    {
+        // The implicit plate spreads a point force over the whole grid
+        response.plateResponse = preparePlateResponse(point.l, point.m);
+        point.massTerm = plateResponses[response.plateResponse].getValue(point.l, point.m);
+    }
+    if (halfStep == true)
+    {
+        point.massTerm = 0.5 * point.massTerm;
+    }
+}
+
+void ThinPlate::addConnection(const Connection& connectionToAdd)
+{
+    addedConnections.push_back(connectionToAdd);
+    buildConnections();
+}
+
+void ThinPlate::clearAddedConnections()
+{
+    addedConnections.clear();
+    buildConnections();
+}
+
+double& ThinPlate::getConnectionState(const ConnectionPoint& point, int timeIdx)
+{
+    switch (point.object)
+    {
+        case ConnectionObject::String:
+            if (waveguideString[point.index] == true)
+                return waveguides[point.index].getState(point.l, timeIdx);
+            return (timeIdx == 0 ? uStringNext : (timeIdx == 1 ? uString : uStringPrev))[point.index][point.l];
+        case ConnectionObject::Tube:
+            return mouthDisplacement[timeIdx];
+        case ConnectionObject::Plate:
+        default:
+            return (timeIdx == 0 ? uNext : (timeIdx == 1 ? u : uPrev))[point.l][point.m];
+    }
 }
 
 void ThinPlate::updateParameters(const double sig0ToSet, const double sig1ToSet, const double LxToSet, const double LyToSet, const double excXToSet, const double excYToSet, const double lisXToSet, const double lisYToSet, const double thicknessToSet, const double excFToSet, const double excTToSet, const double vBToSet, const double FBToSet, const double aToSet, const int excTypeId, const double  bAtt1ToSet, const double bDec1ToSet, const double  bSus1ToSet, const double bRel1ToSet, const double FBEnv1ToSet, const double vBEnv1ToSet, const double lfoRateToSet, const double xPosModToSet, const double yPosModToSet, const int numStringsToSet, const double sLenToSet, const double sPosSpreadToSet, const double sAvgTenToSet, const double sTenDiffToSet, const double sRadToSet, const double sSig0ToSet, const double cylinderLengthToSet, const double cylinderRadiusToSet, const double bellLengthToSet, const double bellRadiusToSet, const int bellGrowth, bool tubeConnToSet, bool springConnToSet)
@@ -301,6 +897,8 @@ void ThinPlate::updateParameters(const double sig0ToSet, const double sig1ToSet,
     yPosMod = yPosModToSet/1000;
     H = thicknessToSet*0.001f;
     auto prevNumStrings = numStrings;
+    auto prevTubeConn = tubeConn;
+    auto prevSpringConn = springConn;
     numStrings = numStringsToSet;
     LS = sLenToSet*Ly;
     TavgS = sAvgTenToSet;
@@ -331,6 +929,10 @@ void ThinPlate::updateParameters(const double sig0ToSet, const double sig1ToSet,
         setADSR(fs);
         excType = Bow;
     }
+    else if (excTypeId == 3)
+    {
+        excType = Input;
+    }
     else
     {
         maxForce = excFToSet;
@@ -338,23 +940,22 @@ void ThinPlate::updateParameters(const double sig0ToSet, const double sig1ToSet,
         excType = Mallet;
     }
 
-    if (tubeConnToSet == true)
+    // The grids of new strings or a new tube are needed for the next step. Other changes of the tube,
+    // like its length, wait for the next note (needsInit())
+    tubeConn = tubeConnToSet;
+    if (numStrings > prevNumStrings || (tubeConn == true && prevTubeConn == false))
     {
-        tubeConn = true;
         initParameters();
     }
-    else
+    else if (numStrings < prevNumStrings || tubeConn != prevTubeConn)
     {
-        tubeConn = false;
+        buildConnections();
     }
-    if (numStrings > prevNumStrings)
+    else if (springConn != prevSpringConn)
     {
-        if (tubeConn != true)
-        {
-            initParameters();
-        }
+        connectionGraph.setSpring(springConn);
     }
-    
+
 }
 
 void ThinPlate::updatePlateMaterial(int plateMaterialToSet)
@@ -409,8 +1010,7 @@ void ThinPlate::plateHit()
     firstHit = true;
     n = 0;
     t = 0;
-    for (int nS = 0; nS < numStrings; ++nS)
-        connF[nS] = 0;
+    connectionGraph.resetForces();
 }
 
 void ThinPlate::startBow()
@@ -420,6 +1020,14 @@ void ThinPlate::startBow()
         adsr1.noteOn();
         isBowing = true;
         bowEnd = false;
+        
+        // A bow without samples since the last one doesn't change the envelope
+        if (envelopeSegments.empty() || envelopeSegments.back() > 0)
+        {
+            if (envelopeSegments.size() == maxEnvelopeSegments)
+                envelopeSegments.erase(envelopeSegments.begin());
+            envelopeSegments.push_back(0);
+        }
     }
 }
 
@@ -430,7 +1038,21 @@ void ThinPlate::endBow()
     bowEnd = true;
 }
 
+void ThinPlate::setBowExpression(double forceScale, double velocityScale, double xOffset, double yOffset)
+{
+    bowForceScale = forceScale;
+    bowVelocityScale = velocityScale;
+    bowXOffset = xOffset;
+    bowYOffset = yOffset;
+}
+
 void ThinPlate::calculateScheme()
+{
+    calculateNextState();
+    updateStates();
+}
+
+void ThinPlate::calculateNextState()
 {
     //Get number of cycles pr. sample the number of cycles pr. sample for the lfo
     auto cyclesPerSampleLFO= lfoRate / fs;
@@ -462,6 +1084,11 @@ void ThinPlate::calculateScheme()
            {
                excXpos = excXposRatio*Lx;
                excYpos = excYposRatio*Ly;
+               if (bowXOffset != 0 || bowYOffset != 0)
+               {
+                   excXpos = juce::jlimit(0.05, 0.95, excXposRatio + bowXOffset)*Lx;
+                   excYpos = juce::jlimit(0.05, 0.95, excYposRatio + bowYOffset)*Ly;
+               }
                if (0 < xPosMod)
                {
                    excXpos = excXpos + (currentXMod *  excXpos);
@@ -474,140 +1101,869 @@ void ThinPlate::calculateScheme()
                excYidx = floor(excYpos/hy);
                alphaX = excXpos/hx-excXidx;
                alphaY = excYpos/hy-excYidx;
+               snapExcitationToAxis();
                 
                nextAdsr1 = adsr1.getNextSample();
-               b = ((2/k) + 2*sigma0)*(vB*nextAdsr1) - ((2/(k*k)*interpolation(u,excXidx,excYidx,alphaX, alphaY)-interpolation(uPrev,excXidx,excYidx,alphaX, alphaY)) + ((kappa*kappa)/(h*h*h*h))*(interpolation(u,excXidx+2,excYidx,alphaX, alphaY)+interpolation(u,excXidx-2,excYidx,alphaX, alphaY)+interpolation(u,excXidx,excYidx+2,alphaX, alphaY)+interpolation(u,excXidx,excYidx-2,alphaX, alphaY))
+               const auto bowForce = FB*bowForceScale;
+               const auto bowVelocity = vB*bowVelocityScale;
+               if (envelopeSegments.back() < envelopeSettleSamples && ++envelopeSegments.back() == envelopeSettleSamples)
+               {
+                   envelopeSegments.erase(envelopeSegments.begin(), envelopeSegments.end() - 1); // sustained, the earlier bows no longer matter
+               }
+               b = ((2/k) + 2*sigma0)*(bowVelocity*nextAdsr1) - ((2/(k*k)*interpolation(u,excXidx,excYidx,alphaX, alphaY)-interpolation(uPrev,excXidx,excYidx,alphaX, alphaY)) + ((kappa*kappa)/(h*h*h*h))*(interpolation(u,excXidx+2,excYidx,alphaX, alphaY)+interpolation(u,excXidx-2,excYidx,alphaX, alphaY)+interpolation(u,excXidx,excYidx+2,alphaX, alphaY)+interpolation(u,excXidx,excYidx-2,alphaX, alphaY))
                 + 2 * (interpolation(u,excXidx+1,excYidx+1,alphaX, alphaY)+interpolation(u,excXidx+1,excYidx-1,alphaX, alphaY)+interpolation(u,excXidx-1,excYidx+1,alphaX, alphaY)+interpolation(u,excXidx-1,excYidx-1,alphaX, alphaY)-8*(interpolation(u,excXidx+1,excYidx,alphaX, alphaY)+interpolation(u,excXidx-1,excYidx,alphaX, alphaY)+interpolation(u,excXidx,excYidx+1,alphaX, alphaY)+interpolation(u,excXidx,excYidx-1,alphaX, alphaY))+20*interpolation(u,excXidx,excYidx,alphaX, alphaY))
                 - 2*sigma1/(k*h*h)*(interpolation(u,excXidx+1,excYidx,alphaX, alphaY)+interpolation(u,excXidx-1,excYidx,alphaX, alphaY)+interpolation(u,excXidx,excYidx+1,alphaX, alphaY)+interpolation(u,excXidx,excYidx-1,alphaX, alphaY)-interpolation(u,excXidx+1,excYidx,alphaX, alphaY)-interpolation(u,excXidx-1,excYidx,alphaX, alphaY)-interpolation(u,excXidx,excYidx+1,alphaX, alphaY)-interpolation(u,excXidx,excYidx-1,alphaX, alphaY)-4*(interpolation(u,excXidx,excYidx,alphaX, alphaY)-interpolation(uPrev,excXidx,excYidx,alphaX, alphaY))));
                 eps = 1;
                 int i = 0;
                 while (eps > tol && i < 100)
                 {
-                    vRel =  vRelPrev - (((2/k+2*sigma0)*vRelPrev+(FB*nextAdsr1)*sqrt(2*a)*vRelPrev*exp(-a*vRelPrev*vRelPrev+0.5)+b)/(2/k + 2*sigma0+(FB*nextAdsr1)*sqrt(2*a)*(1-2*a*vRel*vRel)*exp(-a*(vRel*vRel+0.5))));
+                    vRel =  vRelPrev - (((2/k+2*sigma0)*vRelPrev+(bowForce*nextAdsr1)*sqrt(2*a)*vRelPrev*exp(-a*vRelPrev*vRelPrev+0.5)+b)/(2/k + 2*sigma0+(bowForce*nextAdsr1)*sqrt(2*a)*(1-2*a*vRel*vRel)*exp(-a*(vRel*vRel+0.5))));
                     eps = std::abs(vRel-vRelPrev);
                     vRelPrev = vRel;
                     ++i;
                 }
-                excitation = sqrt(2*a)*vRel*exp(-a*vRel*vRel+0.5)*(FB*nextAdsr1);
+                excitation = sqrt(2*a)*vRel*exp(-a*vRel*vRel+0.5)*(bowForce*nextAdsr1);
            }
             break;
+            
+        case Input:
+            excitation = 0;
+            break;
     }
     
-    for (int l = 2; l < Nx-2; ++l) // clamped boundaries
+    if (0 < numMalletPulses)
     {
-        for (int m = 2; m < Ny-2; ++m) // clamped boundaries
-        {
-            if (l == excXidx && m == excYidx)
-                J = ((1-alphaX)*(1-alphaY))/(hx*hy);
-            else if (l == excXidx && m == excYidx+1)
-                J = ((1-alphaX)*alphaY)/(hx*hy);
-            else if (l == excXidx+1 && m == excYidx)
-                J = (alphaX*(1-alphaY))/(hx*hy);
-            else if (l == excXidx+1 && m == excYidx+1)
-                J = (alphaX*alphaY)/(hx*hy);
-            else
-                J = 0;
-            
-            uNext[l][m] =
-            (2-20*muSq-4*S)*u[l][m]
-            + (8*muSq+S) * (u[l+1][m] + u[l-1][m] + u[l][m+1] + u[l][m-1])
-            - 2*muSq * (u[l+1][m+1] + u[l-1][m+1] + u[l+1][m-1] + u[l-1][m-1])
-            - muSq * (u[l+2][m] + u[l-2][m] + u[l][m+2] + u[l][m-2])
-            + (sigma0*k-1+4*S) * uPrev[l][m]
-            - S * (uPrev[l+1][m] + uPrev[l-1][m] + uPrev[l][m+1] + u[l][m-1])
-            + J * excitation;
+        addMalletPulses();
+    }
+    
+    if (stochasticExcitation.isActive())
+    {
+        for (int i = stochasticExcitation.startStep(); 0 < i; --i)
+        {
+            auto impact = stochasticExcitation.getImpact();
+            addExcitationForce(impact.xRatio, impact.yRatio, impact.force);
         }
     }
+    
+    if (implicitActive == true)
+    {
+        calculateImplicitPlateStep();
+    }
+    else
+    {
+        calculateExplicitPlateStep();
+    }
+    excitationForces.clear();
+    excitationForceRegion = {};
+    
+    auto stageStart = stageTiming ? juce::Time::getHighResolutionTicks() : 0;
     if (stringConn == true)
     {
-        stringOut = 0;
-        for (int nS = 0; nS < numStrings; ++nS)
+        for (int j = 1; j <= stringRatio; ++j)
         {
-            for (int l = 2; l < NS[nS]-1; l++)
+            for (int nS = 0; nS < numStrings; ++nS)
             {
-                uStringNext[nS][l] =
-                uS1[nS] * uString[nS][l]
-                + uS2[nS] * (uString[nS][l+1]+uString[nS][l-1]) - muSSq[nS] * (uString[nS][l+2]+uString[nS][l-2])
-                + uS3[nS] * uStringPrev[nS][l]-2*sigma1S*k / (hS[nS]*hS[nS])*(uStringPrev[nS][l+1]+uStringPrev[nS][l-1])/As;
-                
+                if (waveguideString[nS] == false)
+                {
+                    calculateStringStep(nS, uStringNext[nS], uString[nS], uStringPrev[nS]);
+                }
             }
-
-            etaNext[nS] = uStringNext[nS][lcS[nS]]-uNext[lcP[nS]][mcP];
-            eta[nS] = uString[nS][lcS[nS]]-u[lcP[nS]][mcP];
-            etaPrev[nS] = uStringPrev[nS][lcS[nS]]-uPrev[lcP[nS]][mcP];
-            rPlus[nS] = 0.5 * K1 + 0.5 * K3 * eta[nS] * eta[nS] + 0.5 * fs * R;
-            rMinus[nS] = 0.5 * K1 + 0.5 * K3 * eta[nS] * eta[nS] + 0.5 * fs * R;
-            if (springConn == true)
+            if (j < stringRatio)
             {
-                connF[nS]  = (etaNext[nS] + rMinus[nS] / rPlus[nS] * etaPrev[nS]) / (1/rPlus[nS] + plateConnTerm + stringConnTerm[nS]);
+                updateStringStates();
             }
-            else
+        }
+        for (int nS = 0; nS < numStrings; ++nS)
+        {
+            if (waveguideString[nS] == true)
             {
-                connF[nS]  = etaNext[nS]/(plateConnTerm + stringConnTerm[nS]);
+                waveguides[nS].calculateNextState();
             }
-            uStringNext[nS][lcS[nS]]= uStringNext[nS][lcS[nS]]-connF[nS]*stringConnTerm[nS];
-            uNext[lcP[nS]][mcP] = uNext[lcP[nS]][mcP] + connF[nS]*plateConnTerm;
-            
-            etaNext[nS] = uStringNext[nS][lcS2[nS]]-uNext[lcP[nS]][mcP2];
-            eta[nS] = uString[nS][lcS2[nS]]-u[lcP[nS]][mcP];
-            etaPrev[nS] = uStringPrev[nS][lcS2[nS]]-uPrev[lcP[nS]][mcP2];
-            rPlus[nS] = 0.5 * K1 + 0.5 * K3 * eta[nS] * eta[nS] + 0.5 * fs * R;
-            rMinus[nS] = 0.5 * K1 + 0.5 * K3 * eta[nS] * eta[nS] + 0.5 * fs * R;
-            if (springConn == true)
+        }
+    }
+    if (stageTiming)
+    {
+        auto now = juce::Time::getHighResolutionTicks();
+        stringTicks += now - stageStart;
+        stageStart = now;
+    }
+    
+    if (tubeConn == true)
+    {
+        for (int j = 1; j <= tubeRatio; ++j)
+        {
+            calculateTubeStep(p[0], p[1], v[0], v[1], vInt, pInt, mouthDisplacement[0], mouthDisplacement[1]);
+            if (j < tubeRatio)
             {
-                connF[nS]  = (etaNext[nS] + rMinus[nS] / rPlus[nS] * etaPrev[nS]) / (1/rPlus[nS] + plateConnTerm + stringConnTerm[nS]);
+                updateTubeStates();
             }
-            else
+        }
+    }
+    if (stageTiming)
+    {
+        tubeTicks += juce::Time::getHighResolutionTicks() - stageStart;
+    }
+    
+    // Solve all connection forces at once and apply them to both ends
+    auto numConn = connectionGraph.getNumConnections();
+    for (int i = 0; i < numConn; ++i)
+    {
+        const auto& conn = connectionGraph.getConnection(i);
+        if (multirateConn[i] == true)
+        {
+            // eta^n is estimated from the two previous half steps
+            connectionGraph.etaNext[i] = getHalfStepState(conn.a) - getHalfStepState(conn.b);
+            connectionGraph.etaPrev[i] = historyA[i] - historyB[i];
+            connectionGraph.eta[i] = 1.5 * connectionGraph.etaPrev[i] - 0.5 * etaHalfPrev[i];
+            etaHalfPrev[i] = connectionGraph.etaPrev[i];
+        }
+        else
+        {
+            connectionGraph.etaNext[i] = getConnectionState(conn.a, 0) - getConnectionState(conn.b, 0);
+            connectionGraph.eta[i] = getConnectionState(conn.a, 1) - getConnectionState(conn.b, 1);
+            connectionGraph.etaPrev[i] = getConnectionState(conn.a, 2) - getConnectionState(conn.b, 2);
+        }
+    }
+    connectionGraph.solve();
+    for (int i = 0; i < numConn; ++i)
+    {
+        const auto& conn = connectionGraph.getConnection(i);
+        applyConnectionForce(conn.a, responsesA[i], -connectionGraph.force[i], applyTermA[i]);
+        applyConnectionForce(conn.b, responsesB[i], connectionGraph.force[i], applyTermB[i]);
+    }
+    
+    // Only read the half steps back once every force is in, as responses can overlap
+    for (int i = 0; i < numConn; ++i)
+    {
+        if (multirateConn[i] == true)
+        {
+            const auto& conn = connectionGraph.getConnection(i);
+            historyA[i] = getHalfStepState(conn.a);
+            historyB[i] = getHalfStepState(conn.b);
+        }
+    }
+    
+    if (stringConn == true)
+    {
+        stringOut = 0;
+        for (int nS = 0; nS < numStrings; ++nS)
+        {
+            if (waveguideString[nS] == true)
             {
-                connF[nS]  = etaNext[nS]/(plateConnTerm + stringConnTerm[nS]);
+                stringOut = stringOut + waveguides[nS].getState(waveguideOut[nS], 1);
+                continue;
             }
-            uStringNext[nS][lcS2[nS]]= uStringNext[nS][lcS2[nS]]-connF[nS]*stringConnTerm[nS];
-            uNext[lcP[nS]][mcP2] = uNext[lcP[nS]][mcP2] + connF[nS]*plateConnTerm;
             stringOutIdx = floor(NS[nS]*0.5);
             stringOut = stringOut + uString[nS][stringOutIdx];
-            //updateStringStates();
         }
         //compensate for extra volume
-        stringOut = stringOut/numStrings;
-        
-
+        if (0 < numStrings)
+        {
+            stringOut = stringOut/numStrings;
+        }
     }
     
     if (tubeConn == true)
     {
-        for (int l = 0; l <= NT-1; l++)
+        tubeOut = p[1][NT-1];
+    }
+}
+
+const char* ThinPlate::getPlateKernelName(PlateKernel kernel)
+{
+    switch (kernel)
+    {
+        case ReferenceKernel: return "reference";
+        case RowKernel: return "rows";
+        case TiledKernel: return "tiled";
+        default: return "";
+    }
+}
+
+void ThinPlate::calculateExplicitPlateStep()
+{
+    if (activeTracking == true)
+    {
+        updateActiveRegion();
+    }
+    
+    // A symmetric plate only updates up to the centre line, and mirrors the rest
+    if (mirrorSymmetric == true && isExcitationOnAxis() == false)
+    {
+        mirrorSymmetric = false;
+    }
+    updateRegion = activeRegion;
+    if (mirrorSymmetric == true)
+    {
+        updateRegion.lEnd = std::min(updateRegion.lEnd, (Nx+1)/2);
+    }
+    calculatePlateUpdate();
+    
+    if (mirrorSymmetric == true)
+    {
+        mirrorPlateState();
+    }
+    
+    if (excitationForces.empty() == false)
+    {
+        addExcitationForces();
+    }
+    
+    // After the mirroring, as it takes sums over the whole plate
+    if (nonlinearActive == true)
+    {
+        addNonlinearForce();
+    }
+}
+
+void ThinPlate::calculateFullPlateUpdate()
+{
+    updateRegion = { 2, std::max(Nx-2, 2), 2, std::max(Ny-2, 2) };
+    calculatePlateUpdate();
+}
+
+void ThinPlate::calculatePlateUpdate()
+{
+    switch (plateKernel)
+    {
+        case ReferenceKernel:
+            for (int l = updateRegion.lBegin; l < updateRegion.lEnd; ++l) // clamped boundaries
+            {
+                for (int r = rowRuns[l]; r < rowRuns[l+1]; ++r) // cells inside the shape
+                {
+                    for (int m = std::max(cellRuns[r].mBegin, updateRegion.mBegin); m < std::min(cellRuns[r].mEnd, updateRegion.mEnd); ++m)
+                    {
+                        if (l == excXidx && m == excYidx)
+                            J = ((1-alphaX)*(1-alphaY))/(hx*hy);
+                        else if (l == excXidx && m == excYidx+1)
+                            J = ((1-alphaX)*alphaY)/(hx*hy);
+                        else if (l == excXidx+1 && m == excYidx)
+                            J = (alphaX*(1-alphaY))/(hx*hy);
+                        else if (l == excXidx+1 && m == excYidx+1)
+                            J = (alphaX*alphaY)/(hx*hy);
+                        else
+                            J = 0;
+            
+                        uNext[l][m] =
+                        (2-20*muSq-4*S)*u[l][m]
+                        + (8*muSq+S) * (u[l+1][m] + u[l-1][m] + u[l][m+1] + u[l][m-1])
+                        - 2*muSq * (u[l+1][m+1] + u[l-1][m+1] + u[l+1][m-1] + u[l-1][m-1])
+                        - muSq * (u[l+2][m] + u[l-2][m] + u[l][m+2] + u[l][m-2])
+                        + (sigma0*k-1+4*S) * uPrev[l][m]
+                        - S * (uPrev[l+1][m] + uPrev[l-1][m] + uPrev[l][m+1] + u[l][m-1])
+                        + J * excitation;
+                    }
+                }
+            }
+            break;
+            
+        case RowKernel:
+        case TiledKernel:
+            calculatePlateBands();
+            addPlateExcitation();
+            break;
+            
+        default:
+            break;
+    }
+}
+
+void ThinPlate::calculatePlateBands()
+{
+    const int numBands = static_cast<int>(rowWorkers.size()) + 1;
+    const int numRows = updateRegion.lEnd - updateRegion.lBegin;
+    if (numBands == 1 || numRows < numBands * minRowsPerBand)
+    {
+        calculatePlateBand(updateRegion.lBegin, updateRegion.lEnd);
+        return;
+    }
+    
+    for (int b = 0; b <= numBands; ++b)
+    {
+        rowBands[b] = updateRegion.lBegin + numRows * b / numBands;
+    }
+    const auto step = rowStep.load(std::memory_order_relaxed) + 1;
+    rowStep.store(step);
+    for (auto& worker : rowWorkers)
+    {
+        if (worker->parked.exchange(false) == true)
+            worker->notify();
+    }
+    
+    calculatePlateBand(rowBands[0], rowBands[1]);
+    for (auto& worker : rowWorkers)
+    {
+        int spins = 0;
+        while (worker->finishedStep.load(std::memory_order_acquire) < step)
+        {
+            if (++spins > 64)
+                std::this_thread::yield();
+        }
+    }
+}
+
+void ThinPlate::calculatePlateBand(int lStart, int lEnd)
+{
+    if (plateKernel == TiledKernel)
+    {
+        for (int mStart = updateRegion.mBegin; mStart < updateRegion.mEnd; mStart += plateTileSize)
+        {
+            calculatePlateRows(lStart, lEnd, mStart, std::min(mStart + plateTileSize, updateRegion.mEnd));
+        }
+    }
+    else
+    {
+        calculatePlateRows(lStart, lEnd, updateRegion.mBegin, updateRegion.mEnd);
+    }
+}
+
+void ThinPlate::setPlateThreads(int numThreadsToSet)
+{
+    numThreadsToSet = std::max(1, numThreadsToSet);
+    if (numThreadsToSet == getPlateThreads())
+        return;
+    
+    for (auto& worker : rowWorkers)
+    {
+        worker->signalThreadShouldExit();
+        worker->notify();
+    }
+    for (auto& worker : rowWorkers)
+    {
+        worker->stopThread(1000);
+    }
+    rowWorkers.clear();
+    
+    rowStep = 0;
+    rowBands.assign(numThreadsToSet + 1, 0);
+    for (int b = 1; b < numThreadsToSet; ++b)
+    {
+        rowWorkers.push_back(std::make_unique<RowWorker>(*this, b));
+        rowWorkers.back()->startThread(juce::Thread::Priority::highest);
+    }
+}
+
+// The interior stencil of the reference loop for rows lStart to lEnd - 1 and columns mStart to mEnd - 1, with the terms in the same order
+void ThinPlate::calculatePlateRows(int lStart, int lEnd, int mStart, int mEnd)
+{
+    const double centre = 2-20*muSq-4*S;
+    const double side = 8*muSq+S;
+    const double diagonal = 2*muSq;
+    const double centrePrev = sigma0*k-1+4*S;
+    for (int l = lStart; l < lEnd; ++l) // clamped boundaries
+    {
+        const double* uC = u[l].data();
+        const double* uL1 = u[l-1].data();
+        const double* uR1 = u[l+1].data();
+        const double* uL2 = u[l-2].data();
+        const double* uR2 = u[l+2].data();
+        const double* prevC = uPrev[l].data();
+        const double* prevL1 = uPrev[l-1].data();
+        const double* prevR1 = uPrev[l+1].data();
+        double* next = uNext[l].data();
+        for (int r = rowRuns[l]; r < rowRuns[l+1]; ++r) // cells inside the shape
+        {
+            const int runEnd = std::min(cellRuns[r].mEnd, mEnd);
+            for (int m = std::max(cellRuns[r].mBegin, mStart); m < runEnd; ++m)
+            {
+                next[m] =
+                centre*uC[m]
+                + side * (uR1[m] + uL1[m] + uC[m+1] + uC[m-1])
+                - diagonal * (uR1[m+1] + uL1[m+1] + uR1[m-1] + uL1[m-1])
+                - muSq * (uR2[m] + uL2[m] + uC[m+2] + uC[m-2])
+                + centrePrev * prevC[m]
+                - S * (prevR1[m] + prevL1[m] + prevC[m+1] + uC[m-1]);
+            }
+        }
+    }
+}
+
+// The excitation at the four grid points around its position, as J * excitation in the reference loop
+void ThinPlate::addPlateExcitation()
+{
+    const double weights[2][2] = { { (1-alphaX)*(1-alphaY), (1-alphaX)*alphaY }, { alphaX*(1-alphaY), alphaX*alphaY } };
+    for (int i = 0; i < 2; ++i)
+    {
+        for (int j = 0; j < 2; ++j)
+        {
+            auto l = excXidx + i;
+            auto m = excYidx + j;
+            if (isPlateCell(l, m))
+            {
+                uNext[l][m] += weights[i][j]/(hx*hy) * excitation;
+            }
+        }
+    }
+}
+
+// The forces of addExcitationForce() in one pass over the list. After the mirroring: the forces on
+// the centre line are symmetric themselves, and the others turned the reduction off
+void ThinPlate::addExcitationForces()
+{
+    for (const auto& force : excitationForces)
+    {
+        if (cellMask[force.index] != 0)
+        {
+            uNext[force.index / Ny][force.index % Ny] += force.value;
+        }
+    }
+}
+
+void ThinPlate::addExcitationForce(double xRatio, double yRatio, double force)
+{
+    auto x = xRatio*Lx/hx;
+    auto y = yRatio*Ly/hy;
+    int l = floor(x);
+    int m = floor(y);
+    auto alphaXForce = x - l;
+    auto alphaYForce = y - m;
+    
+    const double weights[2][2] = { { (1-alphaXForce)*(1-alphaYForce), (1-alphaXForce)*alphaYForce }, { alphaXForce*(1-alphaYForce), alphaXForce*alphaYForce } };
+    for (int i = 0; i < 2; ++i)
+    {
+        for (int j = 0; j < 2; ++j)
+        {
+            if (weights[i][j] != 0 && 2 <= l+i && l+i < Nx-2 && 2 <= m+j && m+j < Ny-2)
+            {
+                excitationForces.push_back({ (l+i)*Ny + m+j, weights[i][j]/(hx*hy) * force });
+                excitationForceRegion.include(l+i, m+j);
+            }
+        }
+    }
+    
+    // Symmetric only on the centre line, like the excitation
+    if ((2*l == Nx-1 && alphaXForce == 0) || (2*l+1 == Nx-1 && alphaXForce == 0.5))
+        return;
+    mirrorSymmetric = false;
+}
+
+void ThinPlate::addMalletPulse(double xRatio, double yRatio, double force, double duration, int delaySteps)
+{
+    MalletPulse pulse { xRatio, yRatio, force, duration, std::max(delaySteps, 0), 0, static_cast<int> (floor(duration*fs)) };
+    if (pulse.numSteps <= 0)
+        return;
+    if (numMalletPulses < maxMalletPulses)
+    {
+        malletPulses[numMalletPulses++] = pulse;
+        return;
+    }
+    
+    auto stepsLeft = [] (const MalletPulse& p) { return p.delay + p.numSteps - p.step; };
+    auto* closest = std::min_element(malletPulses.begin(), malletPulses.end(), [&] (const MalletPulse& a, const MalletPulse& b) { return stepsLeft(a) < stepsLeft(b); });
+    *closest = pulse;
+}
+
+// The raised cosine of each started pulse, as in calculateNextState() for the mallet, through
+// addExcitationForce(). Finished pulses are replaced by the last one
+void ThinPlate::addMalletPulses()
+{
+    for (int i = 0; i < numMalletPulses;)
+    {
+        auto& pulse = malletPulses[i];
+        if (0 < pulse.delay)
+        {
+            --pulse.delay;
+            ++i;
+            continue;
+        }
+        auto force = pulse.force/2*(1-std::cos((2*juce::MathConstants<double>::pi*pulse.step*k)/pulse.duration));
+        addExcitationForce(pulse.xRatio, pulse.yRatio, force);
+        if (++pulse.step < pulse.numSteps)
+        {
+            ++i;
+            continue;
+        }
+        malletPulses[i] = malletPulses[--numMalletPulses];
+    }
+}
+
+bool ThinPlate::needsInit()
+{
+    if (geometry == nullptr || getGeometrySettings().hasSameKey(geometry->settings) == false)
+        return true;
+    auto nonlinear = 0 < nonlinearGain && implicitScheme == false;
+    return nonlinear != nonlinearActive || (nonlinear == true && displacementScale != nonlinearGain*forceTerm);
+}
+
+// The von Karman force L(phi, u) with the displacement w = displacementScale u, in the scalar
+// auxiliary variable form: the force is -(psi^n+1/2 + psi^n-1/2) / 2 g^n, where g^n = grad V / psi
+// for the stress energy V of u^n and psi = sqrt (2 V), and psi is advanced with
+// psi^n+1/2 - psi^n-1/2 = <g^n, w^n+1 - w^n-1> / 2. The force then is linear in u^n+1 and known
+// but for the single product <g^n, w^n+1>, so the step stays explicit, and the energy with psi^2 / 2
+// in place of V can't grow however hard the plate is hit. grad V = -L(phi, w) is zero more than
+// a point away from the nonzero part of u^n, so the active region covers it
+void ThinPlate::addNonlinearForce()
+{
+    if (activeRegion.isEmpty())
+        return;
+    
+    const double a = displacementScale;
+    auto stressSum = stressSolver.calculateStress(u, stressScale * a * a);
+    auto energy = -0.25*h*h*a*a * stressSum;
+    if (energy <= 0)
+        return; // flat
+    auto psi = std::sqrt(2*energy);
+    
+    // <g, g>, <g, w^n+1> without the force, and <g, w^n-1>, with the grid cell area
+    double gg = 0, gNext = 0, gPrev = 0;
+    for (int l = activeRegion.lBegin; l < activeRegion.lEnd; ++l)
+    {
+        for (int r = rowRuns[l]; r < rowRuns[l+1]; ++r)
+        {
+            const int runEnd = std::min(cellRuns[r].mEnd, activeRegion.mEnd);
+            for (int m = std::max(cellRuns[r].mBegin, activeRegion.mBegin); m < runEnd; ++m)
+            {
+                auto g = -a*stressSolver.getCoupling(l, m)/psi;
+                stressGradient[l*Ny + m] = g;
+                gg += g*g;
+                gNext += g*uNext[l][m];
+                gPrev += g*uPrev[l][m];
+            }
+        }
+    }
+    gg *= h*h;
+    gNext *= a*h*h;
+    gPrev *= a*h*h;
+    
+    // w^n+1 = wLinear - forceTerm psiMid g, with psiMid = psi^n-1/2 + (<g, w^n+1> - <g, w^n-1>) / 4
+    const double c = forceTerm;
+    auto gNextWithForce = (gNext - c*stressPsi*gg + 0.25*c*gg*gPrev) / (1 + 0.25*c*gg);
+    auto psiMid = stressPsi + 0.25*(gNextWithForce - gPrev);
+    stressPsi = 2*psiMid - stressPsi;
+    
+    const double step = c*psiMid/a;
+    for (int l = activeRegion.lBegin; l < activeRegion.lEnd; ++l)
+    {
+        for (int r = rowRuns[l]; r < rowRuns[l+1]; ++r)
+        {
+            const int runEnd = std::min(cellRuns[r].mEnd, activeRegion.mEnd);
+            for (int m = std::max(cellRuns[r].mBegin, activeRegion.mBegin); m < runEnd; ++m)
+            {
+                uNext[l][m] -= step*stressGradient[l*Ny + m];
+            }
+        }
+    }
+}
+
+// Rows l and Nx-1-l are mirror images, so the rows past the centre line are copies. Outside the
+// update region they are zero, like their mirror rows
+void ThinPlate::mirrorPlateState()
+{
+    for (int l = (Nx+1)/2; l < Nx - updateRegion.lBegin; ++l)
+    {
+        std::copy(uNext[Nx-1-l].begin() + updateRegion.mBegin, uNext[Nx-1-l].begin() + updateRegion.mEnd, uNext[l].begin() + updateRegion.mBegin);
+    }
+}
+
+// The excitation is symmetric if its weights are: all on the centre row (odd Nx), or half on
+// each of the two rows around the centre line (even Nx)
+bool ThinPlate::isExcitationOnAxis()
+{
+    if (excitation == 0)
+        return true;
+    return (2*excXidx == Nx-1 && alphaX == 0) || (2*excXidx+1 == Nx-1 && alphaX == 0.5);
+}
+
+// An excitation at getCentreLineRatio() only misses the centre line by rounding, which is removed
+// here. So does one in the middle of the plate, x = 0.5: the clamped edges l = 1 and l = Nx-2 lie
+// around the line, and 0.5 Lx is only half a grid step from it by the indexing of the grid.
+// Anything else is left where it is and turns the reduction off
+void ThinPlate::snapExcitationToAxis()
+{
+    if (mirrorSymmetric == false || 0 < xPosMod || bowXOffset != 0)
+        return;
+    if (std::abs(excXpos/hx - 0.5*(Nx-1)) >= 1e-9 && std::abs(excXpos/Lx - 0.5) >= 1e-6) // the parameter is a float
+        return;
+    
+    excXidx = (Nx-1)/2;
+    alphaX = Nx % 2 == 0 ? 0.5 : 0;
+}
+
+void ThinPlate::updateActiveRegion()
+{
+    auto& region = activeRegion;
+    
+    // The connection points and a running excitation stay active
+    auto required = activeSources;
+    required.include(excitationForceRegion);
+    if (excitation != 0)
+    {
+        for (int l = std::max(excXidx, 2); l <= std::min(excXidx+1, Nx-3); ++l)
         {
-            v[0][l] = v[1][l]-((lambdaT/(rhoT*cT)))*(p[1][l+1]-p[1][l]);
+            for (int m = std::max(excYidx, 2); m <= std::min(excYidx+1, Ny-3); ++m)
+            {
+                required.include(l, m);
+            }
         }
-        for(int l = 1; l <= NT-1; l++)
+    }
+    
+    // Only a freely ringing plate (mallet or input) shrinks. The bow, springs and tube feed back on
+    // the plate and amplify the cleared remainders into audible differences, so with those the
+    // region only grows, and the update is exact
+    const bool canShrink = excType != Bow && activeSources.isEmpty();
+    
+    // Clear the edge lines of the region where u^n and u^n-1 have decayed below the threshold
+    const double threshold = activeThreshold / 0.000001; // getOutput() scaling for the mallet
+    auto isQuiet = [&] (int l, int m) { return std::abs(u[l][m]) <= threshold && std::abs(uPrev[l][m]) <= threshold; };
+    auto clear = [&] (int l, int m) { uNext[l][m] = 0; u[l][m] = 0; uPrev[l][m] = 0; };
+    auto isRowQuiet = [&] (int l)
+    {
+        for (int m = region.mBegin; m < region.mEnd; ++m)
+            if (! isQuiet(l, m))
+                return false;
+        return true;
+    };
+    auto isColumnQuiet = [&] (int m)
+    {
+        for (int l = region.lBegin; l < region.lEnd; ++l)
+            if (! isQuiet(l, m))
+                return false;
+        return true;
+    };
+    
+    while (canShrink && ! region.isEmpty() && (required.isEmpty() || region.lBegin < required.lBegin) && isRowQuiet(region.lBegin))
+    {
+        for (int m = region.mBegin; m < region.mEnd; ++m)
+            clear(region.lBegin, m);
+        ++region.lBegin;
+    }
+    while (canShrink && ! region.isEmpty() && (required.isEmpty() || region.lEnd > required.lEnd) && isRowQuiet(region.lEnd - 1))
+    {
+        for (int m = region.mBegin; m < region.mEnd; ++m)
+            clear(region.lEnd - 1, m);
+        --region.lEnd;
+    }
+    while (canShrink && ! region.isEmpty() && (required.isEmpty() || region.mBegin < required.mBegin) && isColumnQuiet(region.mBegin))
+    {
+        for (int l = region.lBegin; l < region.lEnd; ++l)
+            clear(l, region.mBegin);
+        ++region.mBegin;
+    }
+    while (canShrink && ! region.isEmpty() && (required.isEmpty() || region.mEnd > required.mEnd) && isColumnQuiet(region.mEnd - 1))
+    {
+        for (int l = region.lBegin; l < region.lEnd; ++l)
+            clear(l, region.mEnd - 1);
+        --region.mEnd;
+    }
+    if (region.isEmpty())
+    {
+        region = {};
+    }
+    else
+    {
+        // u^n+1 can be nonzero up to two points from the nonzero part of u^n
+        region = { std::max(region.lBegin - 2, 2), std::min(region.lEnd + 2, Nx-2), std::max(region.mBegin - 2, 2), std::min(region.mEnd + 2, Ny-2) };
+    }
+    region.include(required);
+}
+
+void ThinPlate::setFullActiveRegion()
+{
+    activeRegion = { 2, std::max(Nx-2, 2), 2, std::max(Ny-2, 2) };
+}
+
+void ThinPlate::setActiveRegionTracking(bool activeTrackingToSet)
+{
+    activeTracking = activeTrackingToSet;
+    if (activeTracking == false)
+    {
+        setFullActiveRegion();
+    }
+}
+
+double ThinPlate::getActiveFraction()
+{
+    if (activeRegion.isEmpty() || Nx <= 4 || Ny <= 4)
+        return 0;
+    return static_cast<double> (activeRegion.lEnd - activeRegion.lBegin) * (activeRegion.mEnd - activeRegion.mBegin) / ((Nx-4) * (Ny-4));
+}
+
+void ThinPlate::calculateImplicitPlateStep()
+{
+    /*
+        Theta scheme with centred damping:
+        (1 + sigma0 k) u^n+1 + theta muSq D4 u^n+1 - s1 D2 u^n+1
+            = 2 u^n - muSq D4 ((1 - 2 theta) u^n + theta u^n-1) - (1 - sigma0 k) u^n-1 - s1 D2 u^n-1 + J F
+        with s1 = sigma1 k / h^2. Stable for any grid spacing when theta >= 1/4.
+    */
+    auto s1 = 0.5 * S;
+    auto& w = implicitW;
+    for (int l = 2; l < Nx-2; ++l)
+    {
+        for (int m = 2; m < Ny-2; ++m)
         {
-            sMinus = 0.5 * (ST[l]+ST[l-1]);
-            sPlus = 0.5 * (ST[l]+ST[l+1]);
-            p[0][l] = p[1][l]-((rhoT*cT*lambdaT)/((sPlus+sMinus)/2))*(v[0][l]*sPlus-v[0][l-1]*sMinus);
+            w[l*Ny+m] = (1-2*theta) * u[l][m] + theta * uPrev[l][m];
         }
-        p[0][NT] = (1-rhoT*cT*lambdaT*zeta3)/(1+rhoT*cT*lambdaT*zeta3)*p[1][NT]-((2*rhoT*cT*lambdaT)/(1+rhoT*cT*lambdaT*zeta3))*(vInt+zeta4*pInt-(0.5*(ST[NT]+ST[NT-1])*v[0][NT-1])/ST[NT]);
+    }
+    
+    for (int l = 2; l < Nx-2; ++l)
+    {
+        for (int m = 2; m < Ny-2; ++m)
+        {
+            auto i = l*Ny+m;
+            auto D4w = 20*w[i]
+            - 8 * (w[i+Ny] + w[i-Ny] + w[i+1] + w[i-1])
+            + 2 * (w[i+Ny+1] + w[i+Ny-1] + w[i-Ny+1] + w[i-Ny-1])
+            + (w[i+2*Ny] + w[i-2*Ny] + w[i+2] + w[i-2]);
+            auto D2uPrev = uPrev[l+1][m] + uPrev[l-1][m] + uPrev[l][m+1] + uPrev[l][m-1] - 4*uPrev[l][m];
             
-        vInt=vInt+k/Lr*0.5*(p[0][NT]+p[1][NT]);
-        pInt= zeta1 * 0.5*(p[0][NT]+p[1][NT]) + zeta2 * pInt;
-        
-        etaNextT = p[0][lcT] - uNext[lcPT][mcPT];
-        etaT = p[1][lcT]-u[lcPT][mcPT];
-        etaPrevT = p[2][lcT]-uPrev[lcPT][mcPT];
-        rPlusT = 0.5 * K1 + 0.5 * K3 * etaT * etaT + 0.5 * fs * R;
-        rMinusT = 0.5 * K1 + 0.5 * K3 * etaT * etaT - 0.5 * fs * R;
-        if (springConn == true)
+            implicitRhs[i] = 2*u[l][m] - muSq*D4w - (1-sigma0*k)*uPrev[l][m] - s1*D2uPrev;
+            implicitX[i] = 2*u[l][m] - uPrev[l][m]; // initial guess
+        }
+    }
+    
+    auto addExcitation = [&] (int l, int m, double weight)
+    {
+        if (2 <= l && l < Nx-2 && 2 <= m && m < Ny-2)
+            implicitRhs[l*Ny+m] += weight/(hx*hy) * excitation;
+    };
+    addExcitation(excXidx, excYidx, (1-alphaX)*(1-alphaY));
+    addExcitation(excXidx, excYidx+1, (1-alphaX)*alphaY);
+    addExcitation(excXidx+1, excYidx, alphaX*(1-alphaY));
+    addExcitation(excXidx+1, excYidx+1, alphaX*alphaY);
+    for (const auto& force : excitationForces)
+    {
+        implicitRhs[force.index] += force.value;
+    }
+    
+    solverIterations = implicitSolver.solve(implicitRhs, implicitX);
+    
+    for (int l = 2; l < Nx-2; ++l)
+    {
+        for (int m = 2; m < Ny-2; ++m)
         {
-            connFT = (etaNextT  + rMinusT / rPlusT * etaPrevT) / (1/rPlusT + plateConnTerm + tubeConnTerm);
+            uNext[l][m] = implicitX[l*Ny+m];
         }
-        else
+    }
+}
+
+int ThinPlate::preparePlateResponse(int l, int m)
+{
+    auto found = findPlateResponse(l, m);
+    if (found >= 0)
+    {
+        return found;
+    }
+    
+    // Solve for the change of u^n+1 due to a unit force at (l, m)
+    auto idx = implicitSolver.getIndex(l, m);
+    std::vector<double> impulse(implicitSolver.getSize(), 0);
+    std::vector<double> full(implicitSolver.getSize(), 0);
+    if (2 <= l && l < Nx-2 && 2 <= m && m < Ny-2)
+    {
+        impulse[idx] = (k*k)/(rho*H*h*h);
+    }
+    implicitSolver.solve(impulse, full);
+    
+    // Only keep the window where the response is not negligible
+    PlateResponse response;
+    response.index = idx;
+    response.lStart = Nx;
+    response.mStart = Ny;
+    auto threshold = 1e-9 * std::abs(full[idx]);
+    for (int lr = 2; lr < Nx-2; ++lr)
+    {
+        for (int mr = 2; mr < Ny-2; ++mr)
         {
-            connFT = etaNextT / (plateConnTerm + tubeConnTerm);
+            if (std::abs(full[lr*Ny+mr]) > threshold)
+            {
+                response.lStart = std::min(response.lStart, lr);
+                response.lEnd = std::max(response.lEnd, lr+1);
+                response.mStart = std::min(response.mStart, mr);
+                response.mEnd = std::max(response.mEnd, mr+1);
+            }
         }
-        p[0][lcT] = p[0][lcT] - connFT * tubeConnTerm;
-        uNext[lcPT][mcPT] = uNext[lcPT][mcPT] + connFT * plateConnTerm;
-        tubeOut = p[1][NT-1];
     }
-    updateStates();
+    for (int lr = response.lStart; lr < response.lEnd; ++lr)
+    {
+        for (int mr = response.mStart; mr < response.mEnd; ++mr)
+        {
+            response.values.push_back(full[lr*Ny+mr]);
+        }
+    }
+    plateResponses.push_back(std::move(response));
+    return static_cast<int> (plateResponses.size()) - 1;
+}
+
+int ThinPlate::findPlateResponse(int l, int m) const
+{
+    auto idx = implicitSolver.getIndex(l, m);
+    for (int i = 0; i < static_cast<int> (plateResponses.size()); ++i)
+    {
+        if (plateResponses[i].index == idx)
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+void ThinPlate::addPlateResponse(const PlateResponse& response, double force)
+{
+    auto width = response.mEnd - response.mStart;
+    const auto* values = response.values.data();
+    for (int l = response.lStart; l < response.lEnd; ++l, values += width)
+    {
+        auto* row = uNext[l].data() + response.mStart;
+        for (int m = 0; m < width; ++m)
+        {
+            row[m] += force * values[m];
+        }
+    }
+}
+
+double ThinPlate::getPlateConnTerm(int l, int m)
+{
+    return getPlateCoupling(l, m, l, m);
+}
+
+double ThinPlate::getPlateCoupling(int l, int m, int lForce, int mForce)
+{
+    if (implicitActive == true)
+    {
+        return plateResponses[preparePlateResponse(lForce, mForce)].getValue(l, m);
+    }
+    return (l == lForce && m == mForce) ? plateConnTerm : 0;
+}
+
+void ThinPlate::setImplicitScheme(bool implicitSchemeToSet, double gridScaleToSet)
+{
+    implicitScheme = implicitSchemeToSet;
+    gridScale = std::max(0.1, gridScaleToSet);
+}
+
+double ThinPlate::getPlateState(int l, int m, int timeIdx)
+{
+    return getConnectionState({ConnectionObject::Plate, 0, l, m, plateConnTerm}, timeIdx);
+}
+
+void ThinPlate::addPlateForce(int l, int m, double force)
+{
+    if (implicitActive == true)
+    {
+        // Prepared by getPlateConnTerm() when the link was set up
+        auto response = findPlateResponse(l, m);
+        jassert(response >= 0);
+        if (response >= 0)
+        {
+            addPlateResponse(plateResponses[response], force);
+        }
+        return;
+    }
+    if (isPlateCell(l, m) == false)
+    {
+        return; // clamped
+    }
+    uNext[l][m] = uNext[l][m] + force * plateConnTerm;
+    
+    // A linked point is a connection point like those of the strings and the tube: it stays active,
+    // and the region no longer shrinks, as the link feeds back on the plate
+    activeSources.include(l, m);
+    activeRegion.include(l, m);
+    if (2*l != Nx-1)
+    {
+        mirrorSymmetric = false;
+    }
 }
 
 void ThinPlate::updateStates()
@@ -617,80 +1973,228 @@ void ThinPlate::updateStates()
     u = uNext;
     uNext = uTmp;
     
-   
+    updateStringStates();
+    for (int nS = 0; nS < numStrings && stringConn == true; ++nS)
+    {
+        if (waveguideString[nS] == true)
+        {
+            waveguides[nS].updateStates();
+        }
+    }
+    
+    if (tubeConn == true)
+    {
+        updateTubeStates();
+    }
+}
+
+void ThinPlate::updateStringStates()
+{
     std::vector<double>* uStringTmp = uStringPrev;
     uStringPrev = uString;
     uString = uStringNext;
     uStringNext = uStringTmp;
+}
+
+void ThinPlate::updateTubeStates()
+{
+    double* pTmp = p[2];
+    p[2] = p[1];
+    p[1] = p[0];
+    p[0] = pTmp;
+
+    double* vTmp = v[1];
+    v[1] = v[0];
+    v[0] = vTmp;
     
-    if (tubeConn == true)
+    mouthDisplacement[2] = mouthDisplacement[1];
+    mouthDisplacement[1] = mouthDisplacement[0];
+}
+
+void ThinPlate::calculateStringStep(int nS, std::vector<double>& next, const std::vector<double>& cur, const std::vector<double>& prev)
+{
+    for (int l = 2; l < NS[nS]-1; l++)
     {
-        double* pTmp = p[2];
-        p[2] = p[1];
-        p[1] = p[0];
-        p[0] = pTmp;
-    
-        double* vTmp = v[1];
-        v[1] = v[0];
-        v[0] = vTmp;
+        next[l] =
+        uS1[nS] * cur[l]
+        + uS2[nS] * (cur[l+1]+cur[l-1]) - muSSq[nS] * (cur[l+2]+cur[l-2])
+        + uS3[nS] * prev[l]-2*sigma1S*kS / (hS[nS]*hS[nS])*(prev[l+1]+prev[l-1])/As;
     }
 }
 
+void ThinPlate::calculateTubeStep(double* pNext, const double* pCur, double* vNext, const double* vCur, double& vIntState, double& pIntState, double& mouthNext, double mouthCur)
+{
+    for (int l = 0; l <= NT-1; l++)
+    {
+        vNext[l] = vCur[l]-((lambdaT/(rhoT*cT)))*(pCur[l+1]-pCur[l]);
+    }
+    mouthNext = mouthCur + kT * vNext[0];
+    for(int l = 1; l <= NT-1; l++)
+    {
+        sMinus = 0.5 * (ST[l]+ST[l-1]);
+        sPlus = 0.5 * (ST[l]+ST[l+1]);
+        pNext[l] = pCur[l]-((rhoT*cT*lambdaT)/((sPlus+sMinus)/2))*(vNext[l]*sPlus-vNext[l-1]*sMinus);
+    }
+    pNext[NT] = (1-rhoT*cT*lambdaT*zeta3)/(1+rhoT*cT*lambdaT*zeta3)*pCur[NT]-((2*rhoT*cT*lambdaT)/(1+rhoT*cT*lambdaT*zeta3))*(vIntState+zeta4*pIntState-(0.5*(ST[NT]+ST[NT-1])*vNext[NT-1])/ST[NT]);
+        
+    vIntState=vIntState+kT/Lr*0.5*(pNext[NT]+pCur[NT]);
+    pIntState= zeta1 * 0.5*(pNext[NT]+pCur[NT]) + zeta2 * pIntState;
+}
 
-void ThinPlate::setADSR(double sampleRate)
+void ThinPlate::updateTubeMouth()
 {
-    adsr1.setSampleRate(sampleRate);
-    adsr1Params.attack = bAtt1;
-    adsr1Params.decay = bDec1;
-    adsr1Params.sustain = bSus1;
-    adsr1Params.release = bRel1;
-    adsr1.setParameters(adsr1Params);
-    
+    v[0][0] = (mouthDisplacement[0] - mouthDisplacement[1]) / kT;
+    sMinus = 0.5 * (ST[1]+ST[0]);
+    sPlus = 0.5 * (ST[1]+ST[2]);
+    p[0][1] = p[1][1]-((rhoT*cT*lambdaT)/((sPlus+sMinus)/2))*(v[0][1]*sPlus-v[0][0]*sMinus);
+}
+
+void ThinPlate::setSubsystemRates(int stringRatioToSet, int tubeRatioToSet)
+{
+    // The running step reads stringRatio and tubeRatio, so they only change in initParameters()
+    pendingStringRatio = std::max(1, stringRatioToSet);
+    pendingTubeRatio = std::max(1, tubeRatioToSet);
 }
 
+bool ThinPlate::isMultirate(const ConnectionPoint& point)
+{
+    return (point.object == ConnectionObject::String && stringRatio > 1 && waveguideString[point.index] == false) || (point.object == ConnectionObject::Tube && tubeRatio > 1);
+}
 
-void ThinPlate::calculateBoreShape()
+bool ThinPlate::hasResponse(const ConnectionPoint& point)
 {
-    for (int i = 0; i <= nCT; i++)
+    return isMultirate(point) || (point.object == ConnectionObject::Plate && implicitActive == true);
+}
+
+double ThinPlate::getHalfStepState(const ConnectionPoint& point)
+{
+    // Mean of the last two (sub)steps: the coupling variable of a multirate connection
+    if (isMultirate(point) && point.object == ConnectionObject::String)
+        return 0.5 * (uStringNext[point.index][point.l] + uString[point.index][point.l]);
+    return 0.5 * (getConnectionState(point, 0) + getConnectionState(point, 1));
+}
+
+void ThinPlate::applyConnectionForce(const ConnectionPoint& point, const ForceResponse& response, double force, double massTerm)
+{
+    if (hasResponse(point) == false)
     {
-        sC[i] = juce::MathConstants<double>::pi * cRT*cRT;
+        if (point.object == ConnectionObject::String && waveguideString[point.index] == true)
+        {
+            waveguides[point.index].addForce(point.l, force);
+            return;
+        }
+        getConnectionState(point, 0) += force * massTerm;
+        if (point.object == ConnectionObject::Tube)
+        {
+            updateTubeMouth();
+        }
+        return;
     }
-    // if bell is linear
-    if(shape == 1)
+    if (point.object == ConnectionObject::Plate)
     {
-        auto r = cRT;
-        auto rGrowth = (bRT - cRT) / nBT;
-        for (int i = 1; i<= nBT; i++)
+        addPlateResponse(plateResponses[response.plateResponse], force);
+        return;
+    }
+    
+    // The force was held over all substeps, which by linearity adds a multiple of the response from rest
+    for (int l = response.first; l <= response.last; ++l)
+    {
+        if (point.object == ConnectionObject::String)
+        {
+            uStringNext[point.index][l] += force * response.next[l];
+            uString[point.index][l] += force * response.cur[l];
+        }
+        else
         {
-            r = r + rGrowth;
-            sB[i-1] = juce::MathConstants<double>::pi*r*r;
+            p[0][l] += force * response.next[l];
+            p[1][l] += force * response.cur[l];
+            if (l < NT)
+            {
+                v[0][l] += force * response.velocity[l];
+            }
         }
     }
-    // if bell is exponential
-    else if(shape == 2)
+    if (point.object == ConnectionObject::Tube)
     {
-        auto r = cRT;
-        auto rGrowth = exp(log(bRT/cRT)/nBT);
-        for (int i = 1; i<= nBT; i++)
+        mouthDisplacement[0] += force * response.mouthNext;
+        mouthDisplacement[1] += force * response.mouthCur;
+    }
+}
+
+void ThinPlate::calculateSubstepResponse(const ConnectionPoint& point, ForceResponse& response)
+{
+    // Response of a substepped object, from rest, to a unit force held over one plate time step
+    if (point.object == ConnectionObject::String)
+    {
+        auto nS = point.index;
+        std::vector<std::vector<double>> scratch (3, std::vector<double>(NSMax+1, 0));
+        int next = 0, cur = 1, prev = 2;
+        for (int j = 1; j <= stringRatio; ++j)
         {
-            r = cRT * pow(rGrowth,i);
-            sB[i-1] = juce::MathConstants<double>::pi*r*r;
+            calculateStringStep(nS, scratch[next], scratch[cur], scratch[prev]);
+            scratch[next][point.l] += stringConnTerm[nS];
+            if (j < stringRatio)
+            {
+                auto tmp = prev;
+                prev = cur;
+                cur = next;
+                next = tmp;
+            }
         }
+        response.next = scratch[next];
+        response.cur = scratch[cur];
     }
-    // if bell is logarithmic
-    else if(shape == 3)
+    else
     {
-        auto r = cRT;
-        auto rGrowth = (bRT-cRT)/log(nBT);
-        for (int i = 1; i<= nBT; i++)
+        std::vector<std::vector<double>> pScratch (2, std::vector<double>(NT+1, 0));
+        std::vector<std::vector<double>> vScratch (2, std::vector<double>(NT+1, 0));
+        double vIntScratch = 0;
+        double pIntScratch = 0;
+        double mouthScratch[2] = { 0, 0 };
+        for (int j = 1; j <= tubeRatio; ++j)
         {
-            r = cRT + rGrowth * log(i);
-            sB[i-1] = juce::MathConstants<double>::pi*r*r;
+            // The force is a pressure 1 / S at the mouth, which drives the first velocity point
+            pScratch[1][0] = 1 / ST[0];
+            calculateTubeStep(pScratch[0].data(), pScratch[1].data(), vScratch[0].data(), vScratch[1].data(), vIntScratch, pIntScratch, mouthScratch[0], mouthScratch[1]);
+            if (j < tubeRatio)
+            {
+                std::swap(pScratch[0], pScratch[1]);
+                std::swap(vScratch[0], vScratch[1]);
+                mouthScratch[1] = mouthScratch[0];
+            }
         }
+        
+        // The mouth pressure is the input and not a state of the tube
+        pScratch[0][0] = 0;
+        pScratch[1][0] = 0;
+        response.next = pScratch[0];
+        response.cur = pScratch[1];
+        response.velocity = vScratch[0];
+        response.mouthNext = mouthScratch[0];
+        response.mouthCur = mouthScratch[1];
     }
-    sC.insert( sC.end(), sB.begin(), sB.end() );
     
-    for (int i = 0; i <= NT; i++)
-        ST[i] = sC[i];
+    response.first = static_cast<int> (response.next.size());
+    response.last = -1;
+    for (int l = 0; l < static_cast<int> (response.next.size()); ++l)
+    {
+        if (response.next[l] != 0 || response.cur[l] != 0 || (l < static_cast<int> (response.velocity.size()) && response.velocity[l] != 0))
+        {
+            response.first = std::min(response.first, l);
+            response.last = l;
+        }
+    }
+}
+
+
+void ThinPlate::setADSR(double sampleRate)
+{
+    adsr1.setSampleRate(sampleRate);
+    adsr1Params.attack = bAtt1;
+    adsr1Params.decay = bDec1;
+    adsr1Params.sustain = bSus1;
+    adsr1Params.release = bRel1;
+    adsr1.setParameters(adsr1Params);
+    envelopeSettleSamples = static_cast<int> (std::ceil((bAtt1 + bDec1) * sampleRate)) + 4; // a few extra for the rounding of the rates
 }
 
@@ -12,7 +12,13 @@
 #pragma once
 
 #include <JuceHeader.h>
-
+#include "ConnectionGraph.h"
+#include "ImplicitPlateSolver.h"
+#include "PlateStressSolver.h"
+#include "StochasticExcitation.h"
+#include "WaveguideString.h"
+#include "PlateGeometry.h"
+#include <array>
 
 
 class ThinPlate  : public juce::Component
@@ -23,6 +29,16 @@ public:
     
 void initParameters();
 
+// Put the plate, strings, tube and connections at rest without setting anything up again
+void clearState();
+
+// Take over the motion of another plate of the same material and size that runs at another
+// quality (time step, grid, scheme or string model), after initParameters(). The plate grids are
+// interpolated between the clamped edges and rescaled to this time step; strings and tube only
+// carry over when they are set up the same way, and start at rest otherwise. The bow, its envelope,
+// the LFO and the mallet pulses carry on. Doesn't allocate, so the audio thread can switch plates
+void transferState(ThinPlate& other);
+
 void updateParameters(const double sig0ToSet, const double sig1ToSet, const double LxToSet, const double LyToSet, const double excXToSet, const double excYToSet, const double lisXToSet, const double lisYToSet, const double thicknessToSet, const double excFToSet, const double excTToSet, const double vBToSet, const double fBToSet, const double aToSet, const int excTypeId, const double  bAtt1ToSet, const double bDec1ToSet, const double  bSus1ToSet, const double bRel1ToSet, const double FBEnv1ToSet, const double vBEnv1ToSet, const double lfoRateToSet, const double xPosModToSet, const double yPosModToSet, const int numStringsToSet, const double sLenToSet, const double sPosSpreadToSet, const double sAvgTenToSet, const double sTenDiffToSet, const double sRadToSet, const double sSig0ToSet, const double cylinderLengthToSet, const double cylinderRadiusToSet, const double bellLengthToSet, const double bellRadiusToSet, const int bellGrowth, bool tubeConnToSet, bool springConnToSet);
     
 void updatePlateMaterial(int plateMaterialToSet);
@@ -30,6 +46,59 @@ void updatePlateMaterial(int plateMaterialToSet);
 void getSampleRate(double fsToSet);
 
 void calculateScheme();
+
+// calculateScheme() without the state update, so external connection forces can be added to u^n+1
+void calculateNextState();
+
+double getPlateState(int l, int m, int timeIdx); // timeIdx: 0 = n+1, 1 = n, 2 = n-1
+
+// Force of an external link (PlateNetwork) on u^n+1 at (l, m). The point is kept in the active region
+// from then on, like the plate's own connection points
+void addPlateForce(int l, int m, double force);
+
+// Add a force (in N) at (xRatio, yRatio) of the plate to the next step, spread over the four grid
+// points around the position like the excitation. The forces are collected in a list and added
+// after the plate update, so their cost doesn't depend on the grid size
+void addExcitationForce(double xRatio, double yRatio, double force);
+
+// Queue a mallet pulse: the raised cosine of the mallet with peak force (in N) and duration (in s)
+// at (xRatio, yRatio), starting delaySteps steps from now. It excites the plate as it is, without
+// initParameters() or plateHit(), so earlier hits keep ringing. Up to maxMalletPulses are in flight;
+// one more replaces the pulse closest to its end
+void addMalletPulse(double xRatio, double yRatio, double force, double duration, int delaySteps);
+
+int getNumMalletPulses() { return numMalletPulses; }
+
+// Random impacts (rain, gravel, brushes) on top of the excitation, through addExcitationForce().
+// Density 0 turns them off
+void setStochasticExcitation(const StochasticExcitation::Settings& settingsToSet) { stochasticExcitation.setSettings(settingsToSet); }
+
+// Every plate draws its own impacts. A seed makes them repeat from run to run
+void setStochasticSeed(juce::int64 seed) { stochasticExcitation.setSeed(seed); }
+
+// True if initParameters() would set the plate up differently than it is (grid, connections,
+// scheme or nonlinearity), so a new note has to start it over
+bool needsInit();
+
+// Change of u^n+1 at (l, m) per unit force at (l, m). With the implicit scheme this also prepares the
+// response addPlateForce() needs at (l, m), so call it for every linked point after initParameters()
+double getPlateConnTerm(int l, int m);
+
+// Change of u^n+1 at (l, m) per unit force at (lForce, mForce). Only nonzero for distinct points with the implicit scheme
+double getPlateCoupling(int l, int m, int lForce, int mForce);
+
+// PlateGeometry::Shape of the explicit plate. Takes effect at the next initParameters()
+void setPlateShape(int plateShapeToSet) { plateShape = plateShapeToSet; }
+
+// True for the cells inside the plate shape, which the explicit update moves. The others are clamped
+bool isPlateCell(int l, int m) { return l >= 0 && l < Nx && m >= 0 && m < Ny && cellMask[l*Ny + m] != 0; }
+
+int getNx() { return Nx; }
+
+int getNy() { return Ny; }
+
+// u^n at (l, m), for readers of the whole grid
+double getDisplacement(int l, int m) { return u[l][m]; }
     
 void plateHit();
     
@@ -37,15 +106,115 @@ void startBow();
     
 void endBow();
 
+// Per-note expression on the bow, set before each step: scales of the bow force and velocity, and
+// offsets of the bow position (in ratios of the plate)
+void setBowExpression(double forceScale, double velocityScale, double xOffset, double yOffset);
+
 void updateStates();
 
-//void updateStringStates();
+void updateStringStates();
+
+void updateTubeStates();
+
+// Change the plate time step the constructor set. Takes effect at the next initParameters()
+void setTimeStep(double kToSet);
+
+// Number of string and tube time steps per plate time step. Takes effect at the next initParameters()
+void setSubsystemRates(int stringRatioToSet, int tubeRatioToSet);
+
+// Use the implicit theta scheme with the grid spacing scaled by gridScaleToSet relative to the
+// explicit stability limit (> 1 is coarser and cheaper). The explicit scheme takes scales above 1
+// too. Takes effect at the next initParameters()
+void setImplicitScheme(bool implicitSchemeToSet, double gridScaleToSet);
+
+int getSolverIterations() { return solverIterations; }
+
+// Loops for the explicit plate update. They compute the same u^n+1 in a different order
+enum PlateKernel
+{
+    ReferenceKernel, // Point by point, looking up the excitation weight of each point
+    RowKernel, // Rows without branches, which the compiler can vectorise. The excitation is added afterwards
+    TiledKernel, // RowKernel over tiles of columns, so the rows of a tile stay in the L1 cache on large grids
+    NumPlateKernels
+};
+
+static const char* getPlateKernelName(PlateKernel kernel);
+
+void setPlateKernel(PlateKernel kernelToSet) { plateKernel = kernelToSet; }
+
+PlateKernel getPlateKernel() { return plateKernel; }
+
+// Split the rows of the explicit update (row and tiled kernels) over numThreadsToSet threads, the
+// calling one included. The other threads spin between the steps, so this is for offline
+// rendering, where the plate steps back to back, and park once the plate stops. 1 stops them
+void setPlateThreads(int numThreadsToSet);
+
+int getPlateThreads() { return static_cast<int>(rowWorkers.size()) + 1; }
+
+// The explicit plate update into u^n+1 with the current kernel over the whole interior, without advancing
+// anything else, for timing the kernels. The active region and the symmetry reduction are left out, as
+// a plate at rest would otherwise time empty loops
+void calculateFullPlateUpdate();
+
+// Restrict the explicit update to the part of the plate the excitation has reached. After a
+// mallet hit or audio input on an unconnected plate, edge lines that have decayed below
+// activeThreshold are cleared so the region shrinks again. On by default
+void setActiveRegionTracking(bool activeTrackingToSet);
+
+// Part of the interior the explicit update currently covers (0 to 1)
+double getActiveFraction();
+
+// While the excitation and the plate connections are on the centre line l = (Nx-1)/2, update the
+// explicit plate up to that line and mirror the other half. Only an excitation in the middle of the
+// plate (x = 0.5) or at getCentreLineRatio() is put on the line. Off by default; takes effect at the
+// next initParameters()
+void setSymmetryReduction(bool symmetryReductionToSet) { symmetryReduction = symmetryReductionToSet; }
+
+// Excitation x position, as a ratio of the plate length, that lies on the centre line of the current grid.
+// The clamped edges are at l = 1 and l = Nx-2, so this is half a grid step below 0.5
+double getCentreLineRatio() { return 0.5 * (Nx-1) / Nx; }
+
+// True while only half of the plate is updated
+bool isSymmetryReduced() { return mirrorSymmetric; }
+
+// Couple the explicit plate to an Airy stress function (von Karman plate), so hard hits spread their
+// energy into the higher modes and shimmer like a gong. The plugin's forces move the plate far less
+// than its thickness, where the nonlinearity is heard, so the nonlinear terms take the displacement
+// times displacementGainToSet. 0 keeps the plate linear, and the implicit scheme is always linear.
+// Takes effect at the next initParameters()
+void setNonlinearity(double displacementGainToSet) { nonlinearGain = displacementGainToSet; }
+
+bool isNonlinear() { return nonlinearActive; }
+
+// Strings with an inharmonicity coefficient below the limit run as waveguides (0 = never).
+// Takes effect at the next initParameters()
+void setWaveguideStiffnessLimit(double limitToSet) { waveguideStiffnessLimit = limitToSet; }
+
+static constexpr double defaultWaveguideStiffnessLimit = 1e-3;
+
+// Accumulate the time of the string and tube updates, in high resolution ticks, for a profiler
+void setStageTiming(bool stageTimingToSet) { stageTiming = stageTimingToSet; }
+
+juce::int64 getStringTicks() { return stringTicks; }
+
+juce::int64 getTubeTicks() { return tubeTicks; }
+
+void resetStageTicks() { stringTicks = 0; tubeTicks = 0; }
+
+// Everything that changes while the plate plays (plate, string and tube states, connection
+// forces, bow, envelope, LFO, mallet pulses and the impact generator) for a snapshot. The parameters are not included, so a state
+// only restores into a plate set up the same way; readState() fails if the grid sizes or the
+// connections differ, and leaves the plate silent if the data is cut short
+void writeState(juce::OutputStream& stream);
+
+juce::Result readState(juce::InputStream& stream);
 
 float getOutput()
 {
   
     switch (excType) {
         case Mallet:
+        case Input:
             return (u[static_cast <int> (floor(0.5*Nx))][static_cast <int> (floor(0.5*Ny))]+stringOut+tubeOut*0.00001f)*0.000001;
             break;
         case Bow:
@@ -79,13 +248,117 @@ float interpolation(std::vector<double>* u, int excXidx, int excYidx, double alp
   
 void setADSR(double sampleRate);
     
-void calculateBoreShape();
+// Add a connection on top of the string and tube connections. Kept across initParameters()
+void addConnection(const Connection& connectionToAdd);
+
+void clearAddedConnections();
     
 private:
+    // Response of a substepped string or tube, or of the implicit plate, to a unit connection force
+    struct ForceResponse
+    {
+        std::vector<double> next; // Last substep (u or p), or u^n+1 of the whole plate (flat)
+        std::vector<double> cur; // Second to last substep (u or p)
+        std::vector<double> velocity; // Last substep of v (tube only)
+        double mouthNext = 0, mouthCur = 0; // Air displacement at the mouth in the last two substeps (tube only)
+        int first = 0;
+        int last = -1;
+        int plateResponse = -1; // Index into plateResponses (implicit plate only)
+    };
+    
+    // Change of u^n+1 of the implicit plate due to a unit force at one point, kept only where it is not negligible
+    struct PlateResponse
+    {
+        int index = -1; // Flat grid index of the force
+        int lStart = 0, lEnd = 0, mStart = 0, mEnd = 0; // Window of the response, ends excluded
+        std::vector<double> values; // Row by row over the window
+        
+        double getValue(int l, int m) const
+        {
+            if (l < lStart || lEnd <= l || m < mStart || mEnd <= m)
+                return 0;
+            return values[(l - lStart) * (mEnd - mStart) + m - mStart];
+        }
+    };
+    
+    void buildConnections();
+    
+    // Coupling variables of the last step from the current states, and no connection forces
+    void resetConnectionHistory();
+    
+    PlateGeometry::Settings getGeometrySettings();
+    
+    std::vector<int> getStateLayout();
+    
+    void addConnectionToGraph(Connection conn);
+    
+    void calculateStringStep(int nS, std::vector<double>& next, const std::vector<double>& cur, const std::vector<double>& prev);
+    
+    void calculateTubeStep(double* pNext, const double* pCur, double* vNext, const double* vCur, double& vIntState, double& pIntState, double& mouthNext, double mouthCur);
+    
+    // Mouth velocity and first pressure point of the last tube step from the air displacement at the mouth
+    void updateTubeMouth();
+    
+    bool isMultirate(const ConnectionPoint& point);
+    
+    bool hasResponse(const ConnectionPoint& point);
+    
+    void prepareConnectionEnd(ConnectionPoint& point, ForceResponse& response, bool halfStep);
+    
+    void calculateExplicitPlateStep();
+    
+    // updateRegion with the current kernel, excitation included
+    void calculatePlateUpdate();
+    
+    void calculateImplicitPlateStep();
+    
+    void calculatePlateRows(int lStart, int lEnd, int mStart, int mEnd);
+    
+    // Rows lStart to lEnd - 1 of the update region with the current kernel
+    void calculatePlateBand(int lStart, int lEnd);
+    
+    // The update region in bands of rows, one per thread
+    void calculatePlateBands();
+    
+    void updateActiveRegion();
+    
+    void setFullActiveRegion();
+    
+    void mirrorPlateState();
+    
+    void addNonlinearForce();
+    
+    bool isExcitationOnAxis();
+    
+    void snapExcitationToAxis();
+    
+    void addPlateExcitation();
+    
+    void addExcitationForces();
+    
+    void addMalletPulses();
+    
+    // Index of the response to a force at (l, m) in plateResponses. Solves for it the first time, so only call it while setting up
+    int preparePlateResponse(int l, int m);
+    
+    // Index of an already prepared response, or -1
+    int findPlateResponse(int l, int m) const;
+    
+    void addPlateResponse(const PlateResponse& response, double force);
+    
+    double getHalfStepState(const ConnectionPoint& point);
+    
+    void applyConnectionForce(const ConnectionPoint& point, const ForceResponse& response, double force, double massTerm);
+    
+    void calculateSubstepResponse(const ConnectionPoint& point, ForceResponse& response);
+
+    double& getConnectionState(const ConnectionPoint& point, int timeIdx); // timeIdx: 0 = n+1, 1 = n, 2 = n-1
+    
     enum ExcitationType
     {
         Mallet,
-        Bow
+        Bow,
+        Input // Only the forces of addExcitationForce(), from the plugin's audio input
     };
     
     juce::ADSR adsr1;
@@ -127,6 +400,7 @@ private:
     double b;
     double a;
     double vB, FB, vRel, vRelPrev, eps, tol;
+    double bowForceScale = 1, bowVelocityScale = 1, bowXOffset = 0, bowYOffset = 0; // Per-note expression
     
     double alphaX;
     double alphaY;
@@ -159,12 +433,128 @@ private:
     double connSPos, connSPos2;
     //int lcS, lcS2;
     std::vector<double> alphaConnS, alphaConnX, alphaConnY, alphaConnS2, alphaConnX2, alphaConnY2;
-    std::vector<double> connF; // connection force
-    std::vector<double> eta, etaPrev, etaNext; //Connection distance
-    std::vector<double> rPlus, rMinus;
     std::vector<double> stringConnTerm;
+    ConnectionGraph connectionGraph; // All string, tube and added connections
+    std::vector<Connection> addedConnections;
+    std::vector<ForceResponse> responsesA, responsesB;
+    std::vector<double> applyTermA, applyTermB; // Mass terms used to apply the force to single rate ends
+    std::vector<double> historyA, historyB; // Coupling variables of the last step (multirate connections)
+    std::vector<double> etaHalfPrev; // eta^n-3/2 during a step (multirate connections)
+    std::vector<bool> multirateConn;
+    
+    int stringRatio = 1; // String steps per plate step
+    int tubeRatio = 1; // Tube steps per plate step
+    int pendingStringRatio = 1, pendingTubeRatio = 1; // Set by setSubsystemRates(), used from the next initParameters()
+    double kS; // String time step
+    double kT; // Tube time step
     double plateConnTerm, tubeConnTerm;
     
+    // Coefficients derived from the settings, shared with other plates. The string and tube tables point into it
+    std::shared_ptr<const PlateGeometry> geometry;
+    
+    PlateKernel plateKernel = ReferenceKernel;
+    
+    int plateShape = PlateGeometry::Rectangle;
+    const PlateGeometry::CellRun* cellRuns = nullptr; // Runs of cells inside the shape, indexed by rowRuns
+    const int* rowRuns = nullptr;
+    const char* cellMask = nullptr;
+    
+    // Interior points [lBegin, lEnd) x [mBegin, mEnd)
+    struct GridRegion
+    {
+        int lBegin = 0, lEnd = 0, mBegin = 0, mEnd = 0;
+        
+        bool isEmpty() const { return lBegin >= lEnd || mBegin >= mEnd; }
+        
+        void include(int l, int m)
+        {
+            if (isEmpty())
+            {
+                *this = { l, l + 1, m, m + 1 };
+                return;
+            }
+            lBegin = std::min(lBegin, l);
+            lEnd = std::max(lEnd, l + 1);
+            mBegin = std::min(mBegin, m);
+            mEnd = std::max(mEnd, m + 1);
+        }
+        
+        void include(const GridRegion& other)
+        {
+            if (! other.isEmpty())
+            {
+                include(other.lBegin, other.mBegin);
+                include(other.lEnd - 1, other.mEnd - 1);
+            }
+        }
+    };
+    
+    // Active region tracking. Outside activeRegion u^n+1, u^n and u^n-1 are all zero, and the
+    // stencil reaches two points, so the region grows by two points per step at most
+    bool activeTracking = true;
+    GridRegion activeRegion;
+    GridRegion activeSources; // Plate connection points, which are always updated
+    static constexpr double activeThreshold = 1e-8; // Output level (-160 dB) below which edge lines are cleared
+    GridRegion updateRegion; // Part of activeRegion the kernel computes
+    
+    // Forces of addExcitationForce() for the next step, as the flat grid index (l * Ny + m) and the
+    // change of u^n+1
+    struct PointForce
+    {
+        int index;
+        double value;
+    };
+    std::vector<PointForce> excitationForces;
+    static constexpr int maxInputForces = 2; // Points of the plugin's audio input
+    static constexpr int maxStepImpacts = 16; // Random impacts in one step; more only near a density of the sample rate
+    GridRegion excitationForceRegion; // Points of excitationForces, which stay active
+    
+    // Pulses of addMalletPulse(), in no particular order
+    struct MalletPulse
+    {
+        double xRatio, yRatio, force, duration;
+        int delay; // Steps until the pulse starts
+        int step, numSteps;
+    };
+    static constexpr int maxMalletPulses = 16;
+    std::array<MalletPulse, maxMalletPulses> malletPulses;
+    int numMalletPulses = 0;
+    
+    StochasticExcitation stochasticExcitation;
+    
+    // Symmetry reduction. The y direction isn't reduced, as the frequency dependent damping takes
+    // u^n at m-1 but u^n-1 at m+1, so the update itself isn't symmetric in y
+    bool symmetryReduction = false;
+    bool mirrorSymmetric = false; // Only the rows up to the centre line are updated
+    static constexpr int plateTileSize = 64; // Columns per tile of the TiledKernel
+    
+    // Threads for the rows of the explicit update (see setPlateThreads())
+    class RowWorker;
+    std::vector<std::unique_ptr<RowWorker>> rowWorkers;
+    std::atomic<juce::int64> rowStep { 0 }; // Steps handed to the workers
+    std::vector<int> rowBands; // First row of each thread's band, and the end of the last band
+    static constexpr int minRowsPerBand = 8; // Smaller updates stay on the calling thread
+    
+    // Von Karman coupling. u is in units of k^2 / (rho H (1 + sigma0 k)) metres (a force F at a point
+    // adds F / (hx hy) to u), which also is the change of u^n+1 in metres per unit force density
+    double nonlinearGain = 0; // Displacement gain of the nonlinear terms (0 = linear)
+    bool nonlinearActive = false;
+    double forceTerm = 0; // k^2 / (rho H (1 + sigma0 k))
+    double displacementScale = 0; // Metres per unit u, with the gain
+    double stressScale = 0; // E H / 2 for u in metres
+    double stressPsi = 0; // Auxiliary variable psi^n-1/2, the root of twice the stress energy
+    std::vector<double> stressGradient; // g^n (flat, l * Ny + m)
+    PlateStressSolver stressSolver;
+    
+    bool implicitScheme = false; // Requested scheme
+    bool implicitActive = false; // Scheme of the current grid
+    double gridScale = 1; // Grid spacing relative to the explicit stability limit
+    double theta = 0.25; // Implicit weight, unconditionally stable for theta >= 1/4
+    ImplicitPlateSolver implicitSolver;
+    std::vector<double> implicitRhs, implicitX, implicitW; // Flat grids (l * Ny + m)
+    std::vector<PlateResponse> plateResponses; // Responses to the point forces of the connections
+    int solverIterations = 0;
+    
     bool stringConn, tubeConn;
     
     int Nx; // grid steps (x)
@@ -180,6 +570,11 @@ private:
     double FBEnv1, vBEnv1;
     double bAtt1, bDec1, bSus1, bRel1;
     double nextAdsr1;
+    // juce::ADSR can't be read back, so readState() replays the envelope: the samples of each bow
+    // since the envelope last settled in its sustain (a bow starts from the level the last one left)
+    std::vector<int> envelopeSegments;
+    int envelopeSettleSamples = 0;
+    static constexpr int maxEnvelopeSegments = 32;
     bool isBowing, bowEnd;
     
     double excitation;
@@ -197,7 +592,7 @@ private:
     double sigma0S, sigma1S; // frequency-independent damping and frequency-dependent damping
     double kappaSSq; // Stiffness term
     double As;
-    std::vector<double> TS;
+    const double* TS = nullptr;
     double TavgS;
     double TDiffS;
     //double cSSq;
@@ -208,15 +603,21 @@ private:
     //double lambdaSSq;
     //double muSSq;
     //std::vector<double> LS;
-    std::vector<double> NS;
+    const double* NS = nullptr;
     double NSMax;
-    std::vector<double> cSSq;
-    std::vector<double> hS;
-    std::vector<double> lambdaSSq;
-    std::vector<double> muSSq;
-    std::vector<double> uS1, uS2, uS3;
+    const double* cSSq = nullptr;
+    const double* hS = nullptr;
+    const double* lambdaSSq = nullptr;
+    const double* muSSq = nullptr;
+    const double* uS1 = nullptr;
+    const double* uS2 = nullptr;
+    const double* uS3 = nullptr;
     double stringOut;
     int stringOutIdx;
+    double waveguideStiffnessLimit = defaultWaveguideStiffnessLimit; // Inharmonicity below which a string runs as a waveguide
+    std::vector<WaveguideString> waveguides;
+    std::vector<bool> waveguideString;
+    std::vector<int> waveguideOut; // Output tap of each waveguide string
     //double uS1, uS2, uS3;
     
     std::vector<double>* uStringPrev;
@@ -253,9 +654,7 @@ private:
     double zeta4; //
     double vInt; //
     double pInt; //
-    std::vector<double> sC;
-    std::vector<double> sB;
-    std::vector<double> ST;
+    const double* ST = nullptr;
     double sMinus;
     double sPlus;
     int shape=1;
@@ -263,15 +662,15 @@ private:
     std::vector<double*> v;
     std::vector<std::vector<double>> pStates;
     std::vector<std::vector<double>> vStates;
-    double connFT; // connection force
-    double etaT, etaPrevT, etaNextT; //Connection distance
-    double rPlusT, rMinusT;
     double connXPosT, connYPosT, connTPos;
     int lcPT, mcPT, lcT;
+    double mouthDisplacement[3]; // Air displacement at the mouth at n+1, n and n-1, the tube's end of the plate connection
     double tubeOut;
     
     bool springConn;
     
+    bool stageTiming = false;
+    juce::int64 stringTicks = 0, tubeTicks = 0;
 
     
     
@@ -0,0 +1,46 @@
+/*
+  ==============================================================================
+
+    WavefieldFile.cpp
+
+  ==============================================================================
+*/
+
+#include "WavefieldFile.h"
+
+juce::Result WavefieldFile::open (const juce::File& file)
+{
+    mappedFile = std::make_unique<juce::MemoryMappedFile> (file, juce::MemoryMappedFile::readOnly, false);
+    if (mappedFile->getData() == nullptr || mappedFile->getSize() < sizeof (WavefieldHeader))
+        return juce::Result::fail ("Can't read the recording " + file.getFullPathName());
+
+    std::memcpy (&header, mappedFile->getData(), sizeof (header));
+    if (std::memcmp (header.magic, "PLWF", 4) != 0)
+        return juce::Result::fail (file.getFullPathName() + " is not a wavefield recording");
+    if (header.version != wavefieldVersion)
+        return juce::Result::fail (file.getFileName() + " has recording format " + juce::String (header.version) + ", this build reads format " + juce::String (wavefieldVersion));
+
+    auto frameBytes = getWavefieldFrameBytes (header.nx, header.ny);
+    if (header.nx <= 0 || header.ny <= 0 || header.ringFrames <= 0
+        || mappedFile->getSize() < sizeof (WavefieldHeader) + static_cast<size_t> (header.ringFrames) * frameBytes)
+        return juce::Result::fail (file.getFullPathName() + " is cut short");
+    return juce::Result::ok();
+}
+
+int WavefieldFile::getNumFrames() const
+{
+    return static_cast<int> (juce::jmin (header.framesWritten, static_cast<juce::int64> (header.ringFrames)));
+}
+
+juce::int64 WavefieldFile::readFrame (int i, std::vector<float>& values) const
+{
+    auto frame = header.framesWritten - getNumFrames() + i;
+    auto slot = static_cast<size_t> (frame % header.ringFrames);
+    auto* data = static_cast<const char*> (mappedFile->getData()) + sizeof (WavefieldHeader) + slot * getWavefieldFrameBytes (header.nx, header.ny);
+
+    juce::int64 step;
+    std::memcpy (&step, data, sizeof (step));
+    values.resize (static_cast<size_t> (header.nx) * static_cast<size_t> (header.ny));
+    std::memcpy (values.data(), data + sizeof (step), values.size() * sizeof (float));
+    return step;
+}
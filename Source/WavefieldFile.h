@@ -0,0 +1,57 @@
+/*
+  ==============================================================================
+
+    WavefieldFile.h
+
+    Ring file of plate displacement frames, written by WavefieldRecorder:
+        WavefieldHeader
+        ringFrames slots of: plate step (int64), nx * ny floats of u^n (x major)
+    Frame f goes to slot f % ringFrames, so the file holds the last
+    min (framesWritten, ringFrames) frames. The file has the byte order of the machine
+    that wrote it.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+struct WavefieldHeader
+{
+    char magic[4]; // "PLWF"
+    juce::int32 version;
+    juce::int32 nx, ny; // Recorded points
+    juce::int32 frameInterval; // Plate steps per frame
+    juce::int32 spatialStep; // Grid points per recorded point
+    juce::int32 ringFrames;
+    juce::int32 reserved;
+    double plateRate; // Plate steps per second
+    juce::int64 framesWritten; // Updated after every frame is complete
+};
+
+static constexpr juce::int32 wavefieldVersion = 1;
+
+inline size_t getWavefieldFrameBytes (int nx, int ny)
+{
+    return sizeof (juce::int64) + static_cast<size_t> (nx) * static_cast<size_t> (ny) * sizeof (float);
+}
+
+class WavefieldFile
+{
+public:
+    // Maps the file, which may still be recorded to
+    juce::Result open (const juce::File& file);
+
+    const WavefieldHeader& getHeader() const { return header; }
+
+    // Frames in the ring when the file was opened
+    int getNumFrames() const;
+
+    // Frame i of those, oldest first. Returns its plate step
+    juce::int64 readFrame (int i, std::vector<float>& values) const;
+
+private:
+    std::unique_ptr<juce::MemoryMappedFile> mappedFile;
+    WavefieldHeader header {};
+};
@@ -0,0 +1,147 @@
+/*
+  ==============================================================================
+
+    WavefieldRecorder.cpp
+
+  ==============================================================================
+*/
+
+#include "WavefieldRecorder.h"
+
+WavefieldRecorder::WavefieldRecorder() : juce::Thread ("Wavefield recorder")
+{
+}
+
+WavefieldRecorder::~WavefieldRecorder()
+{
+    stop();
+}
+
+juce::Result WavefieldRecorder::start (const juce::File& file, int gridNxToUse, int gridNyToUse, double plateRate, const Settings& settingsToUse)
+{
+    stop();
+    const juce::SpinLock::ScopedLockType scopedLock (lock);
+
+    settings = settingsToUse;
+    settings.frameInterval = juce::jmax (1, settings.frameInterval);
+    settings.spatialStep = juce::jmax (1, settings.spatialStep);
+    settings.ringFrames = juce::jmax (1, settings.ringFrames);
+    gridNx = gridNxToUse;
+    gridNy = gridNyToUse;
+    nx = (gridNx + settings.spatialStep - 1) / settings.spatialStep;
+    ny = (gridNy + settings.spatialStep - 1) / settings.spatialStep;
+
+    WavefieldHeader fileHeader {};
+    std::memcpy (fileHeader.magic, "PLWF", 4);
+    fileHeader.version = wavefieldVersion;
+    fileHeader.nx = nx;
+    fileHeader.ny = ny;
+    fileHeader.frameInterval = settings.frameInterval;
+    fileHeader.spatialStep = settings.spatialStep;
+    fileHeader.ringFrames = settings.ringFrames;
+    fileHeader.plateRate = plateRate;
+
+    // The whole ring is allocated up front, so the writer never grows the file
+    auto fileSize = static_cast<juce::int64> (sizeof (WavefieldHeader) + static_cast<size_t> (settings.ringFrames) * getWavefieldFrameBytes (nx, ny));
+    file.deleteFile();
+    {
+        juce::FileOutputStream stream (file);
+        if (! stream.openedOk())
+            return juce::Result::fail ("Can't write to " + file.getFullPathName());
+
+        stream.write (&fileHeader, sizeof (fileHeader));
+        stream.setPosition (fileSize - 1);
+        stream.writeByte (0);
+        stream.flush();
+        if (stream.getStatus().failed())
+            return juce::Result::fail ("Writing " + file.getFullPathName() + " failed: " + stream.getStatus().getErrorMessage());
+    }
+
+    mappedFile = std::make_unique<juce::MemoryMappedFile> (file, juce::MemoryMappedFile::readWrite, false);
+    if (mappedFile->getData() == nullptr || static_cast<juce::int64> (mappedFile->getSize()) < fileSize)
+    {
+        mappedFile.reset();
+        return juce::Result::fail ("Can't map " + file.getFullPathName());
+    }
+    header = static_cast<WavefieldHeader*> (mappedFile->getData());
+
+    queueFrames.assign (static_cast<size_t> (queueSize) * static_cast<size_t> (nx * ny), 0.0f);
+    queueSteps.assign (queueSize, 0);
+    fifo.reset();
+    step = 0;
+    numDropped = 0;
+
+    startThread();
+    recording = true;
+    return juce::Result::ok();
+}
+
+void WavefieldRecorder::stop()
+{
+    recording = false;
+    stopThread (1000); // Writes what is left in the queue
+    const juce::SpinLock::ScopedLockType scopedLock (lock);
+    header = nullptr;
+    mappedFile.reset();
+}
+
+void WavefieldRecorder::pushFrame (ThinPlate& plate)
+{
+    if (! recording.load())
+        return;
+
+    const juce::SpinLock::ScopedTryLockType tryLock (lock);
+    if (! tryLock.isLocked())
+        return;
+
+    if (step++ % settings.frameInterval != 0)
+        return;
+
+    if (plate.getNx() != gridNx || plate.getNy() != gridNy)
+    {
+        ++numDropped;
+        return;
+    }
+
+    const juce::AbstractFifo::ScopedWrite write (fifo, 1);
+    if (write.blockSize1 == 0)
+    {
+        ++numDropped;
+        return;
+    }
+
+    auto* frame = queueFrames.data() + static_cast<size_t> (write.startIndex1) * static_cast<size_t> (nx * ny);
+    for (int i = 0; i < nx; ++i)
+        for (int j = 0; j < ny; ++j)
+            *frame++ = static_cast<float> (plate.getDisplacement (i * settings.spatialStep, j * settings.spatialStep));
+    queueSteps[static_cast<size_t> (write.startIndex1)] = step - 1;
+}
+
+void WavefieldRecorder::run()
+{
+    while (! threadShouldExit())
+    {
+        writeFrames();
+        wait (10);
+    }
+    writeFrames();
+}
+
+void WavefieldRecorder::writeFrames()
+{
+    const juce::AbstractFifo::ScopedRead read (fifo, fifo.getNumReady());
+    auto frameBytes = getWavefieldFrameBytes (nx, ny);
+    auto* ring = reinterpret_cast<char*> (header) + sizeof (WavefieldHeader);
+    auto write = [&] (int start, int size)
+    {
+        for (int q = start; q < start + size; ++q)
+        {
+            auto* slot = ring + static_cast<size_t> (header->framesWritten % settings.ringFrames) * frameBytes;
+            std::memcpy (slot, &queueSteps[static_cast<size_t> (q)], sizeof (juce::int64));
+            std::memcpy (slot + sizeof (juce::int64), queueFrames.data() + static_cast<size_t> (q) * static_cast<size_t> (nx * ny), frameBytes - sizeof (juce::int64));
+            ++header->framesWritten;
+        }
+    };
+    write (read.startIndex1, read.blockSize1);
+    write (read.startIndex2, read.blockSize2);
+}
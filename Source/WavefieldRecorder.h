@@ -0,0 +1,75 @@
+/*
+  ==============================================================================
+
+    WavefieldRecorder.h
+
+    Records the plate displacement over time into a ring file (see WavefieldFile.h).
+    The audio thread copies every frameInterval-th plate state, optionally every
+    spatialStep-th grid point, into a lock-free queue of preallocated frames; a writer
+    thread moves them into the memory-mapped file. The audio thread never waits: frames
+    are dropped (and counted) if the queue is full, while start() or stop() run, or if
+    the grid no longer has the size the recording was started with.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "ThinPlate.h"
+#include "WavefieldFile.h"
+
+class WavefieldRecorder  : private juce::Thread
+{
+public:
+    struct Settings
+    {
+        int frameInterval = 32; // Plate steps per frame
+        int spatialStep = 1; // Grid points per recorded point
+        int ringFrames = 4096; // Frames kept in the file
+    };
+
+    WavefieldRecorder();
+    ~WavefieldRecorder() override;
+
+    //==============================================================================
+    // Message thread
+
+    // Creates the ring file for a plate grid of gridNxToUse * gridNyToUse points and starts recording
+    juce::Result start (const juce::File& file, int gridNxToUse, int gridNyToUse, double plateRate, const Settings& settingsToUse);
+
+    void stop();
+
+    bool isRecording() const { return recording.load(); }
+
+    int getNumDropped() const { return numDropped.load(); }
+
+    //==============================================================================
+    // Audio thread
+
+    // Call after every plate step
+    void pushFrame (ThinPlate& plate);
+
+private:
+    void run() override;
+
+    void writeFrames();
+
+    static constexpr int queueSize = 64;
+
+    juce::SpinLock lock; // Held by start() and stop(). The audio thread only tries it
+    std::atomic<bool> recording { false };
+    std::atomic<int> numDropped { 0 };
+
+    Settings settings;
+    int gridNx = 0, gridNy = 0; // Plate grid
+    int nx = 0, ny = 0; // Recorded points
+    juce::int64 step = 0;
+
+    juce::AbstractFifo fifo { queueSize };
+    std::vector<float> queueFrames; // queueSize frames of nx * ny points
+    std::vector<juce::int64> queueSteps;
+
+    std::unique_ptr<juce::MemoryMappedFile> mappedFile;
+    WavefieldHeader* header = nullptr; // In the mapped file
+};
@@ -0,0 +1,224 @@
+/*
+  ==============================================================================
+
+    WaveguideString.cpp
+
+  ==============================================================================
+*/
+
+#include "WaveguideString.h"
+
+// Phase delays (in samples) at omega (in rad/sample)
+static double allpassDelay (double a, double omega)
+{
+    // (a + z^-1) / (1 + a z^-1)
+    return 1 - 2 * std::atan2 (a * std::sin (omega), 1 + a * std::cos (omega)) / omega;
+}
+
+static double onePoleDelay (double p, double omega)
+{
+    // (1 - p) / (1 - p z^-1)
+    return std::atan2 (p * std::sin (omega), 1 - p * std::cos (omega)) / omega;
+}
+
+double WaveguideString::getInharmonicity (double E, double I, double T, double L)
+{
+    auto pi = juce::MathConstants<double>::pi;
+    return pi * pi * E * I / (T * L * L);
+}
+
+bool WaveguideString::prepare (double kToUse, double L, double T, double rhoA, double E, double I, double sigma0, double sigma1)
+{
+    auto pi = juce::MathConstants<double>::pi;
+    k = kToUse;
+    impedance = std::sqrt (T * rhoA);
+    auto c = std::sqrt (T / rhoA);
+    auto B = getInharmonicity (E, I, T, L);
+
+    // Partial frequencies of the stiff string in rad/sample
+    auto partial = [&] (int n) { return n * pi * c / L * std::sqrt (1 + B * n * n) * k; };
+    if (partial (1) >= 0.25 * pi)
+        return false;
+
+    // Fit at the partial closest to a quarter of the Nyquist frequency
+    int nRef = juce::jmax (2, juce::roundToInt (0.25 * pi / partial (1)));
+    auto omega1 = partial (1);
+    auto omegaRef = partial (nRef);
+
+    // Loss filter g (1 - p) / (1 - p z^-1) with the decay exp (-(sigma0 + sigma1 beta^2) t) per round trip
+    auto loopTime = 2 * L / c;
+    lossGain = std::exp (-sigma0 * loopTime);
+    auto beta = omegaRef / (k * c);
+    auto r = std::exp (-sigma1 * beta * beta * loopTime);
+    lossPole = 0;
+    if (r < 1)
+    {
+        auto cosRef = std::cos (omegaRef);
+        auto p = (1 - r * r * cosRef - std::sqrt ((1 - r * r * cosRef) * (1 - r * r * cosRef) - (1 - r * r) * (1 - r * r))) / (1 - r * r);
+        lossPole = juce::jlimit (0.0, 0.99, p);
+    }
+
+    // For a dispersion coefficient, put the fundamental in tune with the ring length and the
+    // Thiran allpass, and return the phase delay error of the loop at the reference partial
+    auto design = [&] (double a)
+    {
+        auto delay1 = 2 * pi / omega1 - onePoleDelay (lossPole, omega1) - numDispersionStages * allpassDelay (a, omega1);
+        numSlots = static_cast<int> (std::floor (delay1 - 0.5));
+        auto d = delay1 - numSlots;
+        fractionCoeff = (1 - d) / (1 + d);
+
+        auto delayRef = numSlots + onePoleDelay (lossPole, omegaRef) + numDispersionStages * allpassDelay (a, omegaRef) + allpassDelay (fractionCoeff, omegaRef);
+        return delayRef - 2 * pi * nRef / omegaRef;
+    };
+
+    // More negative coefficients shorten the delay of the higher partials. Positive ones make up
+    // for the Thiran allpass when the string is nearly ideal. Bisect for a zero error
+    double lo = -0.9, hi = 0.5;
+    if (design (hi) <= 0)
+    {
+        lo = 0;
+    }
+    else if (design (lo) >= 0)
+    {
+        hi = lo;
+    }
+    for (int i = 0; i < 50 && hi - lo > 1e-9; ++i)
+    {
+        auto mid = 0.5 * (lo + hi);
+        if (design (mid) > 0)
+            hi = mid;
+        else
+            lo = mid;
+    }
+    dispersionCoeff = lo;
+    design (dispersionCoeff);
+
+    if (numSlots < 4)
+        return false;
+
+    slots.assign (numSlots, 0);
+    start = 0;
+    lossState = 0;
+    fractionState = 0;
+    std::fill (std::begin (dispersionState), std::end (dispersionState), 0.0);
+    taps.clear();
+    return true;
+}
+
+int WaveguideString::addTap (double positionRatio)
+{
+    // Slot (numSlots - 1) / 2 is the rigid end
+    auto l = juce::jlimit (1, (numSlots - 2) / 2, juce::roundToInt (positionRatio * (numSlots - 1) * 0.5));
+    for (const auto& tap : taps)
+        if (tap.l == l)
+            return l;
+
+    taps.push_back ({l, {0, 0, 0}});
+    return l;
+}
+
+void WaveguideString::calculateNextState()
+{
+    // Everything moves one slot: the wave leaving the left-going end re-enters at x = 0
+    start = start == 0 ? numSlots - 1 : start - 1;
+    auto in = slots[start];
+
+    auto y = lossGain * (1 - lossPole) * in + lossPole * lossState;
+    lossState = y;
+    for (auto& state : dispersionState)
+    {
+        auto out = dispersionCoeff * y + state;
+        state = y - dispersionCoeff * out;
+        y = out;
+    }
+    auto out = fractionCoeff * y + fractionState;
+    fractionState = y - fractionCoeff * out;
+    slots[start] = out;
+
+    for (auto& tap : taps)
+    {
+        auto velocity = slots[wrap (start + tap.l)] - slots[wrap (start + numSlots - 1 - tap.l)];
+        tap.u[0] = tap.u[2] + 2 * k * velocity;
+    }
+}
+
+void WaveguideString::addForce (int l, double force)
+{
+    auto pulse = 0.5 * force / impedance;
+    slots[wrap (start + l)] += pulse;
+    slots[wrap (start + numSlots - 1 - l)] -= pulse;
+
+    // The tap moves with the incoming waves plus one pulse: v = v_in + F / 2Z
+    getTap (l).u[0] += 2 * k * pulse;
+}
+
+void WaveguideString::updateStates()
+{
+    for (auto& tap : taps)
+    {
+        tap.u[2] = tap.u[1];
+        tap.u[1] = tap.u[0];
+    }
+}
+
+void WaveguideString::clearState()
+{
+    std::fill (slots.begin(), slots.end(), 0.0);
+    lossState = 0;
+    std::fill (std::begin (dispersionState), std::end (dispersionState), 0.0);
+    fractionState = 0;
+    for (auto& tap : taps)
+        tap.u[0] = tap.u[1] = tap.u[2] = 0;
+}
+
+void WaveguideString::writeState (juce::OutputStream& stream) const
+{
+    stream.writeInt (numSlots);
+    stream.writeInt (static_cast<int> (taps.size()));
+    stream.writeInt (start);
+    stream.write (slots.data(), slots.size() * sizeof (double));
+    stream.writeDouble (lossState);
+    for (auto state : dispersionState)
+        stream.writeDouble (state);
+    stream.writeDouble (fractionState);
+    for (const auto& tap : taps)
+    {
+        stream.writeInt (tap.l);
+        stream.write (tap.u, sizeof (tap.u));
+    }
+}
+
+bool WaveguideString::readState (juce::InputStream& stream)
+{
+    if (stream.readInt() != numSlots || stream.readInt() != static_cast<int> (taps.size()))
+        return false;
+
+    start = stream.readInt();
+    auto numBytes = static_cast<int> (slots.size() * sizeof (double));
+    if (! juce::isPositiveAndBelow (start, numSlots) || stream.read (slots.data(), numBytes) != numBytes)
+        return false;
+
+    lossState = stream.readDouble();
+    for (auto& state : dispersionState)
+        state = stream.readDouble();
+    fractionState = stream.readDouble();
+    for (auto& tap : taps)
+        if (stream.readInt() != tap.l || stream.read (tap.u, sizeof (tap.u)) != static_cast<int> (sizeof (tap.u)))
+            return false;
+    return true;
+}
+
+double& WaveguideString::getState (int l, int timeIdx)
+{
+    return getTap (l).u[timeIdx];
+}
+
+WaveguideString::Tap& WaveguideString::getTap (int l)
+{
+    for (auto& tap : taps)
+        if (tap.l == l)
+            return tap;
+
+    jassertfalse; // Not a tap
+    return taps.front();
+}
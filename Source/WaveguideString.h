@@ -0,0 +1,87 @@
+/*
+  ==============================================================================
+
+    WaveguideString.h
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/*
+    Digital waveguide replacement for a lightly stiff string with fixed ends.
+
+    The travelling velocity waves are kept in one ring buffer: slot x holds the right-going
+    wave at x and slot N - 1 - x the (negated) left-going wave, so the far end is a rigid
+    reflection for free. Damping, stiffness and the fractional part of the loop delay are
+    lumped into the reflection at x = 0: a one-pole loss filter, a cascade of first-order
+    allpasses for the dispersion and a first-order Thiran allpass. The filters are fitted
+    to the decay and the partial frequencies of the stiff string at the fundamental and at
+    one higher partial.
+
+    Displacement is only tracked at taps (connection and output points), with the centred
+    relation u^n+1 = u^n-1 + 2k v^n that the connection springs use as well. A force at a tap
+    sends a velocity pulse F / 2Z both ways, so the connection sees the real impedance 2Z.
+*/
+class WaveguideString
+{
+public:
+    // B in f_n = n f_0 sqrt (1 + B n^2)
+    static double getInharmonicity (double E, double I, double T, double L);
+
+    // Returns false if the string is too short for a waveguide at this time step
+    bool prepare (double kToUse, double L, double T, double rhoA, double E, double I, double sigma0, double sigma1);
+
+    // Adds a tap at a position (0 - 1 along the string) and returns its discrete position
+    int addTap (double positionRatio);
+
+    void calculateNextState();
+
+    // Apply a force held over the last time step to the tap at position l
+    void addForce (int l, double force);
+
+    void updateStates();
+
+    // Puts the string at rest, keeping its taps and filters
+    void clearState();
+
+    // timeIdx: 0 = n+1, 1 = n, 2 = n-1
+    double& getState (int l, int timeIdx);
+
+    // Change of the displacement at a tap per unit force
+    double getMassTerm() const { return k / impedance; }
+
+    // Wave slots, filter states and tap displacements for a snapshot. Fails if the string
+    // was prepared with a different length or different taps
+    void writeState (juce::OutputStream& stream) const;
+    bool readState (juce::InputStream& stream);
+
+private:
+    struct Tap
+    {
+        int l;
+        double u[3]; // n+1, n, n-1
+    };
+
+    Tap& getTap (int l);
+
+    int wrap (int idx) const { return idx >= numSlots ? idx - numSlots : idx; }
+
+    double k = 0;
+    double impedance = 1;
+
+    std::vector<double> slots;
+    int numSlots = 0;
+    int start = 0; // Slot of x = 0
+
+    double lossGain = 1, lossPole = 0, lossState = 0;
+    static constexpr int numDispersionStages = 4;
+    double dispersionCoeff = 0;
+    double dispersionState[numDispersionStages] = {};
+    double fractionCoeff = 0, fractionState = 0;
+
+    std::vector<Tap> taps;
+};
@@ -0,0 +1,129 @@
+/*
+  ==============================================================================
+
+    Main.cpp
+
+    Exports the frames of a plate recording (see WavefieldFile.h), oldest first.
+    Usage: WavefieldReader <recording.plwf>
+           WavefieldReader <recording.plwf> <output folder> [--format=csv|pgm] [--from=0] [--count=N]
+
+    Without an output folder it prints what the recording holds. CSV frames have a grid
+    row per line; PGM frames are greyscale images with 0 as mid grey, scaled to the
+    largest displacement of the exported frames. frames.csv lists the plate step and the
+    time of every exported frame.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "../../Source/WavefieldFile.h"
+
+static juce::String getOption (const juce::ArgumentList& args, const juce::String& option, const juce::String& defaultValue)
+{
+    return args.containsOption (option) ? args.getValueForOption (option) : defaultValue;
+}
+
+static bool writeCsv (const juce::File& file, const std::vector<float>& values, int nx, int ny)
+{
+    juce::String text;
+    for (int i = 0; i < nx; ++i)
+    {
+        for (int j = 0; j < ny; ++j)
+            text << (j > 0 ? "," : "") << juce::String (values[static_cast<size_t> (i * ny + j)], 9);
+        text << "\n";
+    }
+    return file.replaceWithText (text);
+}
+
+static bool writePgm (const juce::File& file, const std::vector<float>& values, int nx, int ny, float scale)
+{
+    juce::FileOutputStream stream (file);
+    if (! stream.openedOk())
+        return false;
+
+    stream.setPosition (0);
+    stream.truncate();
+    stream << "P5\n" << nx << " " << ny << "\n255\n";
+    for (int j = 0; j < ny; ++j)
+        for (int i = 0; i < nx; ++i)
+            stream.writeByte (static_cast<char> (juce::jlimit (0, 255, juce::roundToInt (127.5f + 127.5f * values[static_cast<size_t> (i * ny + j)] * scale))));
+    return stream.getStatus().wasOk();
+}
+
+int main (int argc, char* argv[])
+{
+    juce::ArgumentList args (argc, argv);
+    juce::Array<juce::File> files;
+    for (const auto& arg : args.arguments)
+        if (! arg.isOption())
+            files.add (arg.resolveAsFile());
+
+    if (files.isEmpty() || files.size() > 2)
+    {
+        std::cout << "Usage: WavefieldReader <recording.plwf>" << std::endl;
+        std::cout << "       WavefieldReader <recording.plwf> <output folder> [--format=csv|pgm] [--from=0] [--count=N]" << std::endl;
+        return 1;
+    }
+
+    WavefieldFile recording;
+    auto result = recording.open (files[0]);
+    if (result.failed())
+    {
+        std::cerr << result.getErrorMessage() << std::endl;
+        return 1;
+    }
+
+    const auto& header = recording.getHeader();
+    auto numFrames = recording.getNumFrames();
+    if (files.size() == 1)
+    {
+        std::cout << "Grid: " << header.nx << " x " << header.ny << " points (every " << header.spatialStep << ". grid point)" << std::endl;
+        std::cout << "Frames: " << numFrames << " of " << header.framesWritten << " recorded, ring of " << header.ringFrames << std::endl;
+        std::cout << "Frame rate: " << header.plateRate / header.frameInterval << " Hz (every " << header.frameInterval << ". step at " << header.plateRate << " Hz)" << std::endl;
+        return 0;
+    }
+
+    auto format = getOption (args, "--format", "csv");
+    if (format != "csv" && format != "pgm")
+    {
+        std::cerr << "Unknown format " << format << std::endl;
+        return 1;
+    }
+    auto from = juce::jlimit (0, numFrames, getOption (args, "--from", "0").getIntValue());
+    auto count = juce::jlimit (0, numFrames - from, getOption (args, "--count", juce::String (numFrames)).getIntValue());
+
+    auto outputFolder = files[1];
+    if (outputFolder.createDirectory().failed())
+    {
+        std::cerr << "Can't create " << outputFolder.getFullPathName() << std::endl;
+        return 1;
+    }
+
+    std::vector<float> values;
+    float maxValue = 0;
+    for (int f = from; f < from + count && format == "pgm"; ++f)
+    {
+        recording.readFrame (f, values);
+        for (auto value : values)
+            maxValue = juce::jmax (maxValue, std::abs (value));
+    }
+    auto scale = maxValue > 0 ? 1.0f / maxValue : 1.0f;
+
+    juce::String index ("frame,step,time\n");
+    for (int f = from; f < from + count; ++f)
+    {
+        auto step = recording.readFrame (f, values);
+        auto file = outputFolder.getChildFile ("frame" + juce::String (f).paddedLeft ('0', 5) + "." + format);
+        auto written = format == "csv" ? writeCsv (file, values, header.nx, header.ny) : writePgm (file, values, header.nx, header.ny, scale);
+        if (! written)
+        {
+            std::cerr << "Can't write " << file.getFullPathName() << std::endl;
+            return 1;
+        }
+        index << f << "," << step << "," << juce::String (step / header.plateRate, 6) << "\n";
+    }
+    outputFolder.getChildFile ("frames.csv").replaceWithText (index);
+
+    std::cout << "Wrote " << count << " frames to " << outputFolder.getFullPathName() << std::endl;
+    return 0;
+}